@@ -1,7 +1,9 @@
 #version 330 core
+#pragma shader_features TRIPLANAR_MAPPING LIGHTING
 
 
 #define TRIPLANAR_BLEND_SHARPNESS 1.0
+#define AMBIENT_LIGHT vec3(0.15)
 
 
 in VS_OUT {
@@ -16,19 +18,46 @@ out vec4 fragColor;
 
 uniform sampler2D u_texture;
 
+#ifdef LIGHTING
+// Clustered lights, see clusters.h
+uniform samplerBuffer u_lights; // Two texels per light: position, radius / color, intensity
+uniform usamplerBuffer u_cluster_ranges; // First index, count
+uniform usamplerBuffer u_light_indices;
+uniform mat4 u_view_mat;
+uniform uvec3 u_cluster_dims;
+uniform vec2 u_cluster_z_params; // Scale, bias
+uniform vec2 u_screen_size;
+#endif
 
+
+#ifdef TRIPLANAR_MAPPING
 vec4 sample_triplanar(sampler2D texture_sampler, vec3 triplanar_power_normal, vec3 triplanar_pos);
+#endif
+
+#ifdef LIGHTING
+vec3 clustered_lighting(vec3 position, vec3 normal);
+#endif
 
 
 void main()
 {
+#ifdef TRIPLANAR_MAPPING
     vec3 triplanar_power_normal = pow(abs(vs_out.normal), vec3(TRIPLANAR_BLEND_SHARPNESS));
     triplanar_power_normal /= dot(triplanar_power_normal, vec3(1.0));
 
     fragColor = sample_triplanar(u_texture, triplanar_power_normal, vs_out.frag_pos_world.xyz * 0.5);
+#else
+    // Single fetch with the mesh UVs
+    fragColor = texture(u_texture, vs_out.UV);
+#endif
+
+#ifdef LIGHTING
+    fragColor.rgb *= clustered_lighting(vs_out.frag_pos_world.xyz, normalize(vs_out.normal));
+#endif
 }
 
 
+#ifdef TRIPLANAR_MAPPING
 vec4 sample_triplanar(sampler2D texture_sampler, vec3 triplanar_power_normal, vec3 triplanar_pos)
 {
     vec4 sample;
@@ -37,3 +66,38 @@ vec4 sample_triplanar(sampler2D texture_sampler, vec3 triplanar_power_normal, ve
     sample += texture(texture_sampler, triplanar_pos.zy) * triplanar_power_normal.x;
     return sample;
 }
+#endif
+
+
+#ifdef LIGHTING
+vec3 clustered_lighting(vec3 position, vec3 normal)
+{
+    // Same slicing as cluster_depth_slice
+    float view_depth = -(u_view_mat * vec4(position, 1.0)).z;
+    int slice = int(floor(log(max(view_depth, 1e-4)) * u_cluster_z_params.x - u_cluster_z_params.y));
+    uvec3 cell = uvec3(
+        uint(gl_FragCoord.x / u_screen_size.x * float(u_cluster_dims.x)),
+        uint(gl_FragCoord.y / u_screen_size.y * float(u_cluster_dims.y)),
+        uint(clamp(slice, 0, int(u_cluster_dims.z) - 1)));
+    cell = min(cell, u_cluster_dims - uvec3(1));
+
+    int cluster = int(cell.x + u_cluster_dims.x * (cell.y + u_cluster_dims.y * cell.z));
+    uvec2 range = texelFetch(u_cluster_ranges, cluster).xy;
+
+    vec3 light = AMBIENT_LIGHT;
+    for (uint i = 0u; i < range.y; i++) {
+        int index = int(texelFetch(u_light_indices, int(range.x + i)).x);
+        vec4 position_radius = texelFetch(u_lights, index * 2);
+        vec4 color_intensity = texelFetch(u_lights, index * 2 + 1);
+
+        vec3 to_light = position_radius.xyz - position;
+        float distance = length(to_light);
+        float falloff = clamp(1.0 - distance / position_radius.w, 0.0, 1.0);
+
+        float lambert = max(dot(normal, to_light / max(distance, 1e-4)), 0.0);
+        light += color_intensity.rgb * color_intensity.a * lambert * falloff * falloff;
+    }
+
+    return light;
+}
+#endif
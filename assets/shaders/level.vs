@@ -1,4 +1,5 @@
 #version 330 core
+#pragma shader_features VERTEX_SNAPPING AFFINE_MAPPING
 
 
 layout (location = 0) in vec3 a_pos;
@@ -28,11 +29,15 @@ void main()
 
     gl_Position = u_proj_mat * u_view_mat * vs_out.frag_pos_world;
 
+#ifdef VERTEX_SNAPPING
     // Vertex snapping
     float distance_from_cam = clamp(gl_Position.w, -0.1, 1000.0);
     float pos_resolution = 640.0 * 0.2;
     gl_Position.xy = round(gl_Position.xy * (pos_resolution / distance_from_cam)) / (pos_resolution / distance_from_cam);
+#endif
 
+#ifdef AFFINE_MAPPING
     // Affine mapping
     gl_Position /= mix(abs(gl_Position.w), 1.0, 0.5);
+#endif
 }
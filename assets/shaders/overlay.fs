@@ -0,0 +1,20 @@
+#version 330 core
+
+
+in VS_OUT {
+    vec2 UV;
+    vec4 color;
+} vs_out;
+
+
+out vec4 fragColor;
+
+
+// Single channel coverage
+uniform sampler2D u_texture;
+
+
+void main()
+{
+    fragColor = vec4(vs_out.color.rgb, vs_out.color.a * texture(u_texture, vs_out.UV).r);
+}
@@ -0,0 +1,27 @@
+#version 330 core
+
+
+layout (location = 0) in vec2 a_pos;
+layout (location = 1) in vec2 a_UV;
+layout (location = 2) in vec4 a_color;
+
+
+out VS_OUT {
+    vec2 UV;
+    vec4 color;
+} vs_out;
+
+
+/* Screen uniforms */
+uniform vec2 u_screen_size;
+
+
+void main()
+{
+    vs_out.UV = a_UV;
+    vs_out.color = a_color;
+
+    // Pixels, top left origin
+    vec2 ndc = a_pos / u_screen_size * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+}
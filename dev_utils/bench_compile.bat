@@ -0,0 +1,40 @@
+@echo off
+
+set clang_bin=clang
+
+:: Library paths
+set vendor_src_path=C:\dev\c++\.cmake_installs\src\vendor
+set vendor_inc_path=C:\dev\c++\.cmake_installs\include
+set vendor_lib_path=C:\dev\c++\.cmake_installs\lib
+
+:: Source files
+set src_path=./src
+
+set src_files=
+set src_files=%src_files% %src_path%/bench.c
+set src_files=%src_files% %vendor_src_path%/gl.c
+
+:: Include
+set include_flags=
+set include_flags=%include_flags% -I%vendor_inc_path%
+
+:: Optimization
+set opt_flags=-O2
+
+:: Defines
+set define_flags=
+set define_flags=%define_flags% -DLOG_MIN_LEVEL=LOG_LEVEL_INFO
+
+:: Linking
+set link_flags=
+set link_flags=%link_flags% -L%vendor_lib_path%
+set link_flags=%link_flags% -lSDL3
+
+:: Compile
+set compile_command=%clang_bin% %opt_flags% %include_flags% %define_flags% %src_files% %link_flags% -o ./bin/bench.exe
+
+echo %clang_bin%:
+echo %compile_command%
+
+@REM mkdir -p "./bin"
+%compile_command%
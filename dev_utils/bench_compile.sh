@@ -0,0 +1,39 @@
+#!/bin/bash
+
+clang_bin="clang"
+
+# Library paths
+vendor_src_path="/home/ivan/dev/c++/.cmake_installs/src/vendor"
+vendor_inc_path="/home/ivan/dev/c++/.cmake_installs/include"
+vendor_lib_path="/home/ivan/dev/c++/.cmake_installs/lib"
+
+# Source files
+src_path="./src"
+
+src_files=""
+src_files="${src_files} ${src_path}/bench.c"
+src_files="${src_files} ${vendor_src_path}/gl.c"
+
+# Include
+include_flags=""
+include_flags="${include_flags} -I${vendor_inc_path}"
+
+# Optimization, timings of an unoptimized build say little about the real one
+opt_flags="-O2"
+
+# Defines
+define_flags=""
+define_flags="${define_flags} -DLOG_MIN_LEVEL=LOG_LEVEL_INFO" # Loader debug lines would be timed along
+
+# Linking
+link_flags=""
+link_flags="${link_flags} ${vendor_lib_path}/libSDL3.a"
+link_flags="${link_flags} -lm"
+
+# Compile
+compile_command="${clang_bin} ${opt_flags} ${include_flags} ${define_flags} ${src_files} ${link_flags} -o ./bin/bench"
+
+echo "${compile_command}"
+
+mkdir -p "./bin"
+${compile_command}
@@ -0,0 +1,31 @@
+#!/bin/bash
+
+clang_bin="clang"
+
+# Library paths
+vendor_src_path="/home/ivan/dev/c++/.cmake_installs/src/vendor"
+vendor_inc_path="/home/ivan/dev/c++/.cmake_installs/include"
+vendor_lib_path="/home/ivan/dev/c++/.cmake_installs/lib"
+
+# Source files
+src_path="./src"
+
+src_files=""
+src_files="${src_files} ${src_path}/log_decode.c"
+
+# Include
+include_flags=""
+include_flags="${include_flags} -I${vendor_inc_path}"
+
+# Linking
+link_flags=""
+link_flags="${link_flags} ${vendor_lib_path}/libSDL3.a"
+link_flags="${link_flags} -lm"
+
+# Compile
+compile_command="${clang_bin} ${include_flags} ${src_files} ${link_flags} -o ./bin/log_decode"
+
+echo "${compile_command}"
+
+mkdir -p "./bin"
+${compile_command}
@@ -17,13 +17,17 @@ set src_files=%src_files% %src_path%/pack.c
 set include_flags=
 set include_flags=%include_flags% -I%vendor_inc_path%
 
+:: Defines
+set define_flags=
+set define_flags=%define_flags% -DLOG_MIN_LEVEL=LOG_LEVEL_INFO
+
 :: Linking
 set link_flags=
 set link_flags=%link_flags% -L%vendor_lib_path%
 set link_flags=%link_flags% -lSDL3
 
 :: Compile
-set compile_command=%clang_bin% %include_flags% %src_files% %link_flags% -o ./bin/pack.exe
+set compile_command=%clang_bin% %include_flags% %define_flags% %src_files% %link_flags% -o ./bin/pack.exe
 
 echo %clang_bin%:
 echo %compile_command%
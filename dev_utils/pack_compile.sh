@@ -17,13 +17,17 @@ src_files="${src_files} ${src_path}/pack.c"
 include_flags=""
 include_flags="${include_flags} -I${vendor_inc_path}"
 
+# Defines
+define_flags=""
+define_flags="${define_flags} -DLOG_MIN_LEVEL=LOG_LEVEL_INFO" # Per file debug lines dominate on large trees
+
 # Linking
 link_flags=""
 link_flags="${link_flags} ${vendor_lib_path}/libSDL3.a"
 link_flags="${link_flags} -lm"
 
 # Compile
-compile_command="${clang_bin} ${include_flags} ${src_files} ${link_flags} -o ./bin/pack"
+compile_command="${clang_bin} ${include_flags} ${define_flags} ${src_files} ${link_flags} -o ./bin/pack"
 
 echo "${compile_command}"
 
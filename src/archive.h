@@ -0,0 +1,248 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include "log.h"
+#include "arena.h"
+
+/*
+** Asset archives
+**
+** Written by `pack`, mounted by the VFS. Every field is little-endian:
+**
+**     header      { magic "PAK1", u32 version, u32 alignment, u32 reserved, u64 entries_count, u64 index_offset }
+**     blobs       file contents, each starting on a multiple of `alignment`
+**     index       entries_count * { u64 offset, u64 size, u32 flags, u32 path_size, path (null terminated) }
+**
+** The index is written after the blobs so `pack` can stream files out as it produces them, the
+** header is patched with the final count and index offset at the end. An archive whose header
+** still has a zero index offset was never finished.
+**
+** Offsets are from the start of the archive, entries with identical contents share a blob.
+** Paths are the source paths as `pack` saw them, so they all start with the packed root.
+*/
+
+/*
+** Macros
+*/
+
+#define ARCHIVE_MAGIC "PAK1"
+#define ARCHIVE_VERSION 1
+
+#define ARCHIVE_HEADER_SIZE 32
+#define ARCHIVE_INDEX_ENTRY_MIN_SIZE 25 // Fixed fields plus a single character path
+
+#define ARCHIVE_DEFAULT_ALIGNMENT 64
+#define ARCHIVE_MAX_ALIGNMENT (64 * 1024)
+
+#define ARCHIVE_MAX_PATH_LENGTH 512
+
+// Entry flags
+#define ARCHIVE_ENTRY_GENERATED (1 << 0) // Produced by `pack` (shader variant, cooked texture, ...), not a copy of a source file
+#define ARCHIVE_ENTRY_ALIAS (1 << 1) // Shares the blob of an earlier entry
+
+/*
+** Structs
+*/
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t alignment;
+    uint32_t reserved;
+    uint64_t entries_count;
+    uint64_t index_offset;
+} ArchiveHeader;
+
+typedef struct {
+    char* path;
+    size_t offset;
+    size_t size;
+    uint32_t flags;
+} ArchiveEntry;
+
+/*
+** Declarations
+*/
+
+bool archive_write_header(SDL_IOStream* io, const ArchiveHeader* header);
+bool archive_read_header(SDL_IOStream* io, ArchiveHeader* header);
+Sint64 archive_write_padding(SDL_IOStream* io, uint32_t alignment);
+bool archive_write_index_entry(SDL_IOStream* io, const char* path, uint32_t path_size, uint64_t offset, uint64_t size, uint32_t flags);
+ArchiveEntry* archive_read_index(SDL_IOStream* io, Arena* arena, ArchiveHeader* header, int* out_count);
+bool archive_is_valid_alignment(uint32_t alignment);
+
+/*
+** Implementation
+*/
+
+bool archive_write_header(SDL_IOStream* io, const ArchiveHeader* header)
+{
+    bool written = SDL_SeekIO(io, 0, SDL_IO_SEEK_SET) == 0
+        && SDL_WriteIO(io, header->magic, 4) == 4
+        && SDL_WriteU32LE(io, header->version)
+        && SDL_WriteU32LE(io, header->alignment)
+        && SDL_WriteU32LE(io, header->reserved)
+        && SDL_WriteU64LE(io, header->entries_count)
+        && SDL_WriteU64LE(io, header->index_offset);
+
+    if (!written) {
+        LOG_ERROR("Failed to write the archive header! SDL error:\n%s", SDL_GetError());
+    }
+
+    return written;
+}
+
+
+bool archive_read_header(SDL_IOStream* io, ArchiveHeader* header)
+{
+    SDL_memset(header, 0, sizeof(ArchiveHeader));
+
+    bool read = SDL_SeekIO(io, 0, SDL_IO_SEEK_SET) == 0
+        && SDL_ReadIO(io, header->magic, 4) == 4
+        && SDL_ReadU32LE(io, &header->version)
+        && SDL_ReadU32LE(io, &header->alignment)
+        && SDL_ReadU32LE(io, &header->reserved)
+        && SDL_ReadU64LE(io, &header->entries_count)
+        && SDL_ReadU64LE(io, &header->index_offset);
+
+    if (!read || SDL_memcmp(header->magic, ARCHIVE_MAGIC, 4) != 0) {
+        LOG_ERROR("Not an asset archive, or one written by an older pack!");
+        return false;
+    }
+
+    if (header->version != ARCHIVE_VERSION) {
+        LOG_ERROR("Unsupported archive version %u, expected %u! Repack the assets.", header->version, ARCHIVE_VERSION);
+        return false;
+    }
+
+    if (!archive_is_valid_alignment(header->alignment)) {
+        LOG_ERROR("Invalid archive alignment: %u!", header->alignment);
+        return false;
+    }
+
+    if (header->index_offset < ARCHIVE_HEADER_SIZE) {
+        LOG_ERROR("The archive has no index, pack did not finish writing it!");
+        return false;
+    }
+
+    return true;
+}
+
+
+Sint64 archive_write_padding(SDL_IOStream* io, uint32_t alignment)
+{
+    Sint64 offset = SDL_TellIO(io);
+    if (offset < 0) return -1;
+
+    Sint64 aligned_offset = (offset + alignment - 1) & ~(Sint64)(alignment - 1);
+
+    unsigned char zeros[256] = {0};
+    while (offset < aligned_offset) {
+        size_t padding_size = (size_t)SDL_min(aligned_offset - offset, (Sint64)sizeof(zeros));
+        if (SDL_WriteIO(io, zeros, padding_size) < padding_size) return -1;
+
+        offset += padding_size;
+    }
+
+    return aligned_offset;
+}
+
+
+bool archive_write_index_entry(SDL_IOStream* io, const char* path, uint32_t path_size, uint64_t offset, uint64_t size, uint32_t flags)
+{
+    bool written = SDL_WriteU64LE(io, offset)
+        && SDL_WriteU64LE(io, size)
+        && SDL_WriteU32LE(io, flags)
+        && SDL_WriteU32LE(io, path_size)
+        && SDL_WriteIO(io, path, path_size) == path_size;
+
+    if (!written) {
+        LOG_ERROR("Failed to write the index entry of %s! SDL error:\n%s", path, SDL_GetError());
+    }
+
+    return written;
+}
+
+
+ArchiveEntry* archive_read_index(SDL_IOStream* io, Arena* arena, ArchiveHeader* header, int* out_count)
+{
+    *out_count = 0;
+
+    if (!archive_read_header(io, header)) return NULL;
+
+    Sint64 archive_size = SDL_GetIOSize(io);
+    if (archive_size < 0 || header->index_offset > (uint64_t)archive_size) {
+        LOG_ERROR("The archive index starts past the end of the archive!");
+        return NULL;
+    }
+
+    // Bounds the count before anything is allocated for it
+    uint64_t index_size = (uint64_t)archive_size - header->index_offset;
+    if (header->entries_count > index_size / ARCHIVE_INDEX_ENTRY_MIN_SIZE || header->entries_count > SDL_MAX_SINT32) {
+        LOG_ERROR("Invalid archive entries count: %llu!", (unsigned long long)header->entries_count);
+        return NULL;
+    }
+
+    int count = (int)header->entries_count;
+
+    ArchiveEntry* entries = (ArchiveEntry*)arena_alloc(arena, sizeof(ArchiveEntry) * SDL_max(count, 1));
+    if (!entries) {
+        LOG_ERROR("Failed to allocate the index of %d archive entries!", count);
+        return NULL;
+    }
+
+    if (SDL_SeekIO(io, (Sint64)header->index_offset, SDL_IO_SEEK_SET) < 0) {
+        LOG_ERROR("Failed to seek to the archive index! SDL error:\n%s", SDL_GetError());
+        return NULL;
+    }
+
+    for (int i = 0; i < count; i++) {
+        ArchiveEntry* entry = &entries[i];
+
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t path_size = 0;
+
+        if (!SDL_ReadU64LE(io, &offset) || !SDL_ReadU64LE(io, &size) || !SDL_ReadU32LE(io, &entry->flags) || !SDL_ReadU32LE(io, &path_size)) {
+            LOG_ERROR("Failed to read archive entry #%d!", i);
+            return NULL;
+        }
+
+        if (path_size == 0 || path_size > ARCHIVE_MAX_PATH_LENGTH) {
+            LOG_ERROR("Archive entry #%d has an invalid path!", i);
+            return NULL;
+        }
+
+        entry->path = (char*)arena_alloc(arena, path_size);
+        if (!entry->path || SDL_ReadIO(io, entry->path, path_size) < path_size) {
+            LOG_ERROR("Failed to read the path of archive entry #%d!", i);
+            return NULL;
+        }
+        entry->path[path_size - 1] = '\0';
+
+        // Blobs all lie between the header and the index
+        if (offset < ARCHIVE_HEADER_SIZE || size > header->index_offset || offset > header->index_offset - size) {
+            LOG_ERROR("%s points outside of the archive blobs!", entry->path);
+            return NULL;
+        }
+
+        if (offset % header->alignment != 0) {
+            LOG_ERROR("%s is not aligned to %u bytes!", entry->path, header->alignment);
+            return NULL;
+        }
+
+        entry->offset = (size_t)offset;
+        entry->size = (size_t)size;
+    }
+
+    *out_count = count;
+
+    return entries;
+}
+
+
+bool archive_is_valid_alignment(uint32_t alignment)
+{
+    return alignment > 0 && alignment <= ARCHIVE_MAX_ALIGNMENT && (alignment & (alignment - 1)) == 0;
+}
@@ -0,0 +1,324 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include "log.h"
+
+/*
+** Allocators
+**
+** Arena: linear allocator made of chained blocks. Allocation is a pointer bump, individual
+** frees are no-ops and memory is reclaimed all at once with `arena_reset()` or back to a
+** point with `arena_mark()`/`arena_rewind()`. The bottom block is kept around on reset so
+** a steady-state frame or load does not touch the heap at all.
+**
+** Every arena_* allocation function accepts a NULL arena, in which case it falls back to
+** the SDL heap and the caller owns the result (release it with `arena_release()`/SDL_free).
+**
+** Pool: fixed-capacity, fixed-size slots with an intrusive free list, for engine objects
+** that come and go individually.
+*/
+
+/*
+** Macros
+*/
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_ALIGN_UP(size) (((size) + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1))
+#define ARENA_BLOCK_HEADER_SIZE ARENA_ALIGN_UP(sizeof(ArenaBlock))
+
+/*
+** Structs
+*/
+
+typedef struct ArenaBlock {
+    struct ArenaBlock* prev;
+    size_t capacity;
+    size_t used;
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock* current;
+    size_t block_size;
+    void* last_alloc;
+
+    size_t used;
+    size_t peak_used;
+} Arena;
+
+typedef struct {
+    Arena* arena;
+    ArenaBlock* block;
+    size_t block_used;
+    size_t used;
+} ArenaMark;
+
+typedef struct {
+    unsigned char* slots;
+    size_t slot_size;
+    int capacity;
+    int used_count;
+    void* free_list;
+} Pool;
+
+/*
+** Declarations
+*/
+
+void arena_init(Arena* arena, size_t block_size);
+void arena_free(Arena* arena);
+void arena_reset(Arena* arena);
+
+void* arena_alloc(Arena* arena, size_t size);
+void* arena_alloc_zero(Arena* arena, size_t size);
+void* arena_realloc(Arena* arena, void* ptr, size_t size);
+void arena_release(Arena* arena, void* ptr);
+char* arena_strdup(Arena* arena, const char* str);
+
+ArenaMark arena_mark(Arena* arena);
+void arena_rewind(ArenaMark mark);
+
+bool pool_init(Pool* pool, size_t object_size, int capacity);
+void pool_free(Pool* pool);
+void* pool_alloc(Pool* pool);
+void pool_release(Pool* pool, void* object);
+
+/*
+** Implementation
+*/
+
+void arena_init(Arena* arena, size_t block_size)
+{
+    SDL_assert(arena != NULL);
+
+    SDL_memset(arena, 0, sizeof(Arena));
+    arena->block_size = ARENA_ALIGN_UP(block_size);
+}
+
+
+void arena_free(Arena* arena)
+{
+    ArenaBlock* block = arena->current;
+    while (block != NULL) {
+        ArenaBlock* prev = block->prev;
+        SDL_free(block);
+        block = prev;
+    }
+
+    arena->current = NULL;
+    arena->used = 0;
+}
+
+
+void arena_reset(Arena* arena)
+{
+    arena_rewind((ArenaMark){ .arena = arena, .block = NULL, .block_used = 0, .used = 0 });
+}
+
+
+void* arena_alloc(Arena* arena, size_t size)
+{
+    if (arena == NULL) {
+        return SDL_malloc(size);
+    }
+
+    size = ARENA_ALIGN_UP(size);
+
+    ArenaBlock* block = arena->current;
+    if (block == NULL || block->capacity - block->used < size) {
+        // Oversized requests get a block of their own
+        size_t capacity = size > arena->block_size ? size : arena->block_size;
+
+        ArenaBlock* new_block = (ArenaBlock*)SDL_malloc(ARENA_BLOCK_HEADER_SIZE + capacity);
+        if (!new_block) {
+            LOG_ERROR("Failed to allocate a new arena block of %zu bytes.", capacity);
+            return NULL;
+        }
+
+        new_block->prev = block;
+        new_block->capacity = capacity;
+        new_block->used = 0;
+
+        arena->current = new_block;
+        block = new_block;
+    }
+
+    void* ptr = (unsigned char*)block + ARENA_BLOCK_HEADER_SIZE + block->used;
+    block->used += size;
+    arena->last_alloc = ptr;
+
+    arena->used += size;
+    if (arena->used > arena->peak_used) arena->peak_used = arena->used;
+
+    return ptr;
+}
+
+
+void* arena_alloc_zero(Arena* arena, size_t size)
+{
+    if (arena == NULL) {
+        return SDL_calloc(1, size);
+    }
+
+    void* ptr = arena_alloc(arena, size);
+    if (ptr) SDL_memset(ptr, 0, size);
+
+    return ptr;
+}
+
+
+void* arena_realloc(Arena* arena, void* ptr, size_t size)
+{
+    if (arena == NULL) {
+        return SDL_realloc(ptr, size);
+    }
+
+    if (ptr == NULL) {
+        return arena_alloc(arena, size);
+    }
+
+    // Find the block holding `ptr`, normally the current one
+    ArenaBlock* block = arena->current;
+    while (block != NULL) {
+        unsigned char* data = (unsigned char*)block + ARENA_BLOCK_HEADER_SIZE;
+        if ((unsigned char*)ptr >= data && (unsigned char*)ptr < data + block->used) break;
+
+        block = block->prev;
+    }
+
+    SDL_assert(block != NULL);
+
+    unsigned char* block_data = (unsigned char*)block + ARENA_BLOCK_HEADER_SIZE;
+    unsigned char* block_top = block_data + block->used;
+
+    // The most recent allocation can grow or shrink in place
+    size_t ptr_offset = (unsigned char*)ptr - block_data;
+    size_t new_used = ptr_offset + ARENA_ALIGN_UP(size);
+    if (ptr == arena->last_alloc && new_used <= block->capacity) {
+        arena->used = arena->used - block->used + new_used;
+        if (arena->used > arena->peak_used) arena->peak_used = arena->used;
+
+        block->used = new_used;
+        return ptr;
+    }
+
+    // Otherwise copy. Everything between `ptr` and its block's top is at least the old
+    // allocation, so the old size does not have to be known.
+    size_t copy_size = (size_t)(block_top - (unsigned char*)ptr);
+    if (copy_size > size) copy_size = size;
+
+    void* new_ptr = arena_alloc(arena, size);
+    if (new_ptr) SDL_memcpy(new_ptr, ptr, copy_size);
+
+    return new_ptr;
+}
+
+
+void arena_release(Arena* arena, void* ptr)
+{
+    // Arena memory is reclaimed in bulk by `arena_reset()`/`arena_rewind()`
+    if (arena == NULL) SDL_free(ptr);
+}
+
+
+char* arena_strdup(Arena* arena, const char* str)
+{
+    size_t size = strlen(str) + 1;
+
+    char* dup = (char*)arena_alloc(arena, size);
+    if (dup) SDL_memcpy(dup, str, size);
+
+    return dup;
+}
+
+
+ArenaMark arena_mark(Arena* arena)
+{
+    ArenaMark mark = { .arena = arena, .block = arena->current, .block_used = 0, .used = arena->used };
+    if (arena->current != NULL) mark.block_used = arena->current->used;
+
+    return mark;
+}
+
+
+void arena_rewind(ArenaMark mark)
+{
+    Arena* arena = mark.arena;
+    arena->last_alloc = NULL;
+
+    // Drop the blocks created after the mark, keeping the bottom one for reuse
+    while (arena->current != NULL && arena->current != mark.block) {
+        ArenaBlock* prev = arena->current->prev;
+
+        if (mark.block == NULL && prev == NULL) {
+            arena->current->used = 0;
+            arena->used = 0;
+            return;
+        }
+
+        SDL_free(arena->current);
+        arena->current = prev;
+    }
+
+    if (arena->current != NULL) arena->current->used = mark.block_used;
+    arena->used = mark.used;
+}
+
+
+bool pool_init(Pool* pool, size_t object_size, int capacity)
+{
+    SDL_memset(pool, 0, sizeof(Pool));
+
+    // A free slot stores the next-free pointer in place
+    pool->slot_size = ARENA_ALIGN_UP(object_size < sizeof(void*) ? sizeof(void*) : object_size);
+    pool->capacity = capacity;
+
+    pool->slots = (unsigned char*)SDL_malloc(pool->slot_size * capacity);
+    if (!pool->slots) {
+        LOG_ERROR("Failed to allocate a pool of %d x %zu bytes.", capacity, pool->slot_size);
+        return false;
+    }
+
+    for (int i = capacity - 1; i >= 0; i--) {
+        void* slot = pool->slots + pool->slot_size * i;
+        *(void**)slot = pool->free_list;
+        pool->free_list = slot;
+    }
+
+    return true;
+}
+
+
+void pool_free(Pool* pool)
+{
+    SDL_free(pool->slots);
+    SDL_memset(pool, 0, sizeof(Pool));
+}
+
+
+void* pool_alloc(Pool* pool)
+{
+    void* slot = pool->free_list;
+    if (slot == NULL) {
+        LOG_ERROR("Pool exhausted! Capacity: %d", pool->capacity);
+        return NULL;
+    }
+
+    pool->free_list = *(void**)slot;
+    pool->used_count++;
+
+    SDL_memset(slot, 0, pool->slot_size);
+    return slot;
+}
+
+
+void pool_release(Pool* pool, void* object)
+{
+    if (object == NULL) return;
+
+    SDL_assert((unsigned char*)object >= pool->slots && (unsigned char*)object < pool->slots + pool->slot_size * pool->capacity);
+
+    *(void**)object = pool->free_list;
+    pool->free_list = object;
+    pool->used_count--;
+}
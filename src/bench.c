@@ -0,0 +1,948 @@
+#define ENGINE_NO_APP
+#include "main.c"
+
+/*
+** Microbenchmarks for `pack` and the asset loaders.
+**
+** Generates synthetic asset trees (lots of small files, large textures, a mesh with millions of
+** triangles), packs each one with the real `pack` binary, then mounts the archives and times the
+** loaders against a hidden window's GL context. Trees come from a fixed seed, so runs on the same
+** machine are comparable.
+**
+** Usage: bench [-p:<pack binary>] [-d:<work dir>] [-o:<results.json>] [-b:<baseline.json>]
+**              [-t:<regression %>] [-s:<tree scale>] [-r:<repeats>] [-l:<binary log>]
+**
+** Results are written as JSON with one result object per line. Pass an earlier results file as
+** the baseline to compare medians, bench exits with 1 when anything regressed past the threshold.
+*/
+
+/*
+** Macros
+*/
+
+#ifdef SDL_PLATFORM_WINDOWS
+    #define BENCH_DEFAULT_PACK_PATH "./bin/pack.exe"
+#else
+    #define BENCH_DEFAULT_PACK_PATH "./bin/pack"
+#endif
+
+#define BENCH_RESULTS_FORMAT 1
+
+#define BENCH_MAX_RESULTS 64
+#define BENCH_MAX_SAMPLES 64
+#define BENCH_MAX_NAME_LENGTH 64
+#define BENCH_DEFAULT_REPEATS 3
+#define BENCH_DEFAULT_THRESHOLD 10.0 // Percent the median can grow by before it counts as a regression
+#define BENCH_SEED 0x9E3779B9u
+
+// Trees at scale 1
+#define BENCH_SMALL_FILES 4096
+#define BENCH_SMALL_DIRS 64
+#define BENCH_SMALL_MIN_SIZE 256
+#define BENCH_SMALL_MAX_SIZE 4096
+#define BENCH_TEXTURES 4
+#define BENCH_TEXTURE_SIZE 2048
+#define BENCH_MESHES 1
+#define BENCH_MESH_TRIANGLES (1024 * 1024)
+#define BENCH_MESH_EXTENT 512.0f // Side of the square the mesh covers, (512 / MDL_CELL_SIZE)^2 cells
+
+#define BENCH_LOOKUP_ROUNDS 16 // Passes over every path per lookup sample
+
+/*
+** Structs
+*/
+
+typedef struct {
+    char name[BENCH_MAX_NAME_LENGTH];
+
+    uint64_t samples[BENCH_MAX_SAMPLES];
+    int samples_count;
+
+    // Work done per sample, for throughput
+    uint64_t bytes;
+    uint64_t items;
+
+    uint64_t min_ns;
+    uint64_t median_ns;
+    uint64_t mean_ns;
+    uint64_t max_ns;
+} BenchResult;
+
+typedef struct {
+    const char* name;
+    char dir[MAX_PATH_LENGTH];
+    char archive[MAX_PATH_LENGTH];
+
+    uint64_t bytes; // Generated, what `pack` reads
+    int files_count;
+} BenchTree;
+
+typedef enum {
+    BENCH_TREE_SMALL_FILES,
+    BENCH_TREE_TEXTURES,
+    BENCH_TREE_MESHES,
+    BENCH_TREES_COUNT
+} BenchTreeKind;
+
+/*
+** Declarations
+*/
+
+bool bench_init_engine();
+void bench_quit_engine();
+
+bool bench_generate_trees(const char* work_dir, float scale);
+bool bench_generate_small_files(BenchTree* tree, int files_count);
+bool bench_generate_textures(BenchTree* tree, int textures_count, int size);
+bool bench_generate_meshes(BenchTree* tree, int meshes_count, int triangles_count);
+bool bench_write_file(BenchTree* tree, const char* relative_path, const void* data, size_t size);
+bool bench_remove_tree(const char* dir);
+int bench_compare_path_lengths(const void* a, const void* b);
+
+void bench_pack(const char* pack_path);
+void bench_index_load();
+void bench_lookups();
+void bench_textures();
+void bench_meshes();
+
+BenchResult* bench_begin(const char* name, uint64_t bytes, uint64_t items);
+void bench_finish(BenchResult* result);
+int bench_compare_samples(const void* a, const void* b);
+uint32_t bench_random(uint32_t* state);
+
+bool bench_write_results(const char* path, int repeats, float scale);
+int bench_compare_baseline(const char* path, double threshold);
+
+/*
+** Implementation
+*/
+
+BenchTree bench_trees[BENCH_TREES_COUNT] = {
+    { .name = "small_files" },
+    { .name = "textures" },
+    { .name = "meshes" },
+};
+
+BenchResult bench_results[BENCH_MAX_RESULTS];
+int bench_results_count = 0;
+
+int bench_repeats = BENCH_DEFAULT_REPEATS;
+
+int main(int args_count, char* args[])
+{
+    // Parse args
+    const char* pack_path = BENCH_DEFAULT_PACK_PATH;
+    const char* work_dir = "./bench_data";
+    const char* results_path = "bench_results.json";
+    const char* baseline_path = NULL;
+    const char* binary_log_path = NULL;
+    double threshold = BENCH_DEFAULT_THRESHOLD;
+    float scale = 1.0f;
+
+    for (int arg_index = 1; arg_index < args_count; arg_index++) {
+        char* arg = args[arg_index];
+
+        if (str_starts_with(arg, "-p:")) pack_path = arg + strlen("-p:");
+        if (str_starts_with(arg, "-d:")) work_dir = arg + strlen("-d:");
+        if (str_starts_with(arg, "-o:")) results_path = arg + strlen("-o:");
+        if (str_starts_with(arg, "-b:")) baseline_path = arg + strlen("-b:");
+        if (str_starts_with(arg, "-t:")) threshold = SDL_atof(arg + strlen("-t:"));
+        if (str_starts_with(arg, "-s:")) scale = (float)SDL_atof(arg + strlen("-s:"));
+        if (str_starts_with(arg, "-r:")) bench_repeats = SDL_atoi(arg + strlen("-r:"));
+        if (str_starts_with(arg, "-l:")) binary_log_path = arg + strlen("-l:");
+    }
+
+    bench_repeats = SDL_clamp(bench_repeats, 1, BENCH_MAX_SAMPLES);
+    if (scale <= 0.0f) scale = 1.0f;
+
+    log_init(true, binary_log_path);
+
+    LOG_INFO("Pack: %s, work dir: %s, scale: %.2f, repeats: %d", pack_path, work_dir, scale, bench_repeats);
+
+    if (!bench_generate_trees(work_dir, scale)) {
+        LOG_CRITICAL("Failed to generate the asset trees!");
+        log_quit();
+        return 1;
+    }
+
+    bench_pack(pack_path);
+
+    if (!bench_init_engine()) {
+        LOG_CRITICAL("Failed to initialise the engine!");
+        bench_quit_engine();
+        log_quit();
+        return 1;
+    }
+
+    bench_index_load();
+    bench_lookups();
+    bench_textures();
+    bench_meshes();
+
+    bool written = bench_write_results(results_path, bench_repeats, scale);
+    int regressions_count = baseline_path != NULL ? bench_compare_baseline(baseline_path, threshold) : 0;
+
+    bench_quit_engine();
+    log_quit();
+
+    return written && regressions_count == 0 ? 0 : 1;
+}
+
+
+bool bench_init_engine()
+{
+    if (!SDL_Init(SDL_INIT_VIDEO)) {
+        LOG_CRITICAL("Failed to initialize SDL! SDL error:\n%s", SDL_GetError());
+        return false;
+    }
+
+    arena_init(&ctx.frame_arena, FRAME_ARENA_BLOCK_SIZE);
+    arena_init(&ctx.load_arena, LOAD_ARENA_BLOCK_SIZE);
+    arena_init(&ctx.assets_arena, ASSETS_ARENA_BLOCK_SIZE);
+
+    if (!pool_init(&ctx.mesh_pool, sizeof(Mesh), MAX_MESHES)) {
+        LOG_CRITICAL("Failed to create the mesh pool!");
+        return false;
+    }
+
+    resources_init(&ctx.resources);
+
+    // Offscreen, the window only carries the context. No render thread either, so deletes are
+    // immediate and every upload is done by the time glFinish returns.
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+    ctx.display.window = SDL_CreateWindow(PROJECT_NAME " bench", 64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (ctx.display.window == NULL) {
+        LOG_CRITICAL("Failed to create the offscreen window! SDL error:\n%s", SDL_GetError());
+        return false;
+    }
+
+    ctx.display.gl = SDL_GL_CreateContext(ctx.display.window);
+    if (ctx.display.gl == NULL) {
+        LOG_CRITICAL("Failed to create the OpenGL context! SDL error: \n%s", SDL_GetError());
+        return false;
+    }
+
+    if (!gladLoadGL(SDL_GL_GetProcAddress)) {
+        LOG_CRITICAL("Failed to load OpenGL implementation!");
+        return false;
+    }
+
+    LOG_INFO("GL renderer: %s", (const char*)glGetString(GL_RENDERER));
+
+    vfs_init(&ctx.vfs, &ctx.assets_arena);
+
+    for (int i = 0; i < BENCH_TREES_COUNT; i++) {
+        if (!vfs_mount_archive(&ctx.vfs, bench_trees[i].archive, i)) {
+            LOG_CRITICAL("Failed to mount %s!", bench_trees[i].archive);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+void bench_quit_engine()
+{
+    vfs_quit(&ctx.vfs);
+    resources_quit(&ctx.resources);
+
+    if (ctx.display.gl != NULL) SDL_GL_DestroyContext(ctx.display.gl);
+    if (ctx.display.window != NULL) SDL_DestroyWindow(ctx.display.window);
+
+    arena_free(&ctx.frame_arena);
+    arena_free(&ctx.load_arena);
+    arena_free(&ctx.assets_arena);
+    pool_free(&ctx.mesh_pool);
+
+    SDL_Quit();
+}
+
+
+bool bench_generate_trees(const char* work_dir, float scale)
+{
+    uint64_t generate_start_ns = SDL_GetTicksNS();
+
+    for (int i = 0; i < BENCH_TREES_COUNT; i++) {
+        BenchTree* tree = &bench_trees[i];
+        SDL_snprintf(tree->dir, MAX_PATH_LENGTH, "%s/%s", work_dir, tree->name);
+        SDL_snprintf(tree->archive, MAX_PATH_LENGTH, "%s/%s.bin", work_dir, tree->name);
+        tree->bytes = 0;
+        tree->files_count = 0;
+
+        // A tree left by a run at another scale would be packed along
+        if (!bench_remove_tree(tree->dir) || !SDL_CreateDirectory(tree->dir)) {
+            LOG_ERROR("Failed to prepare %s! SDL error:\n%s", tree->dir, SDL_GetError());
+            return false;
+        }
+    }
+
+    bool generated = bench_generate_small_files(&bench_trees[BENCH_TREE_SMALL_FILES], SDL_max((int)(BENCH_SMALL_FILES * scale), 1))
+        && bench_generate_textures(&bench_trees[BENCH_TREE_TEXTURES], SDL_max((int)(BENCH_TEXTURES * scale), 1), BENCH_TEXTURE_SIZE)
+        && bench_generate_meshes(&bench_trees[BENCH_TREE_MESHES], BENCH_MESHES, SDL_max((int)(BENCH_MESH_TRIANGLES * scale), 2));
+
+    if (!generated) return false;
+
+    for (int i = 0; i < BENCH_TREES_COUNT; i++) {
+        LOG_INFO("Generated %s: %d files, %.2f MB", bench_trees[i].name, bench_trees[i].files_count, bench_trees[i].bytes / (1024.0 * 1024.0));
+    }
+
+    LOG_INFO("Generated the trees in %.2f ms", (SDL_GetTicksNS() - generate_start_ns) / 1000000.0);
+    return true;
+}
+
+
+bool bench_generate_small_files(BenchTree* tree, int files_count)
+{
+    uint32_t random = BENCH_SEED;
+    unsigned char contents[BENCH_SMALL_MAX_SIZE];
+
+    for (int i = 0; i < files_count; i++) {
+        char relative_path[MAX_PATH_LENGTH];
+        SDL_snprintf(relative_path, MAX_PATH_LENGTH, "dir_%02d/file_%05d.txt", i % BENCH_SMALL_DIRS, i);
+
+        if (i < BENCH_SMALL_DIRS) {
+            char dir_path[MAX_PATH_LENGTH];
+            SDL_snprintf(dir_path, MAX_PATH_LENGTH, "%s/dir_%02d", tree->dir, i);
+
+            if (!SDL_CreateDirectory(dir_path)) {
+                LOG_ERROR("Failed to create %s! SDL error:\n%s", dir_path, SDL_GetError());
+                return false;
+            }
+        }
+
+        size_t size = BENCH_SMALL_MIN_SIZE + bench_random(&random) % (BENCH_SMALL_MAX_SIZE - BENCH_SMALL_MIN_SIZE + 1);
+        for (size_t c = 0; c < size; c++) contents[c] = 'a' + bench_random(&random) % 26;
+
+        if (!bench_write_file(tree, relative_path, contents, size)) return false;
+    }
+
+    return true;
+}
+
+
+bool bench_generate_textures(BenchTree* tree, int textures_count, int size)
+{
+    uint32_t random = BENCH_SEED;
+
+    // Uncompressed 32-bit TGA, stb_image reads it and nothing has to encode a PNG
+    size_t file_size = 18 + (size_t)size * size * 4;
+    unsigned char* file = SDL_malloc(file_size);
+    if (!file) {
+        LOG_ERROR("Failed to allocate a %dx%d texture!", size, size);
+        return false;
+    }
+
+    SDL_memset(file, 0, 18);
+    file[2] = 2; // Uncompressed true color
+    file[12] = size & 0xFF;
+    file[13] = (size >> 8) & 0xFF;
+    file[14] = size & 0xFF;
+    file[15] = (size >> 8) & 0xFF;
+    file[16] = 32;
+    file[17] = 0x28; // Top-left origin, 8 alpha bits
+
+    bool generated = true;
+    for (int t = 0; t < textures_count && generated; t++) {
+        unsigned char* pixel = file + 18;
+
+        // Gradients with noise on top, so cooked mips differ from level to level
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                uint32_t noise = bench_random(&random);
+                pixel[0] = (unsigned char)((x * 255 / size) ^ (noise & 0x1F));
+                pixel[1] = (unsigned char)((y * 255 / size) ^ ((noise >> 5) & 0x1F));
+                pixel[2] = (unsigned char)(((x + y + t * 64) & 0xFF) ^ ((noise >> 10) & 0x1F));
+                pixel[3] = 255;
+                pixel += 4;
+            }
+        }
+
+        char relative_path[MAX_PATH_LENGTH];
+        SDL_snprintf(relative_path, MAX_PATH_LENGTH, "texture_%02d.tga", t);
+
+        generated = bench_write_file(tree, relative_path, file, file_size);
+    }
+
+    SDL_free(file);
+
+    return generated;
+}
+
+
+bool bench_generate_meshes(BenchTree* tree, int meshes_count, int triangles_count)
+{
+    // A heightfield grid, two triangles per quad, written a row of quads at a time
+    int side = SDL_max((int)SDL_sqrt(triangles_count / 2.0), 1);
+    int tri_count = side * side * 2;
+    float quad_size = BENCH_MESH_EXTENT / side;
+
+    size_t row_size = MDL_VERTEX_SIZE * 6 * side;
+    float* row = SDL_malloc(row_size);
+    if (!row) {
+        LOG_ERROR("Failed to allocate a mesh row!");
+        return false;
+    }
+
+    bool generated = true;
+    for (int m = 0; m < meshes_count && generated; m++) {
+        char path[MAX_PATH_LENGTH];
+        SDL_snprintf(path, MAX_PATH_LENGTH, "%s/mesh_%02d.mdl", tree->dir, m);
+
+        SDL_IOStream* io = SDL_IOFromFile(path, "wb");
+        if (!io) {
+            LOG_ERROR("Failed to create %s! SDL error:\n%s", path, SDL_GetError());
+            generated = false;
+            break;
+        }
+
+        generated = SDL_WriteIO(io, &tri_count, sizeof(int)) == sizeof(int);
+
+        for (int z = 0; z < side && generated; z++) {
+            float* vertex = row;
+
+            for (int x = 0; x < side; x++) {
+                // Corners of the quad, two triangles sharing the diagonal
+                const int corners[6][2] = { {0, 0}, {0, 1}, {1, 1}, {0, 0}, {1, 1}, {1, 0} };
+
+                for (int c = 0; c < 6; c++) {
+                    int grid_x = x + corners[c][0];
+                    int grid_z = z + corners[c][1];
+
+                    // Hashed from the grid corner, so neighbouring triangles agree on it
+                    uint32_t height = BENCH_SEED ^ ((uint32_t)grid_x * 73856093u) ^ ((uint32_t)grid_z * 19349663u);
+                    bench_random(&height);
+
+                    vertex[0] = grid_x * quad_size - BENCH_MESH_EXTENT / 2.0f;
+                    vertex[1] = (height % 1024) / 1024.0f;
+                    vertex[2] = grid_z * quad_size - BENCH_MESH_EXTENT / 2.0f;
+                    vertex[3] = (float)grid_x;
+                    vertex[4] = (float)grid_z;
+                    vertex[5] = 0.0f;
+                    vertex[6] = 1.0f;
+                    vertex[7] = 0.0f;
+                    vertex += MDL_FLOATS_PER_VERTEX;
+                }
+            }
+
+            generated = SDL_WriteIO(io, row, row_size) == row_size;
+        }
+
+        if (!SDL_CloseIO(io) || !generated) {
+            LOG_ERROR("Failed to write %s! SDL error:\n%s", path, SDL_GetError());
+            generated = false;
+            break;
+        }
+
+        tree->bytes += sizeof(int) + row_size * side;
+        tree->files_count++;
+    }
+
+    SDL_free(row);
+
+    return generated;
+}
+
+
+bool bench_write_file(BenchTree* tree, const char* relative_path, const void* data, size_t size)
+{
+    char path[MAX_PATH_LENGTH];
+    SDL_snprintf(path, MAX_PATH_LENGTH, "%s/%s", tree->dir, relative_path);
+
+    if (!SDL_SaveFile(path, data, size)) {
+        LOG_ERROR("Failed to write %s! SDL error:\n%s", path, SDL_GetError());
+        return false;
+    }
+
+    tree->bytes += size;
+    tree->files_count++;
+
+    return true;
+}
+
+
+bool bench_remove_tree(const char* dir)
+{
+    SDL_PathInfo info;
+    if (!SDL_GetPathInfo(dir, &info)) return true;
+
+    int paths_count = 0;
+    char** paths = SDL_GlobDirectory(dir, NULL, 0, &paths_count);
+    if (paths == NULL) return false;
+
+    // Longest first, a directory always comes after everything in it
+    SDL_qsort(paths, paths_count, sizeof(char*), bench_compare_path_lengths);
+
+    bool removed = true;
+    for (int i = 0; i < paths_count && removed; i++) {
+        char path[MAX_PATH_LENGTH];
+        SDL_snprintf(path, MAX_PATH_LENGTH, "%s/%s", dir, paths[i]);
+
+        removed = SDL_RemovePath(path);
+    }
+
+    SDL_free(paths);
+
+    return removed && SDL_RemovePath(dir);
+}
+
+
+int bench_compare_path_lengths(const void* a, const void* b)
+{
+    size_t length_a = strlen(*(char* const*)a);
+    size_t length_b = strlen(*(char* const*)b);
+
+    return length_a < length_b ? 1 : length_a > length_b ? -1 : 0;
+}
+
+
+void bench_pack(const char* pack_path)
+{
+    for (int t = 0; t < BENCH_TREES_COUNT; t++) {
+        BenchTree* tree = &bench_trees[t];
+
+        char name[BENCH_MAX_NAME_LENGTH];
+        SDL_snprintf(name, BENCH_MAX_NAME_LENGTH, "pack.%s", tree->name);
+
+        char in_arg[MAX_PATH_LENGTH + 3];
+        char out_arg[MAX_PATH_LENGTH + 3];
+        SDL_snprintf(in_arg, sizeof(in_arg), "-i:%s", tree->dir);
+        SDL_snprintf(out_arg, sizeof(out_arg), "-o:%s", tree->archive);
+
+        const char* process_args[] = { pack_path, in_arg, out_arg, NULL };
+
+        BenchResult* result = bench_begin(name, tree->bytes, (uint64_t)tree->files_count);
+        if (result == NULL) return;
+
+        for (int r = 0; r < bench_repeats; r++) {
+            // The packer's own log would drown the results, errors still come through stderr
+            SDL_PropertiesID props = SDL_CreateProperties();
+            SDL_SetPointerProperty(props, SDL_PROP_PROCESS_CREATE_ARGS_POINTER, (void*)process_args);
+            SDL_SetNumberProperty(props, SDL_PROP_PROCESS_CREATE_STDOUT_NUMBER, SDL_PROCESS_STDIO_NULL);
+
+            uint64_t start_ns = SDL_GetTicksNS();
+
+            SDL_Process* process = SDL_CreateProcessWithProperties(props);
+            SDL_DestroyProperties(props);
+
+            if (process == NULL) {
+                LOG_ERROR("Failed to start %s! SDL error:\n%s", pack_path, SDL_GetError());
+                break;
+            }
+
+            int exit_code = 0;
+            SDL_WaitProcess(process, true, &exit_code);
+            SDL_DestroyProcess(process);
+
+            if (exit_code != 0) {
+                LOG_ERROR("%s failed on %s with exit code %d!", pack_path, tree->dir, exit_code);
+                break;
+            }
+
+            result->samples[result->samples_count++] = SDL_GetTicksNS() - start_ns;
+        }
+
+        bench_finish(result);
+    }
+}
+
+
+void bench_index_load()
+{
+    for (int t = 0; t < BENCH_TREES_COUNT; t++) {
+        BenchTree* tree = &bench_trees[t];
+
+        char name[BENCH_MAX_NAME_LENGTH];
+        SDL_snprintf(name, BENCH_MAX_NAME_LENGTH, "index_load.%s", tree->name);
+
+        BenchResult* result = bench_begin(name, 0, 0);
+        if (result == NULL) return;
+
+        for (int r = 0; r < bench_repeats; r++) {
+            Arena arena;
+            arena_init(&arena, ASSETS_ARENA_BLOCK_SIZE);
+
+            Vfs vfs;
+            vfs_init(&vfs, &arena);
+
+            uint64_t start_ns = SDL_GetTicksNS();
+            bool mounted = vfs_mount_archive(&vfs, tree->archive, 0);
+            uint64_t elapsed_ns = SDL_GetTicksNS() - start_ns;
+
+            result->items = (uint64_t)vfs.entries_count;
+
+            vfs_quit(&vfs);
+            arena_free(&arena);
+
+            if (!mounted) break;
+
+            result->samples[result->samples_count++] = elapsed_ns;
+        }
+
+        bench_finish(result);
+    }
+}
+
+
+void bench_lookups()
+{
+    int paths_count = ctx.vfs.entries_count;
+
+    ArenaMark mark = arena_mark(&ctx.load_arena);
+
+    // Hits in a shuffled order, and misses that share their prefix with real paths
+    const char** hit_paths = arena_alloc(&ctx.load_arena, sizeof(char*) * SDL_max(paths_count, 1));
+    char** miss_paths = arena_alloc(&ctx.load_arena, sizeof(char*) * SDL_max(paths_count, 1));
+    if (!hit_paths || !miss_paths) {
+        LOG_ERROR("Failed to allocate the lookup paths!");
+        arena_rewind(mark);
+        return;
+    }
+
+    uint32_t random = BENCH_SEED;
+    for (int i = 0; i < paths_count; i++) hit_paths[i] = ctx.vfs.entries[i].path;
+    for (int i = paths_count - 1; i > 0; i--) {
+        int j = (int)(bench_random(&random) % (uint32_t)(i + 1));
+        const char* swapped = hit_paths[i];
+        hit_paths[i] = hit_paths[j];
+        hit_paths[j] = swapped;
+    }
+
+    for (int i = 0; i < paths_count; i++) {
+        size_t length = strlen(hit_paths[i]);
+        miss_paths[i] = arena_alloc(&ctx.load_arena, length + 2);
+        if (!miss_paths[i]) {
+            LOG_ERROR("Failed to allocate the lookup paths!");
+            arena_rewind(mark);
+            return;
+        }
+
+        SDL_memcpy(miss_paths[i], hit_paths[i], length);
+        miss_paths[i][length] = '~';
+        miss_paths[i][length + 1] = '\0';
+    }
+
+    uint64_t lookups_count = (uint64_t)paths_count * BENCH_LOOKUP_ROUNDS;
+
+    BenchResult* hits = bench_begin("lookup.hit", 0, lookups_count);
+    if (hits != NULL) {
+        for (int r = 0; r < bench_repeats; r++) {
+            int found_count = 0;
+
+            uint64_t start_ns = SDL_GetTicksNS();
+            for (int round = 0; round < BENCH_LOOKUP_ROUNDS; round++) {
+                for (int i = 0; i < paths_count; i++) found_count += io_get_file_entry(hit_paths[i]) != NULL;
+            }
+            hits->samples[hits->samples_count++] = SDL_GetTicksNS() - start_ns;
+
+            if (found_count != paths_count * BENCH_LOOKUP_ROUNDS) LOG_ERROR("Only found %d of %d paths!", found_count, paths_count * BENCH_LOOKUP_ROUNDS);
+        }
+
+        bench_finish(hits);
+    }
+
+    // io_get_file_entry logs every miss, so misses go through the quiet lookup
+    BenchResult* misses = bench_begin("lookup.miss", 0, lookups_count);
+    if (misses != NULL) {
+        for (int r = 0; r < bench_repeats; r++) {
+            int found_count = 0;
+
+            uint64_t start_ns = SDL_GetTicksNS();
+            for (int round = 0; round < BENCH_LOOKUP_ROUNDS; round++) {
+                for (int i = 0; i < paths_count; i++) found_count += io_find_file_entry(miss_paths[i]) != NULL;
+            }
+            misses->samples[misses->samples_count++] = SDL_GetTicksNS() - start_ns;
+
+            if (found_count != 0) LOG_ERROR("Found %d paths that do not exist!", found_count);
+        }
+
+        bench_finish(misses);
+    }
+
+    arena_rewind(mark);
+}
+
+
+void bench_textures()
+{
+    BenchResult* loads = bench_begin("texture.load", 0, 0);
+    BenchResult* decodes = bench_begin("texture.decode", 0, 0);
+    if (loads == NULL || decodes == NULL) return;
+
+    for (int r = 0; r < bench_repeats; r++) {
+        uint64_t load_ns = 0;
+        uint64_t decode_ns = 0;
+        uint64_t bytes = 0;
+        uint64_t textures_count = 0;
+
+        for (int i = 0; i < ctx.vfs.entries_count; i++) {
+            FileEntry* entry = &ctx.vfs.entries[i];
+            if (!texture_is_source_path(entry->path)) continue;
+
+            // As the game loads it, through the cooked mips when the archive has them
+            uint64_t start_ns = SDL_GetTicksNS();
+            GLuint texture = io_load_texture(entry->path, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, 0, false, NULL, NULL);
+            glFinish();
+            load_ns += SDL_GetTicksNS() - start_ns;
+
+            destroy_texture(texture);
+
+            // Full decode of the source image and upload with generated mips
+            ArenaMark mark = arena_mark(&ctx.load_arena);
+
+            start_ns = SDL_GetTicksNS();
+
+            unsigned char* file_buffer = arena_alloc(&ctx.load_arena, entry->size);
+            SDL_IOStream* io = vfs_open(&ctx.vfs, entry, 0);
+            if (!file_buffer || io == NULL || SDL_ReadIO(io, file_buffer, entry->size) < entry->size) {
+                LOG_ERROR("Failed to read %s!", entry->path);
+                arena_rewind(mark);
+                continue;
+            }
+
+            GLuint decoded;
+            glGenTextures(1, &decoded);
+            bool uploaded = upload_texture(decoded, file_buffer, entry->size, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, 0, false, 0, NULL, NULL, NULL);
+            glFinish();
+            decode_ns += SDL_GetTicksNS() - start_ns;
+
+            glDeleteTextures(1, &decoded);
+            arena_rewind(mark);
+
+            if (!uploaded || texture == 0) LOG_ERROR("Failed to load %s!", entry->path);
+
+            bytes += entry->size;
+            textures_count++;
+        }
+
+        loads->samples[loads->samples_count++] = load_ns;
+        decodes->samples[decodes->samples_count++] = decode_ns;
+        loads->items = decodes->items = textures_count;
+        decodes->bytes = bytes;
+    }
+
+    bench_finish(loads);
+    bench_finish(decodes);
+}
+
+
+void bench_meshes()
+{
+    BenchResult* loads = bench_begin("mesh.load", 0, 0);
+    if (loads == NULL) return;
+
+    for (int r = 0; r < bench_repeats; r++) {
+        uint64_t load_ns = 0;
+        uint64_t bytes = 0;
+        uint64_t triangles_count = 0;
+
+        for (int i = 0; i < ctx.vfs.entries_count; i++) {
+            FileEntry* entry = &ctx.vfs.entries[i];
+            if (!mdl_is_source_path(entry->path)) continue;
+
+            Mesh* mesh = pool_alloc(&ctx.mesh_pool);
+            if (mesh == NULL) {
+                LOG_ERROR("Out of meshes!");
+                break;
+            }
+
+            // Parse, upload and the cooked BVH read
+            uint64_t start_ns = SDL_GetTicksNS();
+            io_load_mesh_mdl(entry->path, mesh);
+            glFinish();
+            load_ns += SDL_GetTicksNS() - start_ns;
+
+            if (mesh->VBO == 0) {
+                LOG_ERROR("Failed to load %s!", entry->path);
+                pool_release(&ctx.mesh_pool, mesh);
+                continue;
+            }
+
+            bytes += entry->size;
+            triangles_count += (uint64_t)mesh->vertex_count / 3;
+
+            destroy_mesh(mesh);
+        }
+
+        loads->samples[loads->samples_count++] = load_ns;
+        loads->bytes = bytes;
+        loads->items = triangles_count;
+    }
+
+    bench_finish(loads);
+}
+
+
+BenchResult* bench_begin(const char* name, uint64_t bytes, uint64_t items)
+{
+    if (bench_results_count == BENCH_MAX_RESULTS) {
+        LOG_ERROR("Too many benchmark results, skipping %s!", name);
+        return NULL;
+    }
+
+    BenchResult* result = &bench_results[bench_results_count++];
+    SDL_memset(result, 0, sizeof(BenchResult));
+    SDL_strlcpy(result->name, name, BENCH_MAX_NAME_LENGTH);
+    result->bytes = bytes;
+    result->items = items;
+
+    LOG_INFO("Running %s", name);
+
+    return result;
+}
+
+
+void bench_finish(BenchResult* result)
+{
+    if (result->samples_count == 0) {
+        LOG_ERROR("%s has no samples!", result->name);
+        return;
+    }
+
+    uint64_t sorted[BENCH_MAX_SAMPLES];
+    SDL_memcpy(sorted, result->samples, sizeof(uint64_t) * result->samples_count);
+    SDL_qsort(sorted, result->samples_count, sizeof(uint64_t), bench_compare_samples);
+
+    uint64_t total_ns = 0;
+    for (int i = 0; i < result->samples_count; i++) total_ns += sorted[i];
+
+    result->min_ns = sorted[0];
+    result->median_ns = sorted[result->samples_count / 2];
+    result->mean_ns = total_ns / result->samples_count;
+    result->max_ns = sorted[result->samples_count - 1];
+
+    double median_s = result->median_ns / 1000000000.0;
+    double mb_per_s = median_s > 0.0 ? result->bytes / (1024.0 * 1024.0) / median_s : 0.0;
+    double ns_per_item = result->items > 0 ? (double)result->median_ns / result->items : 0.0;
+
+    LOG_INFO("  %-24s median %10.3f ms  min %10.3f ms  max %10.3f ms  %9.1f MB/s  %12.1f ns/item",
+        result->name, result->median_ns / 1000000.0, result->min_ns / 1000000.0, result->max_ns / 1000000.0, mb_per_s, ns_per_item);
+}
+
+
+int bench_compare_samples(const void* a, const void* b)
+{
+    uint64_t sample_a = *(const uint64_t*)a;
+    uint64_t sample_b = *(const uint64_t*)b;
+
+    return sample_a < sample_b ? -1 : sample_a > sample_b ? 1 : 0;
+}
+
+
+uint32_t bench_random(uint32_t* state)
+{
+    // xorshift32, only has to be fast and the same everywhere
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return x;
+}
+
+
+bool bench_write_results(const char* path, int repeats, float scale)
+{
+    SDL_IOStream* io = SDL_IOFromFile(path, "w");
+    if (!io) {
+        LOG_ERROR("Failed to create %s! SDL error:\n%s", path, SDL_GetError());
+        return false;
+    }
+
+    // Renderer names are plain text, but a quote would still break the file
+    char gl_renderer[256];
+    SDL_strlcpy(gl_renderer, (const char*)glGetString(GL_RENDERER), sizeof(gl_renderer));
+    for (char* c = gl_renderer; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') *c = '\'';
+    }
+
+    SDL_IOprintf(io, "{\n");
+    SDL_IOprintf(io, "  \"format\": %d,\n", BENCH_RESULTS_FORMAT);
+    SDL_IOprintf(io, "  \"platform\": \"%s\",\n", SDL_GetPlatform());
+    SDL_IOprintf(io, "  \"cpu_cores\": %d,\n", SDL_GetNumLogicalCPUCores());
+    SDL_IOprintf(io, "  \"gl_renderer\": \"%s\",\n", gl_renderer);
+    SDL_IOprintf(io, "  \"scale\": %.3f,\n", scale);
+    SDL_IOprintf(io, "  \"repeats\": %d,\n", repeats);
+    SDL_IOprintf(io, "  \"results\": [\n");
+
+    // One result per line, bench_compare_baseline reads them back line by line
+    for (int i = 0; i < bench_results_count; i++) {
+        BenchResult* result = &bench_results[i];
+
+        SDL_IOprintf(io, "    {\"name\": \"%s\", \"samples\": %d, \"min_ns\": %llu, \"median_ns\": %llu, \"mean_ns\": %llu, \"max_ns\": %llu, \"bytes\": %llu, \"items\": %llu}%s\n",
+            result->name, result->samples_count,
+            (unsigned long long)result->min_ns, (unsigned long long)result->median_ns, (unsigned long long)result->mean_ns, (unsigned long long)result->max_ns,
+            (unsigned long long)result->bytes, (unsigned long long)result->items,
+            i + 1 < bench_results_count ? "," : "");
+    }
+
+    SDL_IOprintf(io, "  ]\n");
+    SDL_IOprintf(io, "}\n");
+
+    if (!SDL_CloseIO(io)) {
+        LOG_ERROR("Failed to write %s! SDL error:\n%s", path, SDL_GetError());
+        return false;
+    }
+
+    LOG_INFO("Results written to %s", path);
+    return true;
+}
+
+
+int bench_compare_baseline(const char* path, double threshold)
+{
+    size_t baseline_size = 0;
+    char* baseline = SDL_LoadFile(path, &baseline_size);
+    if (!baseline) {
+        LOG_ERROR("Failed to read the baseline %s! SDL error:\n%s", path, SDL_GetError());
+        return 0;
+    }
+
+    LOG_INFO("Compared to %s (regression past +%.1f%%):", path, threshold);
+
+    int regressions_count = 0;
+    int compared_count = 0;
+
+    for (char* line = baseline; line != NULL && *line != '\0'; ) {
+        char* line_end = SDL_strchr(line, '\n');
+        if (line_end != NULL) *line_end = '\0';
+
+        char name[BENCH_MAX_NAME_LENGTH];
+        int samples_count = 0;
+        unsigned long long min_ns = 0;
+        unsigned long long median_ns = 0;
+
+        if (SDL_sscanf(line, " {\"name\": \"%63[^\"]\", \"samples\": %d, \"min_ns\": %llu, \"median_ns\": %llu", name, &samples_count, &min_ns, &median_ns) == 4) {
+            for (int i = 0; i < bench_results_count; i++) {
+                BenchResult* result = &bench_results[i];
+                if (SDL_strcmp(result->name, name) != 0 || result->samples_count == 0 || median_ns == 0) continue;
+
+                double change = ((double)result->median_ns - (double)median_ns) / (double)median_ns * 100.0;
+                compared_count++;
+
+                if (change > threshold) {
+                    regressions_count++;
+                    LOG_WARNING("  %-24s %10.3f -> %10.3f ms  %+7.1f%%  REGRESSION", name, median_ns / 1000000.0, result->median_ns / 1000000.0, change);
+                }
+                else {
+                    LOG_INFO("  %-24s %10.3f -> %10.3f ms  %+7.1f%%", name, median_ns / 1000000.0, result->median_ns / 1000000.0, change);
+                }
+            }
+        }
+
+        line = line_end != NULL ? line_end + 1 : NULL;
+    }
+
+    SDL_free(baseline);
+
+    if (compared_count == 0) {
+        LOG_WARNING("Nothing in %s matches this run!", path);
+    }
+
+    LOG_INFO("%d of %d results regressed", regressions_count, compared_count);
+    return regressions_count;
+}
@@ -0,0 +1,971 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <math.h>
+#include <float.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+#include "log.h"
+#include "arena.h"
+
+/*
+** Triangle BVH
+**
+** Binary bounding volume hierarchy over a triangle soup, split with a binned surface area
+** heuristic. Leaf triangles are stored in packets of 4 in SoA layout so a ray is tested
+** against 4 triangles at once (SSE2, scalar fallback elsewhere). Padding lanes are
+** degenerate and carry BVH_INVALID_TRIANGLE.
+**
+** The whole hierarchy lives in one block laid out exactly like its serialised form
+** (header, nodes, packets), so `pack` can cook it into the archive and the runtime loads it
+** with a single read and uses it in place. Unlike the little-endian archive around it, it is
+** in the native byte order and float layout of the host that built it. The header records
+** that order, a BVH cooked on a host with another one is rejected and the runtime builds
+** its own from the mesh instead.
+*/
+
+/*
+** Macros
+*/
+
+#define BVH_MAGIC "BVH1"
+#define BVH_VERSION 2
+#define BVH_BYTE_ORDER_MARK 0x01020304u // Written natively, reads back differently on another byte order
+#define BVH_PATH_SUFFIX ".bvh" // Cooked next to the mesh: `<mesh path>.bvh`
+
+#define BVH_PACKET_WIDTH 4
+#define BVH_LEAF_MAX_TRIANGLES 16 // Leaves can't grow past this even if SAH would prefer it
+#define BVH_SAH_BINS 16
+#define BVH_SAH_TRAVERSAL_COST 1.0f // Relative to one triangle test
+#define BVH_STACK_SIZE 64 // Traversal holds at most one entry per level plus one
+#define BVH_MAX_SAH_DEPTH 32 // Median splits below, at most 28 more levels down to 16 triangle leaves
+
+#define BVH_INVALID_TRIANGLE 0xFFFFFFFFu
+#define BVH_RAY_EPSILON 1e-7f
+
+/*
+** Structs
+*/
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t nodes_count;
+    uint32_t packets_count;
+    uint32_t triangles_count;
+    uint32_t depth; // Of the deepest leaf, the root is 0
+    uint32_t byte_order; // BVH_BYTE_ORDER_MARK
+    uint32_t reserved;
+} BvhHeader;
+
+typedef struct {
+    float bounds_min[3];
+    uint32_t first; // Left child (right is `first + 1`) for inner nodes, first packet for leaves
+    float bounds_max[3];
+    uint32_t count; // Packet count for leaves, 0 for inner nodes
+} BvhNode;
+
+typedef struct {
+    float v0[3][BVH_PACKET_WIDTH]; // [axis][lane]
+    float e1[3][BVH_PACKET_WIDTH]; // v1 - v0
+    float e2[3][BVH_PACKET_WIDTH]; // v2 - v0
+    uint32_t triangle[BVH_PACKET_WIDTH]; // Index in the source mesh
+} BvhPacket;
+
+typedef struct {
+    void* memory; // Heap block owning everything below
+    size_t memory_size;
+
+    BvhHeader* header;
+    BvhNode* nodes;
+    BvhPacket* packets;
+} Bvh;
+
+typedef struct {
+    float t;
+    float position[3];
+    float normal[3]; // Unit face normal, facing the ray origin
+    uint32_t triangle;
+} BvhRayHit;
+
+typedef struct {
+    float position[3]; // Closest point on the triangle
+    float normal[3]; // Unit, from the triangle towards the query shape
+    float depth; // Penetration depth
+    uint32_t triangle;
+} BvhContact;
+
+/*
+** Declarations
+*/
+
+bool bvh_build(Bvh* bvh, const float* vertices, size_t vertex_stride_floats, uint32_t triangles_count, Arena* scratch);
+bool bvh_from_memory(Bvh* bvh, void* memory, size_t memory_size);
+void bvh_free(Bvh* bvh);
+
+bool bvh_raycast(const Bvh* bvh, const float origin[3], const float direction[3], float max_t, BvhRayHit* out_hit);
+int bvh_overlap_sphere(const Bvh* bvh, const float center[3], float radius, BvhContact* out_contacts, int out_max);
+int bvh_overlap_capsule(const Bvh* bvh, const float a[3], const float b[3], float radius, BvhContact* out_contacts, int out_max);
+
+void bvh_packet_triangle(const BvhPacket* packet, int lane, float v0[3], float v1[3], float v2[3]);
+int bvh_ray_packet(const BvhPacket* packet, const float origin[3], const float direction[3], float* inout_t);
+bool bvh_ray_aabb(const BvhNode* node, const float origin[3], const float inv_direction[3], float max_t, float* out_t);
+
+void bvh_closest_point_triangle(const float p[3], const float a[3], const float b[3], const float c[3], float out[3]);
+float bvh_closest_points_segments(const float p1[3], const float q1[3], const float p2[3], const float q2[3], float out_c1[3], float out_c2[3]);
+float bvh_closest_points_segment_triangle(const float p[3], const float q[3], const float a[3], const float b[3], const float c[3], float out_segment[3], float out_triangle[3]);
+
+/*
+** Implementation
+*/
+
+static inline float bvh_dot(const float a[3], const float b[3]) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+static inline void bvh_sub(const float a[3], const float b[3], float out[3])
+{
+    out[0] = a[0] - b[0];
+    out[1] = a[1] - b[1];
+    out[2] = a[2] - b[2];
+}
+
+static inline void bvh_cross(const float a[3], const float b[3], float out[3])
+{
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static inline void bvh_mad(const float a[3], const float b[3], float s, float out[3])
+{
+    out[0] = a[0] + b[0] * s;
+    out[1] = a[1] + b[1] * s;
+    out[2] = a[2] + b[2] * s;
+}
+
+static inline float bvh_clamp01(float x) { return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x); }
+
+static inline float bvh_area(const float bounds_min[3], const float bounds_max[3])
+{
+    float dx = bounds_max[0] - bounds_min[0];
+    float dy = bounds_max[1] - bounds_min[1];
+    float dz = bounds_max[2] - bounds_min[2];
+
+    return dx * dy + dy * dz + dz * dx;
+}
+
+static inline void bvh_bounds_reset(float bounds_min[3], float bounds_max[3])
+{
+    for (int axis = 0; axis < 3; axis++) {
+        bounds_min[axis] = FLT_MAX;
+        bounds_max[axis] = -FLT_MAX;
+    }
+}
+
+static inline void bvh_bounds_grow(float bounds_min[3], float bounds_max[3], const float other_min[3], const float other_max[3])
+{
+    for (int axis = 0; axis < 3; axis++) {
+        if (other_min[axis] < bounds_min[axis]) bounds_min[axis] = other_min[axis];
+        if (other_max[axis] > bounds_max[axis]) bounds_max[axis] = other_max[axis];
+    }
+}
+
+
+bool bvh_build(Bvh* bvh, const float* vertices, size_t vertex_stride_floats, uint32_t triangles_count, Arena* scratch)
+{
+    SDL_memset(bvh, 0, sizeof(Bvh));
+
+    ArenaMark scratch_mark = arena_mark(scratch);
+
+    // Per triangle bounds and centroids, built once and partitioned through `order`
+    typedef struct {
+        float bounds_min[3];
+        float bounds_max[3];
+        float centroid[3];
+    } BuildPrimitive;
+
+    typedef struct {
+        uint32_t node;
+        uint32_t start;
+        uint32_t count;
+        uint32_t depth;
+    } BuildTask;
+
+    uint32_t max_nodes = triangles_count > 0 ? triangles_count * 2 - 1 : 1;
+
+    BuildPrimitive* primitives = arena_alloc(scratch, sizeof(BuildPrimitive) * (triangles_count > 0 ? triangles_count : 1));
+    uint32_t* order = arena_alloc(scratch, sizeof(uint32_t) * (triangles_count > 0 ? triangles_count : 1));
+    BvhNode* nodes = arena_alloc(scratch, sizeof(BvhNode) * max_nodes);
+    uint32_t* leaf_starts = arena_alloc(scratch, sizeof(uint32_t) * max_nodes); // First entry of `order` per leaf
+    uint32_t* leaf_counts = arena_alloc(scratch, sizeof(uint32_t) * max_nodes);
+    BuildTask* tasks = arena_alloc(scratch, sizeof(BuildTask) * max_nodes);
+
+    if (!primitives || !order || !nodes || !leaf_starts || !leaf_counts || !tasks) {
+        LOG_ERROR("Failed to allocate BVH build buffers for %u triangles!", triangles_count);
+        arena_rewind(scratch_mark);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < triangles_count; i++) {
+        BuildPrimitive* p = &primitives[i];
+        bvh_bounds_reset(p->bounds_min, p->bounds_max);
+
+        for (int corner = 0; corner < 3; corner++) {
+            const float* v = vertices + (i * 3 + corner) * vertex_stride_floats;
+            bvh_bounds_grow(p->bounds_min, p->bounds_max, v, v);
+        }
+
+        for (int axis = 0; axis < 3; axis++) p->centroid[axis] = (p->bounds_min[axis] + p->bounds_max[axis]) * 0.5f;
+
+        order[i] = i;
+    }
+
+    // Root
+    uint32_t nodes_count = 1;
+    uint32_t packets_count = 0;
+    uint32_t depth = 0;
+    int tasks_count = 0;
+
+    SDL_memset(&nodes[0], 0, sizeof(BvhNode));
+    tasks[tasks_count++] = (BuildTask){ .node = 0, .start = 0, .count = triangles_count, .depth = 0 };
+
+    while (tasks_count > 0) {
+        BuildTask task = tasks[--tasks_count];
+        BvhNode* node = &nodes[task.node];
+        if (task.depth > depth) depth = task.depth;
+
+        float centroid_min[3], centroid_max[3];
+        bvh_bounds_reset(node->bounds_min, node->bounds_max);
+        bvh_bounds_reset(centroid_min, centroid_max);
+
+        for (uint32_t i = task.start; i < task.start + task.count; i++) {
+            BuildPrimitive* p = &primitives[order[i]];
+            bvh_bounds_grow(node->bounds_min, node->bounds_max, p->bounds_min, p->bounds_max);
+            bvh_bounds_grow(centroid_min, centroid_max, p->centroid, p->centroid);
+        }
+
+        if (task.count == 0) {
+            // Only an empty mesh gets here, keep a valid, empty root
+            SDL_memset(node, 0, sizeof(BvhNode));
+            continue;
+        }
+
+        // Binned SAH over all three axes. Degenerate input can make SAH peel off a few
+        // triangles per level, past BVH_MAX_SAH_DEPTH median splits keep the depth in check
+        // for the traversal stack.
+        int best_axis = -1;
+        int best_split = 0;
+        float best_cost = FLT_MAX;
+
+        if (task.count > BVH_PACKET_WIDTH && task.depth < BVH_MAX_SAH_DEPTH) {
+            for (int axis = 0; axis < 3; axis++) {
+                float extent = centroid_max[axis] - centroid_min[axis];
+                if (extent <= 0.0f) continue;
+
+                float bin_scale = BVH_SAH_BINS / extent;
+
+                uint32_t bin_counts[BVH_SAH_BINS] = {0};
+                float bin_min[BVH_SAH_BINS][3], bin_max[BVH_SAH_BINS][3];
+                for (int bin = 0; bin < BVH_SAH_BINS; bin++) bvh_bounds_reset(bin_min[bin], bin_max[bin]);
+
+                for (uint32_t i = task.start; i < task.start + task.count; i++) {
+                    BuildPrimitive* p = &primitives[order[i]];
+
+                    int bin = (int)((p->centroid[axis] - centroid_min[axis]) * bin_scale);
+                    if (bin >= BVH_SAH_BINS) bin = BVH_SAH_BINS - 1;
+
+                    bin_counts[bin]++;
+                    bvh_bounds_grow(bin_min[bin], bin_max[bin], p->bounds_min, p->bounds_max);
+                }
+
+                // Sweep from the right to get the right side areas, then from the left
+                float right_areas[BVH_SAH_BINS];
+                uint32_t right_counts[BVH_SAH_BINS];
+                {
+                    float sweep_min[3], sweep_max[3];
+                    bvh_bounds_reset(sweep_min, sweep_max);
+                    uint32_t sweep_count = 0;
+
+                    for (int bin = BVH_SAH_BINS - 1; bin > 0; bin--) {
+                        bvh_bounds_grow(sweep_min, sweep_max, bin_min[bin], bin_max[bin]);
+                        sweep_count += bin_counts[bin];
+                        right_areas[bin] = sweep_count ? bvh_area(sweep_min, sweep_max) : 0.0f;
+                        right_counts[bin] = sweep_count;
+                    }
+                }
+
+                float sweep_min[3], sweep_max[3];
+                bvh_bounds_reset(sweep_min, sweep_max);
+                uint32_t sweep_count = 0;
+
+                for (int split = 1; split < BVH_SAH_BINS; split++) {
+                    bvh_bounds_grow(sweep_min, sweep_max, bin_min[split - 1], bin_max[split - 1]);
+                    sweep_count += bin_counts[split - 1];
+
+                    if (sweep_count == 0 || right_counts[split] == 0) continue;
+
+                    float cost = bvh_area(sweep_min, sweep_max) * sweep_count + right_areas[split] * right_counts[split];
+                    if (cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_split = split;
+                    }
+                }
+            }
+        }
+
+        float node_area = bvh_area(node->bounds_min, node->bounds_max);
+        float leaf_cost = (float)task.count;
+        float split_cost = best_axis >= 0 && node_area > 0.0f ? BVH_SAH_TRAVERSAL_COST + best_cost / node_area : FLT_MAX;
+
+        bool make_leaf = task.count <= BVH_PACKET_WIDTH || (split_cost >= leaf_cost && task.count <= BVH_LEAF_MAX_TRIANGLES);
+
+        if (make_leaf) {
+            node->count = (task.count + BVH_PACKET_WIDTH - 1) / BVH_PACKET_WIDTH;
+            node->first = packets_count;
+            packets_count += node->count;
+
+            leaf_starts[task.node] = task.start;
+            leaf_counts[task.node] = task.count;
+            continue;
+        }
+
+        // Partition, falling back to a median split when all centroids are in one bin
+        uint32_t middle = task.start;
+        if (best_axis >= 0) {
+            float extent = centroid_max[best_axis] - centroid_min[best_axis];
+            float bin_scale = BVH_SAH_BINS / extent;
+
+            uint32_t left = task.start;
+            uint32_t right = task.start + task.count;
+            while (left < right) {
+                int bin = (int)((primitives[order[left]].centroid[best_axis] - centroid_min[best_axis]) * bin_scale);
+                if (bin >= BVH_SAH_BINS) bin = BVH_SAH_BINS - 1;
+
+                if (bin < best_split) {
+                    left++;
+                }
+                else {
+                    uint32_t swap = order[left];
+                    order[left] = order[--right];
+                    order[right] = swap;
+                }
+            }
+            middle = left;
+        }
+
+        if (middle == task.start || middle == task.start + task.count) {
+            middle = task.start + task.count / 2;
+        }
+
+        node->first = nodes_count;
+        node->count = 0;
+        nodes_count += 2;
+
+        tasks[tasks_count++] = (BuildTask){ .node = node->first, .start = task.start, .count = middle - task.start, .depth = task.depth + 1 };
+        tasks[tasks_count++] = (BuildTask){ .node = node->first + 1, .start = middle, .count = task.start + task.count - middle, .depth = task.depth + 1 };
+    }
+
+    // Final block, laid out like the serialised form
+    size_t memory_size = sizeof(BvhHeader) + sizeof(BvhNode) * nodes_count + sizeof(BvhPacket) * packets_count;
+    void* memory = SDL_malloc(memory_size);
+    if (!memory) {
+        LOG_ERROR("Failed to allocate %zu bytes for the BVH!", memory_size);
+        arena_rewind(scratch_mark);
+        return false;
+    }
+
+    BvhHeader* header = (BvhHeader*)memory;
+    SDL_memset(header, 0, sizeof(BvhHeader));
+    SDL_memcpy(header->magic, BVH_MAGIC, 4);
+    header->version = BVH_VERSION;
+    header->nodes_count = nodes_count;
+    header->packets_count = packets_count;
+    header->triangles_count = triangles_count;
+    header->depth = depth;
+    header->byte_order = BVH_BYTE_ORDER_MARK;
+
+    BvhNode* out_nodes = (BvhNode*)(header + 1);
+    BvhPacket* out_packets = (BvhPacket*)(out_nodes + nodes_count);
+
+    SDL_memcpy(out_nodes, nodes, sizeof(BvhNode) * nodes_count);
+
+    for (uint32_t node_index = 0; node_index < nodes_count; node_index++) {
+        BvhNode* node = &out_nodes[node_index];
+        if (node->count == 0) continue;
+
+        for (uint32_t i = 0; i < node->count * BVH_PACKET_WIDTH; i++) {
+            BvhPacket* packet = &out_packets[node->first + i / BVH_PACKET_WIDTH];
+            int lane = i % BVH_PACKET_WIDTH;
+
+            // Padding lanes repeat the leaf's first triangle with zero edges, which no test accepts
+            bool padding = i >= leaf_counts[node_index];
+            uint32_t triangle = order[leaf_starts[node_index] + (padding ? 0 : i)];
+
+            const float* v0 = vertices + (triangle * 3 + 0) * vertex_stride_floats;
+            const float* v1 = vertices + (triangle * 3 + 1) * vertex_stride_floats;
+            const float* v2 = vertices + (triangle * 3 + 2) * vertex_stride_floats;
+
+            for (int axis = 0; axis < 3; axis++) {
+                packet->v0[axis][lane] = v0[axis];
+                packet->e1[axis][lane] = padding ? 0.0f : v1[axis] - v0[axis];
+                packet->e2[axis][lane] = padding ? 0.0f : v2[axis] - v0[axis];
+            }
+            packet->triangle[lane] = padding ? BVH_INVALID_TRIANGLE : triangle;
+        }
+    }
+
+    arena_rewind(scratch_mark);
+
+    return bvh_from_memory(bvh, memory, memory_size);
+}
+
+
+bool bvh_from_memory(Bvh* bvh, void* memory, size_t memory_size)
+{
+    SDL_memset(bvh, 0, sizeof(Bvh));
+
+    BvhHeader* header = (BvhHeader*)memory;
+
+    if (memory_size < sizeof(BvhHeader) || SDL_memcmp(header->magic, BVH_MAGIC, 4) != 0) {
+        LOG_ERROR("Invalid BVH data!");
+        SDL_free(memory);
+        return false;
+    }
+
+    // Checked first, the version would read byte swapped too
+    if (header->byte_order == SDL_Swap32(BVH_BYTE_ORDER_MARK)) {
+        LOG_ERROR("BVH was built on a host with a different byte order!");
+        SDL_free(memory);
+        return false;
+    }
+
+    if (header->version != BVH_VERSION || header->byte_order != BVH_BYTE_ORDER_MARK) {
+        LOG_ERROR("Outdated BVH data, version %u instead of %u!", header->version, BVH_VERSION);
+        SDL_free(memory);
+        return false;
+    }
+
+    size_t expected_size = sizeof(BvhHeader) + sizeof(BvhNode) * (size_t)header->nodes_count + sizeof(BvhPacket) * (size_t)header->packets_count;
+    if (memory_size != expected_size || header->nodes_count == 0) {
+        LOG_ERROR("BVH data size mismatch! Expected %zu bytes, got %zu.", expected_size, memory_size);
+        SDL_free(memory);
+        return false;
+    }
+
+    if (header->depth >= BVH_STACK_SIZE) {
+        LOG_ERROR("BVH is %u levels deep, traversal supports %d!", header->depth, BVH_STACK_SIZE - 1);
+        SDL_free(memory);
+        return false;
+    }
+
+    bvh->memory = memory;
+    bvh->memory_size = memory_size;
+    bvh->header = header;
+    bvh->nodes = (BvhNode*)(header + 1);
+    bvh->packets = (BvhPacket*)(bvh->nodes + header->nodes_count);
+
+    return true;
+}
+
+
+void bvh_free(Bvh* bvh)
+{
+    SDL_free(bvh->memory);
+    SDL_memset(bvh, 0, sizeof(Bvh));
+}
+
+
+void bvh_packet_triangle(const BvhPacket* packet, int lane, float v0[3], float v1[3], float v2[3])
+{
+    for (int axis = 0; axis < 3; axis++) {
+        v0[axis] = packet->v0[axis][lane];
+        v1[axis] = packet->v0[axis][lane] + packet->e1[axis][lane];
+        v2[axis] = packet->v0[axis][lane] + packet->e2[axis][lane];
+    }
+}
+
+
+bool bvh_ray_aabb(const BvhNode* node, const float origin[3], const float inv_direction[3], float max_t, float* out_t)
+{
+    float t_min = 0.0f;
+    float t_max = max_t;
+
+    for (int axis = 0; axis < 3; axis++) {
+        float t0 = (node->bounds_min[axis] - origin[axis]) * inv_direction[axis];
+        float t1 = (node->bounds_max[axis] - origin[axis]) * inv_direction[axis];
+        if (t0 > t1) {
+            float swap = t0;
+            t0 = t1;
+            t1 = swap;
+        }
+
+        // NaN from 0 * inf (origin on a slab plane, parallel ray) keeps the previous bounds
+        if (t0 > t_min) t_min = t0;
+        if (t1 < t_max) t_max = t1;
+    }
+
+    *out_t = t_min;
+    return t_min <= t_max;
+}
+
+
+int bvh_ray_packet(const BvhPacket* packet, const float origin[3], const float direction[3], float* inout_t)
+{
+    // Möller–Trumbore against 4 triangles, two-sided. Returns the lane of the closest hit
+    // nearer than `*inout_t`, or -1.
+    int hit_lane = -1;
+
+#ifdef __SSE2__
+    __m128 dx = _mm_set1_ps(direction[0]), dy = _mm_set1_ps(direction[1]), dz = _mm_set1_ps(direction[2]);
+
+    __m128 e1x = _mm_loadu_ps(packet->e1[0]), e1y = _mm_loadu_ps(packet->e1[1]), e1z = _mm_loadu_ps(packet->e1[2]);
+    __m128 e2x = _mm_loadu_ps(packet->e2[0]), e2y = _mm_loadu_ps(packet->e2[1]), e2z = _mm_loadu_ps(packet->e2[2]);
+
+    // p = d x e2
+    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    __m128 abs_det = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+    __m128 valid = _mm_cmpgt_ps(abs_det, _mm_set1_ps(BVH_RAY_EPSILON));
+    __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+    // s = o - v0
+    __m128 sx = _mm_sub_ps(_mm_set1_ps(origin[0]), _mm_loadu_ps(packet->v0[0]));
+    __m128 sy = _mm_sub_ps(_mm_set1_ps(origin[1]), _mm_loadu_ps(packet->v0[1]));
+    __m128 sz = _mm_sub_ps(_mm_set1_ps(origin[2]), _mm_loadu_ps(packet->v0[2]));
+
+    __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inv_det);
+
+    // q = s x e1
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inv_det);
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inv_det);
+
+    __m128 zero = _mm_setzero_ps();
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+    valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+    valid = _mm_and_ps(valid, _mm_cmpgt_ps(t, _mm_set1_ps(BVH_RAY_EPSILON)));
+    valid = _mm_and_ps(valid, _mm_cmplt_ps(t, _mm_set1_ps(*inout_t)));
+
+    int mask = _mm_movemask_ps(valid);
+    if (mask == 0) return -1;
+
+    float lanes_t[BVH_PACKET_WIDTH];
+    _mm_storeu_ps(lanes_t, t);
+
+    for (int lane = 0; lane < BVH_PACKET_WIDTH; lane++) {
+        if ((mask & (1 << lane)) && lanes_t[lane] < *inout_t) {
+            *inout_t = lanes_t[lane];
+            hit_lane = lane;
+        }
+    }
+#else
+    for (int lane = 0; lane < BVH_PACKET_WIDTH; lane++) {
+        float e1[3] = { packet->e1[0][lane], packet->e1[1][lane], packet->e1[2][lane] };
+        float e2[3] = { packet->e2[0][lane], packet->e2[1][lane], packet->e2[2][lane] };
+        float v0[3] = { packet->v0[0][lane], packet->v0[1][lane], packet->v0[2][lane] };
+
+        float p[3], s[3], q[3];
+        bvh_cross(direction, e2, p);
+
+        float det = bvh_dot(e1, p);
+        if (fabsf(det) <= BVH_RAY_EPSILON) continue;
+        float inv_det = 1.0f / det;
+
+        bvh_sub(origin, v0, s);
+        float u = bvh_dot(s, p) * inv_det;
+        if (u < 0.0f) continue;
+
+        bvh_cross(s, e1, q);
+        float v = bvh_dot(direction, q) * inv_det;
+        if (v < 0.0f || u + v > 1.0f) continue;
+
+        float t = bvh_dot(e2, q) * inv_det;
+        if (t > BVH_RAY_EPSILON && t < *inout_t) {
+            *inout_t = t;
+            hit_lane = lane;
+        }
+    }
+#endif
+
+    return hit_lane;
+}
+
+
+bool bvh_raycast(const Bvh* bvh, const float origin[3], const float direction[3], float max_t, BvhRayHit* out_hit)
+{
+    if (bvh->nodes == NULL || bvh->header->triangles_count == 0) return false;
+
+    float inv_direction[3];
+    for (int axis = 0; axis < 3; axis++) inv_direction[axis] = 1.0f / direction[axis];
+
+    float best_t = max_t;
+    const BvhPacket* best_packet = NULL;
+    int best_lane = -1;
+
+    uint32_t stack[BVH_STACK_SIZE];
+    int stack_count = 0;
+    stack[stack_count++] = 0;
+
+    while (stack_count > 0) {
+        const BvhNode* node = &bvh->nodes[stack[--stack_count]];
+
+        float node_t;
+        if (!bvh_ray_aabb(node, origin, inv_direction, best_t, &node_t)) continue;
+
+        if (node->count > 0) {
+            for (uint32_t i = 0; i < node->count; i++) {
+                const BvhPacket* packet = &bvh->packets[node->first + i];
+
+                int lane = bvh_ray_packet(packet, origin, direction, &best_t);
+                if (lane >= 0) {
+                    best_packet = packet;
+                    best_lane = lane;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first so `best_t` shrinks early
+        float left_t, right_t;
+        bool left_hit = bvh_ray_aabb(&bvh->nodes[node->first], origin, inv_direction, best_t, &left_t);
+        bool right_hit = bvh_ray_aabb(&bvh->nodes[node->first + 1], origin, inv_direction, best_t, &right_t);
+
+        if (stack_count + 2 > BVH_STACK_SIZE) {
+            LOG_WARNING("BVH traversal stack overflow, results may be incomplete.");
+            continue;
+        }
+
+        if (left_hit && right_hit) {
+            bool left_first = left_t <= right_t;
+            stack[stack_count++] = left_first ? node->first + 1 : node->first;
+            stack[stack_count++] = left_first ? node->first : node->first + 1;
+        }
+        else if (left_hit) {
+            stack[stack_count++] = node->first;
+        }
+        else if (right_hit) {
+            stack[stack_count++] = node->first + 1;
+        }
+    }
+
+    if (best_packet == NULL) return false;
+
+    if (out_hit != NULL) {
+        float v0[3], v1[3], v2[3], e1[3], e2[3];
+        bvh_packet_triangle(best_packet, best_lane, v0, v1, v2);
+        bvh_sub(v1, v0, e1);
+        bvh_sub(v2, v0, e2);
+
+        float normal[3];
+        bvh_cross(e1, e2, normal);
+        float length = sqrtf(bvh_dot(normal, normal));
+        float facing = bvh_dot(normal, direction) > 0.0f ? -1.0f : 1.0f;
+
+        out_hit->t = best_t;
+        bvh_mad(origin, direction, best_t, out_hit->position);
+        for (int axis = 0; axis < 3; axis++) out_hit->normal[axis] = normal[axis] * facing / length;
+        out_hit->triangle = best_packet->triangle[best_lane];
+    }
+
+    return true;
+}
+
+
+void bvh_closest_point_triangle(const float p[3], const float a[3], const float b[3], const float c[3], float out[3])
+{
+    // Ericson, Real-Time Collision Detection 5.1.5
+    float ab[3], ac[3], ap[3];
+    bvh_sub(b, a, ab);
+    bvh_sub(c, a, ac);
+    bvh_sub(p, a, ap);
+
+    float d1 = bvh_dot(ab, ap);
+    float d2 = bvh_dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) {
+        SDL_memcpy(out, a, sizeof(float) * 3);
+        return;
+    }
+
+    float bp[3];
+    bvh_sub(p, b, bp);
+    float d3 = bvh_dot(ab, bp);
+    float d4 = bvh_dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) {
+        SDL_memcpy(out, b, sizeof(float) * 3);
+        return;
+    }
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        bvh_mad(a, ab, d1 / (d1 - d3), out);
+        return;
+    }
+
+    float cp[3];
+    bvh_sub(p, c, cp);
+    float d5 = bvh_dot(ab, cp);
+    float d6 = bvh_dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) {
+        SDL_memcpy(out, c, sizeof(float) * 3);
+        return;
+    }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        bvh_mad(a, ac, d2 / (d2 - d6), out);
+        return;
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+        float bc[3];
+        bvh_sub(c, b, bc);
+        bvh_mad(b, bc, (d4 - d3) / ((d4 - d3) + (d5 - d6)), out);
+        return;
+    }
+
+    float denom = 1.0f / (va + vb + vc);
+    float v = vb * denom;
+    float w = vc * denom;
+    for (int axis = 0; axis < 3; axis++) out[axis] = a[axis] + ab[axis] * v + ac[axis] * w;
+}
+
+
+float bvh_closest_points_segments(const float p1[3], const float q1[3], const float p2[3], const float q2[3], float out_c1[3], float out_c2[3])
+{
+    // Ericson, Real-Time Collision Detection 5.1.9. Returns the squared distance.
+    float d1[3], d2[3], r[3];
+    bvh_sub(q1, p1, d1);
+    bvh_sub(q2, p2, d2);
+    bvh_sub(p1, p2, r);
+
+    float a = bvh_dot(d1, d1);
+    float e = bvh_dot(d2, d2);
+    float f = bvh_dot(d2, r);
+
+    float s, t;
+    if (a <= FLT_EPSILON && e <= FLT_EPSILON) {
+        s = t = 0.0f;
+    }
+    else if (a <= FLT_EPSILON) {
+        s = 0.0f;
+        t = bvh_clamp01(f / e);
+    }
+    else {
+        float c = bvh_dot(d1, r);
+        if (e <= FLT_EPSILON) {
+            t = 0.0f;
+            s = bvh_clamp01(-c / a);
+        }
+        else {
+            float b = bvh_dot(d1, d2);
+            float denom = a * e - b * b;
+
+            s = denom != 0.0f ? bvh_clamp01((b * f - c * e) / denom) : 0.0f;
+            t = (b * s + f) / e;
+
+            if (t < 0.0f) {
+                t = 0.0f;
+                s = bvh_clamp01(-c / a);
+            }
+            else if (t > 1.0f) {
+                t = 1.0f;
+                s = bvh_clamp01((b - c) / a);
+            }
+        }
+    }
+
+    bvh_mad(p1, d1, s, out_c1);
+    bvh_mad(p2, d2, t, out_c2);
+
+    float diff[3];
+    bvh_sub(out_c1, out_c2, diff);
+    return bvh_dot(diff, diff);
+}
+
+
+float bvh_closest_points_segment_triangle(const float p[3], const float q[3], const float a[3], const float b[3], const float c[3], float out_segment[3], float out_triangle[3])
+{
+    // Returns the squared distance. A crossing segment is at distance 0 at the crossing point.
+    float pq[3];
+    bvh_sub(q, p, pq);
+
+    {
+        BvhPacket single = {0};
+        for (int axis = 0; axis < 3; axis++) {
+            single.v0[axis][0] = a[axis];
+            single.e1[axis][0] = b[axis] - a[axis];
+            single.e2[axis][0] = c[axis] - a[axis];
+        }
+
+        float t = 1.0f;
+        if (bvh_ray_packet(&single, p, pq, &t) == 0) {
+            bvh_mad(p, pq, t, out_segment);
+            SDL_memcpy(out_triangle, out_segment, sizeof(float) * 3);
+            return 0.0f;
+        }
+    }
+
+    // Otherwise the closest pair has an endpoint on the segment or lies on a triangle edge
+    float best_distance = FLT_MAX;
+    float candidate_segment[3], candidate_triangle[3], diff[3];
+
+    const float* endpoints[2] = { p, q };
+    for (int i = 0; i < 2; i++) {
+        bvh_closest_point_triangle(endpoints[i], a, b, c, candidate_triangle);
+        bvh_sub(endpoints[i], candidate_triangle, diff);
+
+        float distance = bvh_dot(diff, diff);
+        if (distance < best_distance) {
+            best_distance = distance;
+            SDL_memcpy(out_segment, endpoints[i], sizeof(float) * 3);
+            SDL_memcpy(out_triangle, candidate_triangle, sizeof(float) * 3);
+        }
+    }
+
+    const float* edges[3][2] = { { a, b }, { b, c }, { c, a } };
+    for (int i = 0; i < 3; i++) {
+        float distance = bvh_closest_points_segments(p, q, edges[i][0], edges[i][1], candidate_segment, candidate_triangle);
+        if (distance < best_distance) {
+            best_distance = distance;
+            SDL_memcpy(out_segment, candidate_segment, sizeof(float) * 3);
+            SDL_memcpy(out_triangle, candidate_triangle, sizeof(float) * 3);
+        }
+    }
+
+    return best_distance;
+}
+
+
+int bvh_overlap_capsule(const Bvh* bvh, const float a[3], const float b[3], float radius, BvhContact* out_contacts, int out_max)
+{
+    // A sphere is a capsule with both ends at its center
+    if (bvh->nodes == NULL || bvh->header->triangles_count == 0) return 0;
+
+    float query_min[3], query_max[3];
+    for (int axis = 0; axis < 3; axis++) {
+        query_min[axis] = SDL_min(a[axis], b[axis]) - radius;
+        query_max[axis] = SDL_max(a[axis], b[axis]) + radius;
+    }
+
+    bool is_sphere = a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+    int contacts_count = 0;
+
+    uint32_t stack[BVH_STACK_SIZE];
+    int stack_count = 0;
+    stack[stack_count++] = 0;
+
+    while (stack_count > 0) {
+        const BvhNode* node = &bvh->nodes[stack[--stack_count]];
+
+        bool overlaps = true;
+        for (int axis = 0; axis < 3; axis++) {
+            if (node->bounds_min[axis] > query_max[axis] || node->bounds_max[axis] < query_min[axis]) overlaps = false;
+        }
+        if (!overlaps) continue;
+
+        if (node->count == 0) {
+            if (stack_count + 2 > BVH_STACK_SIZE) {
+                LOG_WARNING("BVH traversal stack overflow, results may be incomplete.");
+                continue;
+            }
+
+            stack[stack_count++] = node->first;
+            stack[stack_count++] = node->first + 1;
+            continue;
+        }
+
+        for (uint32_t i = 0; i < node->count; i++) {
+            const BvhPacket* packet = &bvh->packets[node->first + i];
+
+            // Reject the 4 triangle bounds against the query bounds at once, the exact
+            // distance test below is branchy and stays scalar
+            int candidates = 0xF;
+#ifdef __SSE2__
+            __m128 outside = _mm_setzero_ps();
+            for (int axis = 0; axis < 3; axis++) {
+                __m128 v0 = _mm_loadu_ps(packet->v0[axis]);
+                __m128 v1 = _mm_add_ps(v0, _mm_loadu_ps(packet->e1[axis]));
+                __m128 v2 = _mm_add_ps(v0, _mm_loadu_ps(packet->e2[axis]));
+
+                __m128 tri_min = _mm_min_ps(v0, _mm_min_ps(v1, v2));
+                __m128 tri_max = _mm_max_ps(v0, _mm_max_ps(v1, v2));
+
+                outside = _mm_or_ps(outside, _mm_cmpgt_ps(tri_min, _mm_set1_ps(query_max[axis])));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(tri_max, _mm_set1_ps(query_min[axis])));
+            }
+            candidates = ~_mm_movemask_ps(outside) & 0xF;
+#endif
+
+            for (int lane = 0; lane < BVH_PACKET_WIDTH; lane++) {
+                if (!(candidates & (1 << lane)) || packet->triangle[lane] == BVH_INVALID_TRIANGLE) continue;
+
+                float v0[3], v1[3], v2[3];
+                bvh_packet_triangle(packet, lane, v0, v1, v2);
+
+                float on_segment[3], on_triangle[3];
+                float distance_squared;
+                if (is_sphere) {
+                    SDL_memcpy(on_segment, a, sizeof(float) * 3);
+                    bvh_closest_point_triangle(a, v0, v1, v2, on_triangle);
+
+                    float diff[3];
+                    bvh_sub(on_segment, on_triangle, diff);
+                    distance_squared = bvh_dot(diff, diff);
+                }
+                else {
+                    distance_squared = bvh_closest_points_segment_triangle(a, b, v0, v1, v2, on_segment, on_triangle);
+                }
+
+                if (distance_squared >= radius * radius) continue;
+
+                if (contacts_count == out_max) return contacts_count;
+                BvhContact* contact = &out_contacts[contacts_count++];
+
+                float distance = sqrtf(distance_squared);
+                float normal[3];
+
+                if (distance > FLT_EPSILON) {
+                    bvh_sub(on_segment, on_triangle, normal);
+                    for (int axis = 0; axis < 3; axis++) normal[axis] /= distance;
+                }
+                else {
+                    // On the surface, push out along the face normal towards the query start
+                    float e1[3], e2[3], to_start[3];
+                    bvh_sub(v1, v0, e1);
+                    bvh_sub(v2, v0, e2);
+                    bvh_cross(e1, e2, normal);
+
+                    float length = sqrtf(bvh_dot(normal, normal));
+                    bvh_sub(a, v0, to_start);
+                    float facing = bvh_dot(normal, to_start) < 0.0f ? -1.0f : 1.0f;
+                    for (int axis = 0; axis < 3; axis++) normal[axis] = length > 0.0f ? normal[axis] * facing / length : 0.0f;
+                }
+
+                SDL_memcpy(contact->position, on_triangle, sizeof(float) * 3);
+                SDL_memcpy(contact->normal, normal, sizeof(float) * 3);
+                contact->depth = radius - distance;
+                contact->triangle = packet->triangle[lane];
+            }
+        }
+    }
+
+    return contacts_count;
+}
+
+
+int bvh_overlap_sphere(const Bvh* bvh, const float center[3], float radius, BvhContact* out_contacts, int out_max)
+{
+    return bvh_overlap_capsule(bvh, center, center, radius, out_contacts, out_max);
+}
@@ -0,0 +1,417 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <math.h>
+#include <float.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+#include "log.h"
+
+/*
+** Clustered light assignment
+**
+** The view frustum is split into a CLUSTER_DIM_X * CLUSTER_DIM_Y grid of screen tiles and
+** CLUSTER_DIM_Z depth slices, exponentially spaced so near slices stay thin:
+**
+**     slice = floor(log(view_depth) * z_scale - z_bias)
+**
+** Every frame point lights are tested against the view space bounds of the clusters they can
+** touch, 4 clusters of a row at once (SSE2, scalar fallback elsewhere). Depth slices are shared
+** out between worker threads and the caller through an atomic counter, each slice is written
+** by one thread only. The result is compacted into what the shader reads:
+**
+**     ranges[cluster * 2 + 0] first entry in `indices`, ranges[cluster * 2 + 1] light count
+**     indices[] light indices, one run per cluster
+*/
+
+/*
+** Macros
+*/
+
+#define CLUSTER_DIM_X 16
+#define CLUSTER_DIM_Y 9
+#define CLUSTER_DIM_Z 24
+#define CLUSTERS_COUNT (CLUSTER_DIM_X * CLUSTER_DIM_Y * CLUSTER_DIM_Z)
+
+#define CLUSTER_MAX_LIGHTS 64 // Per cluster, the rest is dropped
+#define CLUSTER_MAX_WORKERS 8
+#define CLUSTER_PARALLEL_MIN_LIGHTS 32 // Fewer lights are assigned on the calling thread only
+
+/*
+** Structs
+*/
+
+// Two RGBA32F texels in the light buffer
+typedef struct {
+    float position[3]; // World space
+    float radius;
+    float color[3];
+    float intensity;
+} ClusterLight;
+
+typedef struct {
+    float fov_y; // Radians
+    float aspect;
+    float near;
+    float far;
+
+    float z_scale;
+    float z_bias;
+
+    // View space bounds per cluster, x fastest
+    float* bounds_min[3];
+    float* bounds_max[3];
+} ClusterGrid;
+
+typedef struct {
+    ClusterGrid grid;
+
+    // This frame's job
+    const ClusterLight* lights;
+    int lights_count;
+    float* view_lights[4]; // View space x, y, z and radius
+    int view_lights_capacity;
+    SDL_AtomicInt next_slice;
+
+    // Per cluster lists filled by the workers before compaction
+    uint16_t (*cluster_lights)[CLUSTER_MAX_LIGHTS];
+    uint32_t* cluster_counts;
+
+    SDL_Thread* threads[CLUSTER_MAX_WORKERS];
+    int threads_count;
+    SDL_Semaphore* start;
+    SDL_Semaphore* done;
+    SDL_AtomicInt quit;
+
+    // Stats of the last assignment
+    uint32_t references_count;
+    uint32_t dropped_count;
+    uint64_t assign_ns;
+} ClusterAssigner;
+
+/*
+** Declarations
+*/
+
+bool cluster_assigner_init(ClusterAssigner* assigner, int workers_count);
+void cluster_assigner_quit(ClusterAssigner* assigner);
+
+bool cluster_grid_build(ClusterGrid* grid, float fov_y, float aspect, float near, float far);
+void cluster_grid_free(ClusterGrid* grid);
+
+void cluster_assign(ClusterAssigner* assigner, const float view_mat[16], const ClusterLight* lights, int lights_count, uint32_t* out_ranges, uint16_t* out_indices, uint32_t max_indices);
+void cluster_assign_slices(ClusterAssigner* assigner);
+void cluster_assign_slice(ClusterAssigner* assigner, int slice);
+int cluster_worker(void* userdata);
+int cluster_depth_slice(const ClusterGrid* grid, float view_depth);
+
+/*
+** Implementation
+*/
+
+bool cluster_assigner_init(ClusterAssigner* assigner, int workers_count)
+{
+    SDL_memset(assigner, 0, sizeof(ClusterAssigner));
+
+    assigner->cluster_lights = SDL_malloc(sizeof(uint16_t) * CLUSTER_MAX_LIGHTS * CLUSTERS_COUNT);
+    assigner->cluster_counts = SDL_calloc(CLUSTERS_COUNT, sizeof(uint32_t));
+    if (assigner->cluster_lights == NULL || assigner->cluster_counts == NULL) {
+        LOG_ERROR("Failed to allocate the cluster light lists!");
+        return false;
+    }
+
+    assigner->start = SDL_CreateSemaphore(0);
+    assigner->done = SDL_CreateSemaphore(0);
+    if (assigner->start == NULL || assigner->done == NULL) {
+        LOG_ERROR("Failed to create the cluster worker semaphores! SDL error:\n%s", SDL_GetError());
+        return false;
+    }
+
+    // Workers are optional, the caller assigns every slice on its own without them
+    workers_count = SDL_clamp(workers_count, 0, CLUSTER_MAX_WORKERS);
+    for (int i = 0; i < workers_count; i++) {
+        assigner->threads[i] = SDL_CreateThread(cluster_worker, "cluster_worker", assigner);
+        if (assigner->threads[i] == NULL) {
+            LOG_WARNING("Failed to start cluster worker %d! SDL error:\n%s", i, SDL_GetError());
+            break;
+        }
+
+        assigner->threads_count++;
+    }
+
+    return true;
+}
+
+
+void cluster_assigner_quit(ClusterAssigner* assigner)
+{
+    SDL_SetAtomicInt(&assigner->quit, 1);
+    for (int i = 0; i < assigner->threads_count; i++) SDL_SignalSemaphore(assigner->start);
+    for (int i = 0; i < assigner->threads_count; i++) SDL_WaitThread(assigner->threads[i], NULL);
+
+    if (assigner->start != NULL) SDL_DestroySemaphore(assigner->start);
+    if (assigner->done != NULL) SDL_DestroySemaphore(assigner->done);
+
+    for (int axis = 0; axis < 4; axis++) SDL_aligned_free(assigner->view_lights[axis]);
+    SDL_free(assigner->cluster_lights);
+    SDL_free(assigner->cluster_counts);
+    cluster_grid_free(&assigner->grid);
+
+    SDL_memset(assigner, 0, sizeof(ClusterAssigner));
+}
+
+
+bool cluster_grid_build(ClusterGrid* grid, float fov_y, float aspect, float near, float far)
+{
+    if (grid->bounds_min[0] == NULL) {
+        for (int axis = 0; axis < 3; axis++) {
+            grid->bounds_min[axis] = SDL_aligned_alloc(16, sizeof(float) * CLUSTERS_COUNT);
+            grid->bounds_max[axis] = SDL_aligned_alloc(16, sizeof(float) * CLUSTERS_COUNT);
+
+            if (grid->bounds_min[axis] == NULL || grid->bounds_max[axis] == NULL) {
+                LOG_ERROR("Failed to allocate the cluster bounds!");
+                return false;
+            }
+        }
+    }
+
+    grid->fov_y = fov_y;
+    grid->aspect = aspect;
+    grid->near = near;
+    grid->far = far;
+
+    float log_ratio = logf(far / near);
+    grid->z_scale = CLUSTER_DIM_Z / log_ratio;
+    grid->z_bias = CLUSTER_DIM_Z * logf(near) / log_ratio;
+
+    float tan_y = tanf(fov_y * 0.5f);
+    float tan_x = tan_y * aspect;
+
+    for (int z = 0; z < CLUSTER_DIM_Z; z++) {
+        // The first slice reaches back to the eye, anything closer than `near` falls into it
+        float depth_near = z == 0 ? 0.0f : near * powf(far / near, (float)z / CLUSTER_DIM_Z);
+        float depth_far = near * powf(far / near, (float)(z + 1) / CLUSTER_DIM_Z);
+
+        for (int y = 0; y < CLUSTER_DIM_Y; y++) {
+            // Tile rows count up from the bottom of the screen like gl_FragCoord
+            float ndc_y0 = -1.0f + 2.0f * y / CLUSTER_DIM_Y;
+            float ndc_y1 = -1.0f + 2.0f * (y + 1) / CLUSTER_DIM_Y;
+
+            for (int x = 0; x < CLUSTER_DIM_X; x++) {
+                float ndc_x0 = -1.0f + 2.0f * x / CLUSTER_DIM_X;
+                float ndc_x1 = -1.0f + 2.0f * (x + 1) / CLUSTER_DIM_X;
+
+                // The tile's side planes go through the eye, so the corners at both depths bound it
+                float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+                float depths[2] = { depth_near, depth_far };
+                for (int d = 0; d < 2; d++) {
+                    float xs[2] = { ndc_x0 * tan_x * depths[d], ndc_x1 * tan_x * depths[d] };
+                    float ys[2] = { ndc_y0 * tan_y * depths[d], ndc_y1 * tan_y * depths[d] };
+
+                    for (int corner = 0; corner < 2; corner++) {
+                        min_x = SDL_min(min_x, xs[corner]);
+                        max_x = SDL_max(max_x, xs[corner]);
+                        min_y = SDL_min(min_y, ys[corner]);
+                        max_y = SDL_max(max_y, ys[corner]);
+                    }
+                }
+
+                int cluster = x + CLUSTER_DIM_X * (y + CLUSTER_DIM_Y * z);
+                grid->bounds_min[0][cluster] = min_x;
+                grid->bounds_min[1][cluster] = min_y;
+                grid->bounds_min[2][cluster] = -depth_far; // The camera looks down -z
+                grid->bounds_max[0][cluster] = max_x;
+                grid->bounds_max[1][cluster] = max_y;
+                grid->bounds_max[2][cluster] = -depth_near;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+void cluster_grid_free(ClusterGrid* grid)
+{
+    for (int axis = 0; axis < 3; axis++) {
+        SDL_aligned_free(grid->bounds_min[axis]);
+        SDL_aligned_free(grid->bounds_max[axis]);
+        grid->bounds_min[axis] = NULL;
+        grid->bounds_max[axis] = NULL;
+    }
+}
+
+
+int cluster_depth_slice(const ClusterGrid* grid, float view_depth)
+{
+    if (view_depth <= grid->near) return 0;
+
+    int slice = (int)floorf(logf(view_depth) * grid->z_scale - grid->z_bias);
+    return SDL_clamp(slice, 0, CLUSTER_DIM_Z - 1);
+}
+
+
+void cluster_assign(ClusterAssigner* assigner, const float view_mat[16], const ClusterLight* lights, int lights_count, uint32_t* out_ranges, uint16_t* out_indices, uint32_t max_indices)
+{
+    uint64_t assign_start_ns = SDL_GetTicksNS();
+
+    // View space spheres, only grown
+    if (lights_count > assigner->view_lights_capacity) {
+        int capacity = SDL_max(assigner->view_lights_capacity * 2, (lights_count + 3) & ~3);
+        assigner->view_lights_capacity = capacity;
+
+        for (int axis = 0; axis < 4; axis++) {
+            SDL_aligned_free(assigner->view_lights[axis]);
+            assigner->view_lights[axis] = SDL_aligned_alloc(16, sizeof(float) * capacity);
+
+            if (assigner->view_lights[axis] == NULL) {
+                LOG_ERROR("Failed to allocate %d view space lights!", capacity);
+                assigner->view_lights_capacity = 0;
+            }
+        }
+    }
+
+    if (lights_count > assigner->view_lights_capacity) lights_count = 0;
+
+    for (int i = 0; i < lights_count; i++) {
+        const float* p = lights[i].position;
+        for (int axis = 0; axis < 3; axis++) {
+            assigner->view_lights[axis][i] = view_mat[0 * 4 + axis] * p[0] + view_mat[1 * 4 + axis] * p[1] + view_mat[2 * 4 + axis] * p[2] + view_mat[3 * 4 + axis];
+        }
+        assigner->view_lights[3][i] = lights[i].radius;
+    }
+
+    assigner->lights = lights;
+    assigner->lights_count = lights_count;
+    SDL_SetAtomicInt(&assigner->next_slice, 0);
+
+    // The caller works on slices too, workers only help when there is enough to share
+    int helpers = lights_count >= CLUSTER_PARALLEL_MIN_LIGHTS ? assigner->threads_count : 0;
+    for (int i = 0; i < helpers; i++) SDL_SignalSemaphore(assigner->start);
+
+    cluster_assign_slices(assigner);
+
+    for (int i = 0; i < helpers; i++) SDL_WaitSemaphore(assigner->done);
+
+    // Compact into one run per cluster
+    uint32_t offset = 0;
+    uint32_t dropped_count = 0;
+    for (int cluster = 0; cluster < CLUSTERS_COUNT; cluster++) {
+        uint32_t count = assigner->cluster_counts[cluster];
+        if (count > CLUSTER_MAX_LIGHTS) {
+            dropped_count += count - CLUSTER_MAX_LIGHTS;
+            count = CLUSTER_MAX_LIGHTS;
+        }
+        if (offset + count > max_indices) {
+            dropped_count += offset + count - max_indices;
+            count = max_indices - offset;
+        }
+
+        SDL_memcpy(&out_indices[offset], assigner->cluster_lights[cluster], sizeof(uint16_t) * count);
+        out_ranges[cluster * 2 + 0] = offset;
+        out_ranges[cluster * 2 + 1] = count;
+        offset += count;
+    }
+
+    assigner->references_count = offset;
+    assigner->dropped_count = dropped_count;
+    assigner->assign_ns = SDL_GetTicksNS() - assign_start_ns;
+}
+
+
+int cluster_worker(void* userdata)
+{
+    ClusterAssigner* assigner = (ClusterAssigner*)userdata;
+
+    for (;;) {
+        SDL_WaitSemaphore(assigner->start);
+        if (SDL_GetAtomicInt(&assigner->quit)) break;
+
+        cluster_assign_slices(assigner);
+        SDL_SignalSemaphore(assigner->done);
+    }
+
+    return 0;
+}
+
+
+void cluster_assign_slices(ClusterAssigner* assigner)
+{
+    for (;;) {
+        int slice = SDL_AddAtomicInt(&assigner->next_slice, 1);
+        if (slice >= CLUSTER_DIM_Z) break;
+
+        cluster_assign_slice(assigner, slice);
+    }
+}
+
+
+void cluster_assign_slice(ClusterAssigner* assigner, int slice)
+{
+    const ClusterGrid* grid = &assigner->grid;
+    int first_cluster = slice * CLUSTER_DIM_X * CLUSTER_DIM_Y;
+
+    SDL_memset(&assigner->cluster_counts[first_cluster], 0, sizeof(uint32_t) * CLUSTER_DIM_X * CLUSTER_DIM_Y);
+
+    for (int light = 0; light < assigner->lights_count; light++) {
+        float cx = assigner->view_lights[0][light];
+        float cy = assigner->view_lights[1][light];
+        float cz = assigner->view_lights[2][light];
+        float radius = assigner->view_lights[3][light];
+
+        // Depth range first, most lights miss most slices
+        float depth = -cz;
+        if (depth + radius < grid->near || depth - radius > grid->far) continue;
+        if (slice < cluster_depth_slice(grid, depth - radius) || slice > cluster_depth_slice(grid, depth + radius)) continue;
+
+        for (int y = 0; y < CLUSTER_DIM_Y; y++) {
+            int row = first_cluster + y * CLUSTER_DIM_X;
+
+            for (int x = 0; x < CLUSTER_DIM_X; x += 4) {
+                int cluster = row + x;
+                int hits;
+
+#ifdef __SSE2__
+                // Squared distance from the center to each box against the squared radius
+                __m128 zero = _mm_setzero_ps();
+                __m128 c[3] = { _mm_set1_ps(cx), _mm_set1_ps(cy), _mm_set1_ps(cz) };
+                __m128 distance_sq = zero;
+
+                for (int axis = 0; axis < 3; axis++) {
+                    __m128 below = _mm_sub_ps(_mm_load_ps(&grid->bounds_min[axis][cluster]), c[axis]);
+                    __m128 above = _mm_sub_ps(c[axis], _mm_load_ps(&grid->bounds_max[axis][cluster]));
+                    __m128 d = _mm_max_ps(_mm_max_ps(below, above), zero);
+                    distance_sq = _mm_add_ps(distance_sq, _mm_mul_ps(d, d));
+                }
+
+                hits = _mm_movemask_ps(_mm_cmple_ps(distance_sq, _mm_set1_ps(radius * radius)));
+#else
+                hits = 0;
+                float center[3] = { cx, cy, cz };
+                for (int lane = 0; lane < 4; lane++) {
+                    float distance_sq = 0.0f;
+                    for (int axis = 0; axis < 3; axis++) {
+                        float below = grid->bounds_min[axis][cluster + lane] - center[axis];
+                        float above = center[axis] - grid->bounds_max[axis][cluster + lane];
+                        float d = SDL_max(SDL_max(below, above), 0.0f);
+                        distance_sq += d * d;
+                    }
+                    if (distance_sq <= radius * radius) hits |= 1 << lane;
+                }
+#endif
+
+                for (int lane = 0; hits != 0; lane++, hits >>= 1) {
+                    if (!(hits & 1)) continue;
+
+                    // Counts keep going past the list to report the overflow
+                    uint32_t count = assigner->cluster_counts[cluster + lane]++;
+                    if (count < CLUSTER_MAX_LIGHTS) assigner->cluster_lights[cluster + lane][count] = (uint16_t)light;
+                }
+            }
+        }
+    }
+}
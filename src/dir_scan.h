@@ -0,0 +1,533 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include "log.h"
+#include "arena.h"
+#include "str_utils.h"
+
+/*
+** Directory scanning
+**
+** PathMatcher: `-f:` include and `-x:` exclude globs compiled once. Patterns of the common
+** shapes skip the glob matcher entirely:
+**
+**     *.ext      extension set, one binary search per path for all of them
+**     *suffix    prefix*    *middle*    literal
+**
+** Anything else (`?`, `[...]`, several `*` in between literals) falls back to
+** `str_wildcard_match`. `*` matches `/` in both, like fnmatch without flags.
+**
+** DirScan: walks a tree with a pool of threads pulling directories from a shared stack. Each
+** worker keeps its files and paths to itself and publishes the subdirectories it found once
+** per directory. Files come back sorted by path, whatever order the threads ran in, with the
+** size from the walk so nothing is stat-ed twice.
+*/
+
+/*
+** Macros
+*/
+
+#define DIR_SCAN_MAX_THREADS 16
+#define DIR_SCAN_ARENA_BLOCK_SIZE (1024 * 1024)
+#define DIR_SCAN_MAX_PATH_LENGTH 512
+
+#ifdef WIN32
+    #define PATH_MATCH_COMPARE SDL_strncasecmp // PathMatchSpec ignores case
+#else
+    #define PATH_MATCH_COMPARE SDL_strncmp
+#endif
+
+/*
+** Structs
+*/
+
+typedef enum {
+    PATH_PATTERN_LITERAL,
+    PATH_PATTERN_PREFIX,
+    PATH_PATTERN_SUFFIX,
+    PATH_PATTERN_CONTAINS,
+    PATH_PATTERN_GLOB,
+} PathPatternKind;
+
+typedef struct {
+    PathPatternKind kind;
+    char* pattern; // Whole glob, kept for the fallback and logs
+    char* literal; // The part without the `*`s
+    size_t literal_length;
+} PathPattern;
+
+typedef struct {
+    // `*.ext` patterns as sorted extensions with the dot, e.g. ".blend"
+    char** extensions;
+    int extensions_count;
+
+    PathPattern* patterns;
+    int patterns_count;
+} PathPatternSet;
+
+typedef struct {
+    PathPatternSet include; // Empty includes everything
+    PathPatternSet exclude;
+} PathMatcher;
+
+typedef struct {
+    char* path;
+    size_t size;
+} DirScanFile;
+
+typedef struct DirScan DirScan;
+
+typedef struct {
+    DirScan* scan;
+
+    Arena arena; // Paths of the files below
+    DirScanFile* files;
+    int files_count;
+    int files_capacity;
+
+    char** found_dirs; // Subdirectories of the current directory, published together
+    int found_dirs_count;
+    int found_dirs_capacity;
+
+    uint64_t dirs_count;
+    uint64_t excluded_count;
+    uint64_t failed_count;
+} DirScanWorker;
+
+struct DirScan {
+    const PathMatcher* matcher;
+
+    SDL_Mutex* mutex;
+    SDL_Condition* wake;
+    char** pending_dirs; // Heap strings, freed once listed
+    int pending_dirs_count;
+    int pending_dirs_capacity;
+    int busy_count; // Workers inside a directory, the scan is over when 0 with nothing pending
+
+    DirScanWorker workers[DIR_SCAN_MAX_THREADS];
+    int workers_count;
+
+    // Result, merged and sorted
+    DirScanFile* files;
+    int files_count;
+    uint64_t dirs_count;
+    uint64_t excluded_count;
+    uint64_t failed_count;
+    uint64_t scan_ns;
+};
+
+/*
+** Declarations
+*/
+
+bool path_matcher_compile(PathMatcher* matcher, char** includes, int includes_count, char** excludes, int excludes_count);
+void path_matcher_free(PathMatcher* matcher);
+bool path_matcher_accepts(const PathMatcher* matcher, const char* path);
+
+bool path_pattern_set_compile(PathPatternSet* set, char** patterns, int patterns_count);
+void path_pattern_set_free(PathPatternSet* set);
+bool path_pattern_set_matches(const PathPatternSet* set, const char* path, size_t path_length);
+bool path_pattern_matches(const PathPattern* pattern, const char* path, size_t path_length);
+int path_compare_extensions(const void* a, const void* b);
+
+bool dir_scan(DirScan* scan, const char* root, const PathMatcher* matcher, int threads_count);
+void dir_scan_free(DirScan* scan);
+int dir_scan_worker(void* userdata);
+void dir_scan_list(DirScan* scan, DirScanWorker* worker, const char* dir_path);
+SDL_EnumerationResult dir_scan_list_entry(void* userdata, const char* dir_name, const char* file_name);
+bool dir_scan_push_dir(DirScan* scan, char* dir_path);
+int dir_scan_compare_files(const void* a, const void* b);
+
+/*
+** Implementation
+*/
+
+bool path_matcher_compile(PathMatcher* matcher, char** includes, int includes_count, char** excludes, int excludes_count)
+{
+    SDL_memset(matcher, 0, sizeof(PathMatcher));
+
+    if (!path_pattern_set_compile(&matcher->include, includes, includes_count) || !path_pattern_set_compile(&matcher->exclude, excludes, excludes_count)) {
+        LOG_ERROR("Failed to compile the path patterns!");
+        path_matcher_free(matcher);
+        return false;
+    }
+
+    return true;
+}
+
+
+void path_matcher_free(PathMatcher* matcher)
+{
+    path_pattern_set_free(&matcher->include);
+    path_pattern_set_free(&matcher->exclude);
+}
+
+
+bool path_matcher_accepts(const PathMatcher* matcher, const char* path)
+{
+    size_t path_length = strlen(path);
+
+    bool included = (matcher->include.extensions_count == 0 && matcher->include.patterns_count == 0)
+        || path_pattern_set_matches(&matcher->include, path, path_length);
+
+    return included && !path_pattern_set_matches(&matcher->exclude, path, path_length);
+}
+
+
+bool path_pattern_set_compile(PathPatternSet* set, char** patterns, int patterns_count)
+{
+    SDL_memset(set, 0, sizeof(PathPatternSet));
+    if (patterns_count == 0) return true;
+
+    set->extensions = SDL_calloc(patterns_count, sizeof(char*));
+    set->patterns = SDL_calloc(patterns_count, sizeof(PathPattern));
+    if (set->extensions == NULL || set->patterns == NULL) return false;
+
+    for (int i = 0; i < patterns_count; i++) {
+        const char* glob = patterns[i];
+        size_t length = strlen(glob);
+
+        bool special = strpbrk(glob, "?[]\\") != NULL;
+        bool leading_star = length > 0 && glob[0] == '*';
+        bool trailing_star = length > 1 && glob[length - 1] == '*';
+
+        const char* literal = glob + leading_star;
+        size_t literal_length = length - leading_star - trailing_star;
+        bool inner_star = memchr(literal, '*', literal_length) != NULL;
+
+        // `*.ext`, the extension of a path is what follows its last dot
+        if (!special && !inner_star && leading_star && !trailing_star && literal[0] == '.' && literal_length > 1
+            && memchr(literal + 1, '.', literal_length - 1) == NULL && memchr(literal, '/', literal_length) == NULL) {
+            set->extensions[set->extensions_count++] = SDL_strdup(literal);
+            continue;
+        }
+
+        PathPattern* pattern = &set->patterns[set->patterns_count++];
+        pattern->pattern = SDL_strdup(glob);
+        pattern->literal = SDL_strndup(literal, literal_length);
+        pattern->literal_length = literal_length;
+
+        if (special || inner_star) pattern->kind = PATH_PATTERN_GLOB;
+        else if (leading_star && trailing_star) pattern->kind = PATH_PATTERN_CONTAINS;
+        else if (leading_star) pattern->kind = PATH_PATTERN_SUFFIX;
+        else if (trailing_star) pattern->kind = PATH_PATTERN_PREFIX;
+        else pattern->kind = PATH_PATTERN_LITERAL;
+
+        if (pattern->pattern == NULL || pattern->literal == NULL) return false;
+    }
+
+    for (int i = 0; i < set->extensions_count; i++) {
+        if (set->extensions[i] == NULL) return false;
+    }
+
+    SDL_qsort(set->extensions, set->extensions_count, sizeof(char*), path_compare_extensions);
+
+    return true;
+}
+
+
+void path_pattern_set_free(PathPatternSet* set)
+{
+    for (int i = 0; i < set->extensions_count; i++) SDL_free(set->extensions[i]);
+    for (int i = 0; i < set->patterns_count; i++) {
+        SDL_free(set->patterns[i].pattern);
+        SDL_free(set->patterns[i].literal);
+    }
+
+    SDL_free(set->extensions);
+    SDL_free(set->patterns);
+    SDL_memset(set, 0, sizeof(PathPatternSet));
+}
+
+
+bool path_pattern_set_matches(const PathPatternSet* set, const char* path, size_t path_length)
+{
+    if (set->extensions_count > 0) {
+        const char* extension = SDL_strrchr(path, '.');
+        const char* name = SDL_strrchr(path, '/');
+
+        if (extension != NULL && (name == NULL || extension > name)) {
+            int low = 0;
+            int high = set->extensions_count - 1;
+
+            while (low <= high) {
+                int middle = (low + high) / 2;
+                int order = path_compare_extensions(&extension, &set->extensions[middle]);
+
+                if (order == 0) return true;
+                if (order < 0) high = middle - 1;
+                else low = middle + 1;
+            }
+        }
+    }
+
+    for (int i = 0; i < set->patterns_count; i++) {
+        if (path_pattern_matches(&set->patterns[i], path, path_length)) return true;
+    }
+
+    return false;
+}
+
+
+bool path_pattern_matches(const PathPattern* pattern, const char* path, size_t path_length)
+{
+    size_t n = pattern->literal_length;
+
+    switch (pattern->kind) {
+        case PATH_PATTERN_LITERAL: return path_length == n && PATH_MATCH_COMPARE(path, pattern->literal, n) == 0;
+        case PATH_PATTERN_PREFIX: return path_length >= n && PATH_MATCH_COMPARE(path, pattern->literal, n) == 0;
+        case PATH_PATTERN_SUFFIX: return path_length >= n && PATH_MATCH_COMPARE(path + path_length - n, pattern->literal, n) == 0;
+        case PATH_PATTERN_CONTAINS: {
+#ifdef WIN32
+            for (size_t i = 0; i + n <= path_length; i++) {
+                if (SDL_strncasecmp(path + i, pattern->literal, n) == 0) return true;
+            }
+            return false;
+#else
+            return SDL_strstr(path, pattern->literal) != NULL;
+#endif
+        }
+        case PATH_PATTERN_GLOB: return str_wildcard_match((char*)path, pattern->pattern);
+    }
+
+    return false;
+}
+
+
+int path_compare_extensions(const void* a, const void* b)
+{
+#ifdef WIN32
+    return SDL_strcasecmp(*(const char**)a, *(const char**)b);
+#else
+    return SDL_strcmp(*(const char**)a, *(const char**)b);
+#endif
+}
+
+
+bool dir_scan(DirScan* scan, const char* root, const PathMatcher* matcher, int threads_count)
+{
+    uint64_t scan_start_ns = SDL_GetTicksNS();
+
+    SDL_memset(scan, 0, sizeof(DirScan));
+    scan->matcher = matcher;
+
+    scan->mutex = SDL_CreateMutex();
+    scan->wake = SDL_CreateCondition();
+    if (scan->mutex == NULL || scan->wake == NULL) {
+        LOG_ERROR("Failed to create the scan mutex! SDL error:\n%s", SDL_GetError());
+        return false;
+    }
+
+    char* root_copy = SDL_strdup(root);
+    if (root_copy == NULL || !dir_scan_push_dir(scan, root_copy)) return false;
+
+    scan->workers_count = SDL_clamp(threads_count, 1, DIR_SCAN_MAX_THREADS);
+    for (int i = 0; i < scan->workers_count; i++) {
+        scan->workers[i].scan = scan;
+        arena_init(&scan->workers[i].arena, DIR_SCAN_ARENA_BLOCK_SIZE);
+    }
+
+    // The calling thread is worker 0
+    SDL_Thread* threads[DIR_SCAN_MAX_THREADS] = {0};
+    for (int i = 1; i < scan->workers_count; i++) {
+        threads[i] = SDL_CreateThread(dir_scan_worker, "dir_scan", &scan->workers[i]);
+        if (threads[i] == NULL) {
+            LOG_WARNING("Failed to start scan thread %d, scanning with fewer! SDL error:\n%s", i, SDL_GetError());
+        }
+    }
+
+    dir_scan_worker(&scan->workers[0]);
+
+    for (int i = 1; i < scan->workers_count; i++) {
+        if (threads[i] != NULL) SDL_WaitThread(threads[i], NULL);
+    }
+
+    // Merge, paths stay in the worker arenas
+    int files_count = 0;
+    for (int i = 0; i < scan->workers_count; i++) files_count += scan->workers[i].files_count;
+
+    scan->files = SDL_malloc(sizeof(DirScanFile) * SDL_max(files_count, 1));
+    if (scan->files == NULL) {
+        LOG_ERROR("Failed to allocate the list of %d scanned files!", files_count);
+        return false;
+    }
+
+    for (int i = 0; i < scan->workers_count; i++) {
+        DirScanWorker* worker = &scan->workers[i];
+
+        SDL_memcpy(&scan->files[scan->files_count], worker->files, sizeof(DirScanFile) * worker->files_count);
+        scan->files_count += worker->files_count;
+        scan->dirs_count += worker->dirs_count;
+        scan->excluded_count += worker->excluded_count;
+        scan->failed_count += worker->failed_count;
+    }
+
+    SDL_qsort(scan->files, scan->files_count, sizeof(DirScanFile), dir_scan_compare_files);
+
+    scan->scan_ns = SDL_GetTicksNS() - scan_start_ns;
+
+    return scan->failed_count == 0;
+}
+
+
+void dir_scan_free(DirScan* scan)
+{
+    for (int i = 0; i < scan->pending_dirs_count; i++) SDL_free(scan->pending_dirs[i]);
+    SDL_free(scan->pending_dirs);
+
+    for (int i = 0; i < scan->workers_count; i++) {
+        DirScanWorker* worker = &scan->workers[i];
+
+        arena_free(&worker->arena);
+        SDL_free(worker->files);
+        SDL_free(worker->found_dirs);
+    }
+
+    SDL_free(scan->files);
+    if (scan->mutex != NULL) SDL_DestroyMutex(scan->mutex);
+    if (scan->wake != NULL) SDL_DestroyCondition(scan->wake);
+
+    SDL_memset(scan, 0, sizeof(DirScan));
+}
+
+
+int dir_scan_worker(void* userdata)
+{
+    DirScanWorker* worker = (DirScanWorker*)userdata;
+    DirScan* scan = worker->scan;
+
+    SDL_LockMutex(scan->mutex);
+
+    for (;;) {
+        // Wait while others may still find more directories
+        while (scan->pending_dirs_count == 0 && scan->busy_count > 0) {
+            SDL_WaitCondition(scan->wake, scan->mutex);
+        }
+
+        if (scan->pending_dirs_count == 0) break;
+
+        char* dir_path = scan->pending_dirs[--scan->pending_dirs_count];
+        scan->busy_count++;
+        SDL_UnlockMutex(scan->mutex);
+
+        dir_scan_list(scan, worker, dir_path);
+        SDL_free(dir_path);
+
+        SDL_LockMutex(scan->mutex);
+
+        // Subdirectories go out in one batch
+        for (int i = 0; i < worker->found_dirs_count; i++) {
+            if (!dir_scan_push_dir(scan, worker->found_dirs[i])) worker->failed_count++;
+        }
+        worker->found_dirs_count = 0;
+        scan->busy_count--;
+
+        SDL_BroadcastCondition(scan->wake);
+    }
+
+    SDL_UnlockMutex(scan->mutex);
+
+    return 0;
+}
+
+
+void dir_scan_list(DirScan* scan, DirScanWorker* worker, const char* dir_path)
+{
+    worker->dirs_count++;
+
+    struct { DirScan* scan; DirScanWorker* worker; } list = { scan, worker };
+    if (!SDL_EnumerateDirectory(dir_path, dir_scan_list_entry, &list)) {
+        LOG_ERROR("Failed to list directory: %s! SDL error:\n%s", dir_path, SDL_GetError());
+        worker->failed_count++;
+    }
+}
+
+
+SDL_EnumerationResult dir_scan_list_entry(void* userdata, const char* dir_name, const char* file_name)
+{
+    struct { DirScan* scan; DirScanWorker* worker; }* list = userdata;
+    DirScanWorker* worker = list->worker;
+
+    char full_path[DIR_SCAN_MAX_PATH_LENGTH];
+    SDL_snprintf(full_path, DIR_SCAN_MAX_PATH_LENGTH, "%s%s", dir_name, file_name);
+
+    SDL_PathInfo info;
+    if (!SDL_GetPathInfo(full_path, &info)) {
+        LOG_ERROR("Failed to get path info for: %s! SDL error:\n%s", full_path, SDL_GetError());
+        worker->failed_count++;
+        return SDL_ENUM_CONTINUE;
+    }
+
+    if (info.type == SDL_PATHTYPE_DIRECTORY) {
+        if (worker->found_dirs_count == worker->found_dirs_capacity) {
+            int capacity = worker->found_dirs_capacity ? worker->found_dirs_capacity * 2 : 64;
+            char** found_dirs = SDL_realloc(worker->found_dirs, sizeof(char*) * capacity);
+            if (found_dirs == NULL) {
+                worker->failed_count++;
+                return SDL_ENUM_CONTINUE;
+            }
+
+            worker->found_dirs = found_dirs;
+            worker->found_dirs_capacity = capacity;
+        }
+
+        char* dir_path = SDL_strdup(full_path);
+        if (dir_path == NULL) worker->failed_count++;
+        else worker->found_dirs[worker->found_dirs_count++] = dir_path;
+    }
+    else if (info.type == SDL_PATHTYPE_FILE) {
+        if (!path_matcher_accepts(list->scan->matcher, full_path)) {
+            worker->excluded_count++;
+            return SDL_ENUM_CONTINUE;
+        }
+
+        if (worker->files_count == worker->files_capacity) {
+            int capacity = worker->files_capacity ? worker->files_capacity * 2 : 1024;
+            DirScanFile* files = SDL_realloc(worker->files, sizeof(DirScanFile) * capacity);
+            if (files == NULL) {
+                worker->failed_count++;
+                return SDL_ENUM_CONTINUE;
+            }
+
+            worker->files = files;
+            worker->files_capacity = capacity;
+        }
+
+        DirScanFile* file = &worker->files[worker->files_count];
+        file->path = arena_strdup(&worker->arena, full_path);
+        file->size = (size_t)info.size;
+
+        if (file->path == NULL) worker->failed_count++;
+        else worker->files_count++;
+    }
+
+    return SDL_ENUM_CONTINUE;
+}
+
+
+// Called with the mutex held, or before any worker runs
+bool dir_scan_push_dir(DirScan* scan, char* dir_path)
+{
+    if (scan->pending_dirs_count == scan->pending_dirs_capacity) {
+        int capacity = scan->pending_dirs_capacity ? scan->pending_dirs_capacity * 2 : 256;
+        char** pending_dirs = SDL_realloc(scan->pending_dirs, sizeof(char*) * capacity);
+        if (pending_dirs == NULL) {
+            LOG_ERROR("Failed to queue directory %s!", dir_path);
+            SDL_free(dir_path);
+            return false;
+        }
+
+        scan->pending_dirs = pending_dirs;
+        scan->pending_dirs_capacity = capacity;
+    }
+
+    scan->pending_dirs[scan->pending_dirs_count++] = dir_path;
+    return true;
+}
+
+
+int dir_scan_compare_files(const void* a, const void* b)
+{
+    return SDL_strcmp(((const DirScanFile*)a)->path, ((const DirScanFile*)b)->path);
+}
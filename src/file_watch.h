@@ -0,0 +1,210 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#ifdef __linux__
+    #include <sys/inotify.h>
+    #include <unistd.h>
+    #include <errno.h>
+#endif
+
+#include "log.h"
+
+/*
+** File watching
+**
+** Recursively watches a directory tree and reports the files that were written since the last
+** poll, relative to the root and deduplicated. Polling never blocks. inotify only, other
+** platforms get a watcher that fails to initialise.
+*/
+
+/*
+** Macros
+*/
+
+#define FILE_WATCH_MAX_DIRS 256
+#define FILE_WATCH_PATH_LENGTH 512
+
+/*
+** Structs
+*/
+
+typedef struct {
+    int wd;
+    char rel_path[FILE_WATCH_PATH_LENGTH]; // "" for the root, otherwise "dir/subdir/"
+} FileWatchDir;
+
+typedef struct {
+    int fd;
+    char root[FILE_WATCH_PATH_LENGTH];
+
+    FileWatchDir dirs[FILE_WATCH_MAX_DIRS];
+    int dirs_count;
+} FileWatch;
+
+/*
+** Declarations
+*/
+
+bool file_watch_init(FileWatch* watch, const char* root);
+void file_watch_quit(FileWatch* watch);
+int file_watch_poll(FileWatch* watch, char (*out_rel_paths)[FILE_WATCH_PATH_LENGTH], int out_max);
+
+bool file_watch_add_dir(FileWatch* watch, const char* rel_path);
+SDL_EnumerationResult file_watch_list_dir(void* userdata, const char* dir_name, const char* file_name);
+
+/*
+** Implementation
+*/
+
+bool file_watch_init(FileWatch* watch, const char* root)
+{
+    SDL_memset(watch, 0, sizeof(FileWatch));
+    watch->fd = -1;
+
+#ifdef __linux__
+    // Keep the root without a trailing slash, relative paths are appended after one
+    SDL_strlcpy(watch->root, root, FILE_WATCH_PATH_LENGTH);
+    size_t root_length = strlen(watch->root);
+    if (root_length > 1 && watch->root[root_length - 1] == '/') watch->root[root_length - 1] = '\0';
+
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch->fd < 0) {
+        LOG_ERROR("Failed to initialise inotify! errno: %d", errno);
+        return false;
+    }
+
+    return file_watch_add_dir(watch, "");
+#else
+    LOG_WARNING("File watching is only implemented on Linux, %s will not be watched.", root);
+    return false;
+#endif
+}
+
+
+void file_watch_quit(FileWatch* watch)
+{
+#ifdef __linux__
+    if (watch->fd >= 0) close(watch->fd);
+#endif
+    watch->fd = -1;
+    watch->dirs_count = 0;
+}
+
+
+bool file_watch_add_dir(FileWatch* watch, const char* rel_path)
+{
+#ifdef __linux__
+    if (watch->dirs_count == FILE_WATCH_MAX_DIRS) {
+        LOG_WARNING("Too many watched directories, ignoring %s", rel_path);
+        return false;
+    }
+
+    char full_path[FILE_WATCH_PATH_LENGTH];
+    SDL_snprintf(full_path, FILE_WATCH_PATH_LENGTH, "%s/%s", watch->root, rel_path);
+
+    // Editors often save by writing a temporary file and renaming it over the original
+    int wd = inotify_add_watch(watch->fd, full_path, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd < 0) {
+        LOG_ERROR("Failed to watch %s! errno: %d", full_path, errno);
+        return false;
+    }
+
+    FileWatchDir* dir = &watch->dirs[watch->dirs_count++];
+    dir->wd = wd;
+    SDL_strlcpy(dir->rel_path, rel_path, FILE_WATCH_PATH_LENGTH);
+
+    // Subdirectories
+    if (!SDL_EnumerateDirectory(full_path, file_watch_list_dir, watch)) {
+        LOG_ERROR("Failed to list directory: %s! SDL error:\n%s", full_path, SDL_GetError());
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+SDL_EnumerationResult file_watch_list_dir(void* userdata, const char* dir_name, const char* file_name)
+{
+    FileWatch* watch = (FileWatch*)userdata;
+
+    char full_path[FILE_WATCH_PATH_LENGTH];
+    SDL_snprintf(full_path, FILE_WATCH_PATH_LENGTH, "%s%s", dir_name, file_name);
+
+    SDL_PathInfo info;
+    if (SDL_GetPathInfo(full_path, &info) && info.type == SDL_PATHTYPE_DIRECTORY) {
+        // `dir_name` always starts with the root
+        char rel_path[FILE_WATCH_PATH_LENGTH];
+        SDL_snprintf(rel_path, FILE_WATCH_PATH_LENGTH, "%s/", full_path + strlen(watch->root) + 1);
+
+        file_watch_add_dir(watch, rel_path);
+    }
+
+    return SDL_ENUM_CONTINUE;
+}
+
+
+int file_watch_poll(FileWatch* watch, char (*out_rel_paths)[FILE_WATCH_PATH_LENGTH], int out_max)
+{
+    int out_count = 0;
+
+#ifdef __linux__
+    if (watch->fd < 0) return 0;
+
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    for (;;) {
+        ssize_t length = read(watch->fd, buffer, sizeof(buffer));
+        if (length <= 0) break; // EAGAIN, nothing left
+
+        for (char* ptr = buffer; ptr < buffer + length; ptr += sizeof(struct inotify_event) + ((struct inotify_event*)ptr)->len) {
+            const struct inotify_event* event = (const struct inotify_event*)ptr;
+            if (event->len == 0) continue;
+
+            FileWatchDir* dir = NULL;
+            for (int i = 0; i < watch->dirs_count; i++) {
+                if (watch->dirs[i].wd == event->wd) {
+                    dir = &watch->dirs[i];
+                    break;
+                }
+            }
+            if (dir == NULL) continue;
+
+            char rel_path[FILE_WATCH_PATH_LENGTH];
+            SDL_snprintf(rel_path, FILE_WATCH_PATH_LENGTH, "%s%s", dir->rel_path, event->name);
+
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    SDL_strlcat(rel_path, "/", FILE_WATCH_PATH_LENGTH);
+                    file_watch_add_dir(watch, rel_path);
+                }
+                continue;
+            }
+
+            // New files are reported once they are closed after writing
+            if (!(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))) continue;
+
+            bool duplicate = false;
+            for (int i = 0; i < out_count; i++) {
+                if (SDL_strcmp(out_rel_paths[i], rel_path) == 0) {
+                    duplicate = true;
+                    break;
+                }
+            }
+
+            if (duplicate) continue;
+
+            if (out_count == out_max) {
+                LOG_WARNING("Too many changed files in one poll, dropping %s", rel_path);
+                continue;
+            }
+
+            SDL_strlcpy(out_rel_paths[out_count++], rel_path, FILE_WATCH_PATH_LENGTH);
+        }
+    }
+#endif
+
+    return out_count;
+}
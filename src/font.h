@@ -0,0 +1,242 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include "log.h"
+#include "arena.h"
+
+/*
+** Overlay font
+**
+** `pack` bakes the built in 8x8 bitmap font (public domain font8x8, printable ASCII) into a
+** single channel atlas at `<assets root>/FONT_OVERLAY_PATH`:
+**
+**     FontHeader, atlas texels (atlas_width * atlas_height bytes, top row first)
+**
+** Glyphs sit on a grid of `columns` cells in character order. The cell after the last glyph is
+** solid, so untextured quads can sample it and batch together with text.
+*/
+
+/*
+** Macros
+*/
+
+#define FONT_MAGIC "FNT1"
+#define FONT_VERSION 1
+#define FONT_OVERLAY_PATH "fonts/overlay.font"
+
+#define FONT_GLYPH_SIZE 8
+#define FONT_FIRST_CHAR 32
+#define FONT_CHARS_COUNT 95
+#define FONT_COLUMNS 16
+
+/*
+** Structs
+*/
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t glyph_width;
+    uint32_t glyph_height;
+    uint32_t first_char;
+    uint32_t chars_count;
+    uint32_t columns;
+    uint32_t solid_cell; // Fully opaque cell index
+    uint32_t atlas_width;
+    uint32_t atlas_height;
+} FontHeader;
+
+/*
+** Declarations
+*/
+
+void* font_bake(Arena* arena, size_t* out_size);
+bool font_header_valid(const FontHeader* header, uint64_t file_size);
+void font_cell_uv(const FontHeader* header, uint32_t cell, float out_uv[4]);
+
+/*
+** Implementation
+*/
+
+// One byte per row, bit 0 is the leftmost pixel
+static const uint8_t font_glyphs[FONT_CHARS_COUNT][FONT_GLYPH_SIZE] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+    { 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 }, // '!'
+    { 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '"'
+    { 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 }, // '#'
+    { 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 }, // '$'
+    { 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 }, // '%'
+    { 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 }, // '&'
+    { 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '\''
+    { 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 }, // '('
+    { 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 }, // ')'
+    { 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 }, // '*'
+    { 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 }, // '+'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ','
+    { 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 }, // '-'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // '.'
+    { 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 }, // '/'
+    { 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 }, // '0'
+    { 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 }, // '1'
+    { 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 }, // '2'
+    { 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 }, // '3'
+    { 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 }, // '4'
+    { 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 }, // '5'
+    { 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 }, // '6'
+    { 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 }, // '7'
+    { 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 }, // '8'
+    { 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 }, // '9'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // ':'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ';'
+    { 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 }, // '<'
+    { 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 }, // '='
+    { 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 }, // '>'
+    { 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 }, // '?'
+    { 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 }, // '@'
+    { 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 }, // 'A'
+    { 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 }, // 'B'
+    { 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 }, // 'C'
+    { 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 }, // 'D'
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 }, // 'E'
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 }, // 'F'
+    { 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 }, // 'G'
+    { 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 }, // 'H'
+    { 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'I'
+    { 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 }, // 'J'
+    { 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 }, // 'K'
+    { 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 }, // 'L'
+    { 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 }, // 'M'
+    { 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 }, // 'N'
+    { 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 }, // 'O'
+    { 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 }, // 'P'
+    { 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 }, // 'Q'
+    { 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 }, // 'R'
+    { 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 }, // 'S'
+    { 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'T'
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 }, // 'U'
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // 'V'
+    { 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 }, // 'W'
+    { 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 }, // 'X'
+    { 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 }, // 'Y'
+    { 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 }, // 'Z'
+    { 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 }, // '['
+    { 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 }, // '\\'
+    { 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 }, // ']'
+    { 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 }, // '^'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF }, // '_'
+    { 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '`'
+    { 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 }, // 'a'
+    { 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 }, // 'b'
+    { 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 }, // 'c'
+    { 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 }, // 'd'
+    { 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 }, // 'e'
+    { 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 }, // 'f'
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // 'g'
+    { 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 }, // 'h'
+    { 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'i'
+    { 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E }, // 'j'
+    { 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 }, // 'k'
+    { 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'l'
+    { 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 }, // 'm'
+    { 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 }, // 'n'
+    { 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 }, // 'o'
+    { 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F }, // 'p'
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 }, // 'q'
+    { 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 }, // 'r'
+    { 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 }, // 's'
+    { 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 }, // 't'
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 }, // 'u'
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // 'v'
+    { 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 }, // 'w'
+    { 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 }, // 'x'
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // 'y'
+    { 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 }, // 'z'
+    { 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 }, // '{'
+    { 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 }, // '|'
+    { 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 }, // '}'
+    { 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '~'
+};
+
+
+void* font_bake(Arena* arena, size_t* out_size)
+{
+    uint32_t cells_count = FONT_CHARS_COUNT + 1;
+    uint32_t rows = (cells_count + FONT_COLUMNS - 1) / FONT_COLUMNS;
+
+    FontHeader header;
+    SDL_memset(&header, 0, sizeof(FontHeader));
+    SDL_memcpy(header.magic, FONT_MAGIC, 4);
+    header.version = FONT_VERSION;
+    header.glyph_width = FONT_GLYPH_SIZE;
+    header.glyph_height = FONT_GLYPH_SIZE;
+    header.first_char = FONT_FIRST_CHAR;
+    header.chars_count = FONT_CHARS_COUNT;
+    header.columns = FONT_COLUMNS;
+    header.solid_cell = FONT_CHARS_COUNT;
+    header.atlas_width = FONT_COLUMNS * FONT_GLYPH_SIZE;
+    header.atlas_height = rows * FONT_GLYPH_SIZE;
+
+    size_t atlas_size = (size_t)header.atlas_width * header.atlas_height;
+    size_t baked_size = sizeof(FontHeader) + atlas_size;
+
+    unsigned char* baked = (unsigned char*)arena_alloc(arena, baked_size);
+    if (!baked) {
+        LOG_ERROR("Failed to allocate %zu bytes for the font atlas!", baked_size);
+        return NULL;
+    }
+
+    SDL_memcpy(baked, &header, sizeof(FontHeader));
+
+    unsigned char* atlas = baked + sizeof(FontHeader);
+    SDL_memset(atlas, 0, atlas_size);
+
+    for (uint32_t cell = 0; cell < cells_count; cell++) {
+        uint32_t cell_x = (cell % FONT_COLUMNS) * FONT_GLYPH_SIZE;
+        uint32_t cell_y = (cell / FONT_COLUMNS) * FONT_GLYPH_SIZE;
+
+        for (int y = 0; y < FONT_GLYPH_SIZE; y++) {
+            unsigned char* row = atlas + (size_t)(cell_y + y) * header.atlas_width + cell_x;
+
+            for (int x = 0; x < FONT_GLYPH_SIZE; x++) {
+                bool set = cell == header.solid_cell || (font_glyphs[cell][y] >> x) & 1;
+                row[x] = set ? 255 : 0;
+            }
+        }
+    }
+
+    if (out_size != NULL) *out_size = baked_size;
+
+    return baked;
+}
+
+
+bool font_header_valid(const FontHeader* header, uint64_t file_size)
+{
+    if (SDL_memcmp(header->magic, FONT_MAGIC, 4) != 0 || header->version != FONT_VERSION) return false;
+    if (header->glyph_width == 0 || header->glyph_height == 0 || header->columns == 0) return false;
+    if (header->atlas_width == 0 || header->atlas_height == 0) return false;
+
+    // The overlay falls back to '?' for characters outside the font
+    if (header->chars_count == 0 || '?' < header->first_char || '?' - header->first_char >= header->chars_count) return false;
+
+    // Every glyph cell and the solid cell have to sit inside the atlas
+    uint64_t cells_count = SDL_max((uint64_t)header->chars_count, (uint64_t)header->solid_cell + 1);
+    uint64_t rows_count = (cells_count + header->columns - 1) / header->columns;
+    if ((uint64_t)header->columns * header->glyph_width > header->atlas_width) return false;
+    if (rows_count * header->glyph_height > header->atlas_height) return false;
+
+    return sizeof(FontHeader) + (uint64_t)header->atlas_width * header->atlas_height <= file_size;
+}
+
+
+void font_cell_uv(const FontHeader* header, uint32_t cell, float out_uv[4])
+{
+    float cell_u = (float)header->glyph_width / (float)header->atlas_width;
+    float cell_v = (float)header->glyph_height / (float)header->atlas_height;
+
+    out_uv[0] = (cell % header->columns) * cell_u;
+    out_uv[1] = (cell / header->columns) * cell_v;
+    out_uv[2] = out_uv[0] + cell_u;
+    out_uv[3] = out_uv[1] + cell_v;
+}
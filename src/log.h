@@ -0,0 +1,383 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+/*
+** Logging
+**
+** LOG_* calls below LOG_MIN_LEVEL compile to nothing, arguments included. The rest format
+** their message straight into a slot of a lock-free MPSC ring and return; a background
+** thread drains the ring in batches to SDL_Log and/or a binary log file (see log_decode.c).
+**
+** Before `log_init()` and after `log_quit()` messages are written synchronously. If the ring
+** is full the message is dropped and counted, logging never blocks the caller. Messages that
+** don't fit a slot (shader compile logs and such) carry a heap copy the flusher writes and
+** frees, they're truncated to the slot only if that allocation fails.
+*/
+
+/*
+** Macros
+*/
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_CRITICAL 4
+
+#ifndef LOG_MIN_LEVEL
+    #ifdef NDEBUG
+        #define LOG_MIN_LEVEL LOG_LEVEL_INFO
+    #else
+        #define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+    #endif
+#endif
+
+#define LOG_RING_CAPACITY 1024 // Must be a power of two
+#define LOG_MESSAGE_LENGTH 464 // Keeps a record at 512 bytes
+#define LOG_FLUSH_INTERVAL_MS 10
+#define LOG_BINARY_BATCH_SIZE (64 * 1024)
+
+#define LOG_BINARY_MAGIC "F02LOG"
+#define LOG_BINARY_VERSION 1
+
+// Compilers without `__FILE_NAME__` still fold the builtin on a literal
+#ifdef __FILE_NAME__
+    #define __FILENAME__ __FILE_NAME__
+#else
+    #define __FILENAME__ (__builtin_strrchr(__FILE__, '/') ? __builtin_strrchr(__FILE__, '/') + 1 : __FILE__)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+    #define LOG_DEBUG(format_string, ...) \
+        log_write(LOG_LEVEL_DEBUG, __FILENAME__, __LINE__, __func__, format_string, ##__VA_ARGS__)
+#else
+    #define LOG_DEBUG(format_string, ...) ((void)0)
+#endif
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+    #define LOG_INFO(format_string, ...) \
+        log_write(LOG_LEVEL_INFO, __FILENAME__, __LINE__, __func__, format_string, ##__VA_ARGS__)
+#else
+    #define LOG_INFO(format_string, ...) ((void)0)
+#endif
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARNING
+    #define LOG_WARNING(format_string, ...) \
+        log_write(LOG_LEVEL_WARNING, __FILENAME__, __LINE__, __func__, format_string, ##__VA_ARGS__)
+#else
+    #define LOG_WARNING(format_string, ...) ((void)0)
+#endif
+#if LOG_MIN_LEVEL <= LOG_LEVEL_ERROR
+    #define LOG_ERROR(format_string, ...) \
+        log_write(LOG_LEVEL_ERROR, __FILENAME__, __LINE__, __func__, format_string, ##__VA_ARGS__)
+#else
+    #define LOG_ERROR(format_string, ...) ((void)0)
+#endif
+#define LOG_CRITICAL(format_string, ...) \
+    log_write(LOG_LEVEL_CRITICAL, __FILENAME__, __LINE__, __func__, format_string, ##__VA_ARGS__)
+
+/*
+** Structs
+*/
+
+typedef struct {
+    SDL_AtomicU32 sequence;
+
+    uint8_t level;
+    int line;
+    const char* file; // Literals, no copy needed
+    const char* func;
+    uint64_t timestamp_ns;
+    char* long_message; // Whole message when it doesn't fit `message`, freed by the flusher
+
+    char message[LOG_MESSAGE_LENGTH];
+} LogRecord;
+
+typedef struct {
+    LogRecord* records;
+    SDL_AtomicU32 enqueue_pos;
+    uint32_t dequeue_pos; // Flusher thread only
+
+    SDL_AtomicInt running;
+    SDL_AtomicInt dropped_count;
+    SDL_Semaphore* wake;
+    SDL_Thread* flusher;
+
+    bool text_output;
+    SDL_IOStream* binary_output;
+    unsigned char* binary_batch;
+    size_t binary_batch_used;
+} Logger;
+
+static const char* log_level_prefixes[] = {
+    "debug:   ",
+    "info:    ",
+    "warning: ",
+    "error:   ",
+    "critical:",
+};
+
+/*
+** Declarations
+*/
+
+bool log_init(bool text_output, const char* binary_output_path);
+void log_quit();
+
+void log_write(int level, const char* file, int line, const char* func, const char* fmt, ...) __attribute__((format(printf, 5, 6)));
+void log_write_direct(int level, const char* file, int line, const char* func, const char* fmt, va_list args);
+
+int log_flusher(void* userdata);
+void log_flush_record(LogRecord* record);
+void log_batch_append(const void* data, size_t size);
+void log_batch_flush();
+
+/*
+** Implementation
+*/
+
+Logger logger = {0};
+SDL_AtomicInt log_writers_count = {0}; // Producers between checking `running` and publishing, outlives `logger`
+
+bool log_init(bool text_output, const char* binary_output_path)
+{
+    logger.records = (LogRecord*)SDL_calloc(LOG_RING_CAPACITY, sizeof(LogRecord));
+    if (!logger.records) {
+        SDL_Log("Failed to allocate the log ring!");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < LOG_RING_CAPACITY; i++) {
+        SDL_SetAtomicU32(&logger.records[i].sequence, i);
+    }
+
+    SDL_SetAtomicU32(&logger.enqueue_pos, 0);
+    logger.dequeue_pos = 0;
+    SDL_SetAtomicInt(&logger.dropped_count, 0);
+
+    logger.text_output = text_output;
+
+    if (binary_output_path != NULL) {
+        logger.binary_output = SDL_IOFromFile(binary_output_path, "wb");
+        if (!logger.binary_output) {
+            SDL_Log("Failed to open binary log %s! SDL error:\n%s", binary_output_path, SDL_GetError());
+        }
+        else {
+            logger.binary_batch = (unsigned char*)SDL_malloc(LOG_BINARY_BATCH_SIZE);
+
+            uint32_t version = SDL_Swap32LE(LOG_BINARY_VERSION);
+            SDL_WriteIO(logger.binary_output, LOG_BINARY_MAGIC, strlen(LOG_BINARY_MAGIC));
+            SDL_WriteIO(logger.binary_output, &version, sizeof(version));
+        }
+    }
+
+    logger.wake = SDL_CreateSemaphore(0);
+    SDL_SetAtomicInt(&logger.running, 1);
+
+    logger.flusher = SDL_CreateThread(log_flusher, "log_flusher", NULL);
+    if (!logger.flusher) {
+        SDL_Log("Failed to start the log flusher thread! SDL error:\n%s", SDL_GetError());
+        SDL_SetAtomicInt(&logger.running, 0);
+        return false;
+    }
+
+    return true;
+}
+
+
+void log_quit()
+{
+    if (logger.flusher == NULL) return;
+
+    // Producers that still saw the logger running publish before the flusher drains the rest
+    // and exits, whether their threads were joined or not
+    SDL_SetAtomicInt(&logger.running, 0);
+    while (SDL_GetAtomicInt(&log_writers_count) > 0) SDL_Delay(1);
+
+    SDL_SignalSemaphore(logger.wake);
+    SDL_WaitThread(logger.flusher, NULL);
+    logger.flusher = NULL;
+
+    int dropped_count = SDL_GetAtomicInt(&logger.dropped_count);
+    if (dropped_count > 0) {
+        SDL_Log("warning:  log.h - %d log messages were dropped, the log ring was full.", dropped_count);
+    }
+
+    if (logger.binary_output) SDL_CloseIO(logger.binary_output);
+    SDL_free(logger.binary_batch);
+    SDL_DestroySemaphore(logger.wake);
+    SDL_free(logger.records);
+
+    SDL_memset(&logger, 0, sizeof(Logger));
+}
+
+
+void log_write(int level, const char* file, int line, const char* func, const char* fmt, ...)
+{
+    va_list args;
+
+    // Counted before `running` is read, `log_quit` clears it first and then waits for the count
+    SDL_AddAtomicInt(&log_writers_count, 1);
+
+    if (!SDL_GetAtomicInt(&logger.running)) {
+        SDL_AddAtomicInt(&log_writers_count, -1);
+
+        va_start(args, fmt);
+        log_write_direct(level, file, line, func, fmt, args);
+        va_end(args);
+        return;
+    }
+
+    // Claim a slot
+    LogRecord* record = NULL;
+    uint32_t pos = SDL_GetAtomicU32(&logger.enqueue_pos);
+    for (;;) {
+        record = &logger.records[pos & (LOG_RING_CAPACITY - 1)];
+
+        int32_t diff = (int32_t)(SDL_GetAtomicU32(&record->sequence) - pos);
+        if (diff == 0) {
+            if (SDL_CompareAndSwapAtomicU32(&logger.enqueue_pos, pos, pos + 1)) break;
+        }
+        else if (diff < 0) {
+            // Full
+            SDL_AddAtomicInt(&logger.dropped_count, 1);
+            SDL_AddAtomicInt(&log_writers_count, -1);
+            return;
+        }
+
+        pos = SDL_GetAtomicU32(&logger.enqueue_pos);
+    }
+
+    record->level = (uint8_t)level;
+    record->line = line;
+    record->file = file;
+    record->func = func;
+    record->timestamp_ns = SDL_GetTicksNS();
+
+    va_start(args, fmt);
+    int message_length = SDL_vsnprintf(record->message, LOG_MESSAGE_LENGTH, fmt, args);
+    va_end(args);
+
+    // Doesn't fit, keep the truncated slot copy if the whole one can't be allocated
+    record->long_message = NULL;
+    if (message_length >= LOG_MESSAGE_LENGTH) {
+        record->long_message = (char*)SDL_malloc(message_length + 1);
+        if (record->long_message) {
+            va_start(args, fmt);
+            SDL_vsnprintf(record->long_message, message_length + 1, fmt, args);
+            va_end(args);
+        }
+    }
+
+    SDL_MemoryBarrierRelease();
+    SDL_SetAtomicU32(&record->sequence, pos + 1);
+
+    // Errors shouldn't wait for the next flush interval
+    if (level >= LOG_LEVEL_ERROR) SDL_SignalSemaphore(logger.wake);
+
+    SDL_AddAtomicInt(&log_writers_count, -1);
+}
+
+
+void log_write_direct(int level, const char* file, int line, const char* func, const char* fmt, va_list args)
+{
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int message_length = SDL_vsnprintf(NULL, 0, fmt, args_copy);
+    va_end(args_copy);
+
+    char* message = (char*)SDL_malloc(message_length + 1);
+    if (!message) return;
+
+    SDL_vsnprintf(message, message_length + 1, fmt, args);
+
+    SDL_Log("%s %s:%d %s - %s\n", log_level_prefixes[level], file, line, func, message);
+    SDL_free(message);
+}
+
+
+int log_flusher(void* userdata)
+{
+    (void)userdata;
+
+    for (;;) {
+        bool running = SDL_GetAtomicInt(&logger.running);
+
+        // Drain
+        for (;;) {
+            LogRecord* record = &logger.records[logger.dequeue_pos & (LOG_RING_CAPACITY - 1)];
+
+            int32_t diff = (int32_t)(SDL_GetAtomicU32(&record->sequence) - (logger.dequeue_pos + 1));
+            if (diff < 0) break; // Empty
+
+            SDL_MemoryBarrierAcquire();
+
+            log_flush_record(record);
+            SDL_free(record->long_message);
+            record->long_message = NULL;
+
+            SDL_SetAtomicU32(&record->sequence, logger.dequeue_pos + LOG_RING_CAPACITY);
+            logger.dequeue_pos++;
+        }
+
+        log_batch_flush();
+
+        if (!running) break;
+
+        SDL_WaitSemaphoreTimeout(logger.wake, LOG_FLUSH_INTERVAL_MS);
+    }
+
+    return 0;
+}
+
+
+void log_flush_record(LogRecord* record)
+{
+    const char* message = record->long_message ? record->long_message : record->message;
+
+    if (logger.text_output) {
+        SDL_Log("%s %s:%d %s - %s\n", log_level_prefixes[record->level], record->file, record->line, record->func, message);
+    }
+
+    if (logger.binary_batch) {
+        // Record: u64 timestamp_ns, u8 level, u32 line, u16 file/func/message lengths, then the strings.
+        // All little-endian, decoded by log_decode.
+        uint64_t timestamp_ns = SDL_Swap64LE(record->timestamp_ns);
+        uint32_t line = SDL_Swap32LE((uint32_t)record->line);
+        uint16_t file_length = (uint16_t)strlen(record->file);
+        uint16_t func_length = (uint16_t)strlen(record->func);
+        uint16_t message_length = (uint16_t)SDL_min(strlen(message), UINT16_MAX);
+        uint16_t lengths[3] = { SDL_Swap16LE(file_length), SDL_Swap16LE(func_length), SDL_Swap16LE(message_length) };
+
+        log_batch_append(&timestamp_ns, sizeof(timestamp_ns));
+        log_batch_append(&record->level, sizeof(record->level));
+        log_batch_append(&line, sizeof(line));
+        log_batch_append(lengths, sizeof(lengths));
+        log_batch_append(record->file, file_length);
+        log_batch_append(record->func, func_length);
+        log_batch_append(message, message_length);
+    }
+}
+
+
+void log_batch_append(const void* data, size_t size)
+{
+    if (logger.binary_batch_used + size > LOG_BINARY_BATCH_SIZE) log_batch_flush();
+
+    // Bigger than a whole batch, write through
+    if (size > LOG_BINARY_BATCH_SIZE) {
+        SDL_WriteIO(logger.binary_output, data, size);
+        return;
+    }
+
+    SDL_memcpy(logger.binary_batch + logger.binary_batch_used, data, size);
+    logger.binary_batch_used += size;
+}
+
+
+void log_batch_flush()
+{
+    if (logger.binary_batch_used == 0) return;
+
+    SDL_WriteIO(logger.binary_output, logger.binary_batch, logger.binary_batch_used);
+    logger.binary_batch_used = 0;
+}
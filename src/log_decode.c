@@ -0,0 +1,79 @@
+#include "log.h"
+
+/*
+** Decodes a binary log written with `-l:<path>` back into text, offline.
+**
+** Usage: log_decode <log file>
+*/
+
+/*
+** Implementation
+*/
+
+int main(int args_count, char* args[])
+{
+    if (args_count < 2) {
+        SDL_Log("Usage: log_decode <log file>");
+        return 1;
+    }
+
+    SDL_IOStream* in_file = SDL_IOFromFile(args[1], "rb");
+    if (!in_file) {
+        SDL_Log("Failed to open %s! SDL error:\n%s", args[1], SDL_GetError());
+        return 1;
+    }
+
+    // Header
+    char magic[sizeof(LOG_BINARY_MAGIC)] = {0};
+    uint32_t version = 0;
+    SDL_ReadIO(in_file, magic, strlen(LOG_BINARY_MAGIC));
+    SDL_ReadU32LE(in_file, &version);
+
+    if (SDL_strcmp(magic, LOG_BINARY_MAGIC) != 0 || version != LOG_BINARY_VERSION) {
+        SDL_Log("%s is not a version %d binary log!", args[1], LOG_BINARY_VERSION);
+        SDL_CloseIO(in_file);
+        return 1;
+    }
+
+    // Records
+    char file[UINT16_MAX + 1];
+    char func[UINT16_MAX + 1];
+    char message[UINT16_MAX + 1];
+
+    int records_count = 0;
+    for (;;) {
+        uint64_t timestamp_ns;
+        uint8_t level;
+        uint32_t line;
+        uint16_t file_length, func_length, message_length;
+
+        if (!SDL_ReadU64LE(in_file, &timestamp_ns)) break; // EOF
+
+        bool read_ok = (
+            SDL_ReadU8(in_file, &level)
+            && SDL_ReadU32LE(in_file, &line)
+            && SDL_ReadU16LE(in_file, &file_length)
+            && SDL_ReadU16LE(in_file, &func_length)
+            && SDL_ReadU16LE(in_file, &message_length)
+            && SDL_ReadIO(in_file, file, file_length) == file_length
+            && SDL_ReadIO(in_file, func, func_length) == func_length
+            && SDL_ReadIO(in_file, message, message_length) == message_length
+        );
+
+        if (!read_ok || level > LOG_LEVEL_CRITICAL) {
+            SDL_Log("Truncated or corrupt record #%d, stopping.", records_count);
+            break;
+        }
+
+        file[file_length] = '\0';
+        func[func_length] = '\0';
+        message[message_length] = '\0';
+
+        SDL_Log("[%12.6f] %s %s:%u %s - %s", timestamp_ns / 1e9, log_level_prefixes[level], file, line, func, message);
+        records_count++;
+    }
+
+    SDL_CloseIO(in_file);
+
+    return 0;
+}
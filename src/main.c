@@ -1,4 +1,7 @@
+// Tools that run the engine under their own `main` (bench.c) include this file with ENGINE_NO_APP
+#ifndef ENGINE_NO_APP
 #define SDL_MAIN_USE_CALLBACKS 1
+#endif
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_main.h>
 
@@ -6,6 +9,25 @@
 
 #include <cglm/cglm.h>
 
+#include "log.h"
+#include "str_utils.h"
+#include "shader_features.h"
+#include "resources.h"
+#include "file_watch.h"
+#include "mdl.h"
+#include "bvh.h"
+#include "texture_format.h"
+#include "overlay.h"
+#include "transform.h"
+#include "clusters.h"
+#include "vfs.h"
+
+// stb_image allocates through this arena while a texture is being decoded (heap if NULL)
+Arena* stbi_arena = NULL;
+
+#define STBI_MALLOC(size) arena_alloc(stbi_arena, size)
+#define STBI_REALLOC(ptr, size) arena_realloc(stbi_arena, ptr, size)
+#define STBI_FREE(ptr) arena_release(stbi_arena, ptr)
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
@@ -16,35 +38,83 @@
 
 #define PROJECT_NAME "022_f"
 #define ASSETS_FILE_PATH "assets.bin"
+#define ASSETS_ROOT_PATH "./assets" // Root `pack` is run on, archive paths start with it
 #define MAX_PATH_LENGTH 512
 
-#define __FILENAME__ (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
-
-#define LOG_DEBUG(format_string, ...) \
-    SDL_Log("debug:    %s:%d %s - " format_string "\n", __FILENAME__, __LINE__, __func__, ##__VA_ARGS__)
-#define LOG_INFO(format_string, ...) \
-    SDL_Log("info:     %s:%d %s - " format_string "\n", __FILENAME__, __LINE__, __func__, ##__VA_ARGS__)
-#define LOG_WARNING(format_string, ...) \
-    SDL_Log("warning:  %s:%d %s - " format_string "\n", __FILENAME__, __LINE__, __func__, ##__VA_ARGS__)
-#define LOG_ERROR(format_string, ...) \
-    SDL_Log("error:    %s:%d %s - " format_string "\n", __FILENAME__, __LINE__, __func__, ##__VA_ARGS__)
-#define LOG_CRITICAL(format_string, ...) \
-    SDL_Log("critical: %s:%d %s - " format_string "\n", __FILENAME__, __LINE__, __func__, ##__VA_ARGS__)
+#define FRAME_ARENA_BLOCK_SIZE (1024 * 1024)
+#define LOAD_ARENA_BLOCK_SIZE (16 * 1024 * 1024)
+#define ASSETS_ARENA_BLOCK_SIZE (256 * 1024)
+#define MAX_MESHES 256
+#define MAX_ASSET_BINDINGS 256
+#define MAX_CHANGED_FILES_PER_FRAME 32
+#define MESH_STAGING_TRIANGLES 2048 // Chunk size meshes are streamed to the GPU with
+#define RENDER_FRAME_PACKETS 2 // One being drawn, one being filled
+#define MAX_DEFERRED_DELETES 512
+
+// SDL only promises window and GL context calls on the main thread. GLX, WGL and EGL let the
+// render thread make its context current and swap, Cocoa doesn't. Elsewhere packets are drawn
+// on the update thread as they are submitted.
+#ifndef RENDER_THREADED
+    #if defined(SDL_PLATFORM_WINDOWS) || defined(SDL_PLATFORM_LINUX)
+        #define RENDER_THREADED 1
+    #else
+        #define RENDER_THREADED 0
+    #endif
+#endif
+
+#define INITIAL_TRANSFORMS 1024
+#define STRESS_CHAIN_LENGTH 4 // Stress entities are parented in chains this long
+#define MAX_LIGHTS 256
+#define MAX_LIGHT_INDICES (CLUSTERS_COUNT * 16) // Per frame, over all clusters
+#define LIGHT_CLUSTER_WORKERS 3
+#define LEVEL_LIGHTS_PER_SIDE 8 // Demo lights, a grid over the level bounds
+
+// Stats overlay
+#define HUD_TEXT_SCALE 2.0f
+#define HUD_MARGIN 16.0f
+#define HUD_STATS_COLUMNS 40
+
+// Per level memory budgets, enforced by the loaders
+#define LEVEL_CPU_BUDGET (256 * 1024 * 1024)
+#define LEVEL_GPU_BUDGET (512 * 1024 * 1024)
+
+#define CAMERA_COLLISION_RADIUS 0.5f
+#define CAMERA_COLLISION_ITERATIONS 4
+#define CAMERA_COLLISION_MAX_SUBSTEPS 16
+#define CAMERA_COLLISION_MAX_CONTACTS 32
+#define PICK_DISTANCE 4096.0f
+#define CAMERA_FOV_DEGREES 70.0f
+#define CAMERA_NEAR 0.01f
+#define CAMERA_FAR 4096.0f
+#define CLUSTER_NEAR 0.25f // Depth the exponential cluster slices start at
+
+// Texture streaming
+#define MAX_STREAMED_TEXTURES 256
+#define TEXTURE_STREAM_INITIAL_SIZE 64 // Levels up to this size load with the texture and stay
+#define TEXTURE_STREAM_UPLOAD_BUDGET (4 * 1024 * 1024) // Per frame
+#define TEXTURE_STREAM_EVICT_FRAMES 120 // A level unneeded this long is dropped
+#define TEXTURE_STREAM_IDLE_FRAMES 300 // Not requested this long, back to the initial levels
+#define LEVEL_UV_PER_UNIT 0.5f // level.fs triplanar scale
+#define LEVEL_SHADER_FEATURES (SHADER_FEATURE_VERTEX_SNAPPING | SHADER_FEATURE_AFFINE_MAPPING | SHADER_FEATURE_LIGHTING) // Meshes add their own
+#define MESH_MIN_UV_EXTENT 1e-4f // Narrower UVs count as unmapped, the mesh falls back to triplanar mapping
+
+// Level streaming, distances are on the XZ plane to a cell's triangle bounds
+#define STREAM_LOAD_RADIUS 24.0f
+#define STREAM_UNLOAD_RADIUS 32.0f
+#define STREAM_PREFETCH_SECONDS 1.0f // How far ahead the camera velocity is extrapolated
+#define STREAM_VELOCITY_SMOOTHING 0.2f
+#define STREAM_MAX_LOADS_PER_FRAME 2 // Prefetch limits, needed cells ignore them
+#define STREAM_FRAME_BUDGET_NS (2 * 1000000ull)
+#define STREAM_HITCH_NS (8 * 1000000ull) // Updates slower than this count as a hitch
 
 
 /*
 ** Structs
 */
 
-typedef struct {
-    char* path;
-    size_t offset;
-    size_t size;
-} FileEntry;
-
 typedef struct {
     SDL_Window *window;
-    SDL_GLContext gl;
+    SDL_GLContext gl; // Update thread's, loads and streaming upload through it
     
     int width;
     int height;
@@ -64,28 +134,245 @@ typedef struct {
 } Camera;
 
 typedef struct {
-    GLuint VAO;
     GLuint VBO;
     int vertex_count;
+    uint32_t features; // Shader features it needs on top of the level's, see upload_mesh_mdl
+
+    Bvh bvh; // CPU copy of the geometry for collision and picking
 } Mesh;
 
+typedef struct {
+    MdlCell info;
+    char path[MAX_PATH_LENGTH];
+    Mesh* mesh; // NULL while not resident
+
+    // Refreshed by every update
+    float distance;
+    float predicted_distance;
+
+    bool prefetched; // Loaded ahead of the camera and not needed yet
+    bool load_failed; // Not retried until it goes out of range
+} StreamCell;
+
+typedef struct {
+    char mesh_path[MAX_PATH_LENGTH]; // Source mdl the cells were split from
+    StreamCell* cells;
+    int cells_count;
+
+    vec3 last_camera_position;
+    vec3 velocity; // Units per second, smoothed
+
+    // Stats
+    int resident_count;
+    int peak_resident_count;
+    uint64_t loads_count;
+    uint64_t total_load_ns;
+    uint64_t prefetch_loads_count;
+    uint64_t prefetch_hits_count; // Prefetched cells the camera then got close to
+    uint64_t misses_count; // Cells loaded only once already needed
+    uint64_t evictions_count;
+    uint64_t budget_evictions_count;
+    uint64_t hitches_count;
+    uint64_t worst_update_ns;
+} LevelStream;
+
+typedef struct {
+    GLuint texture;
+    char path[MAX_PATH_LENGTH]; // Cooked entry
+    const FileEntry* entry;
+    size_t data_offset; // Of the level data, from the start of the entry
+    TextureHeader header;
+    TextureLevel levels[TEXTURE_MAX_LEVELS];
+    GLenum format;
+    bool flip_y;
+
+    int resident_base_level; // Finest resident level, GL_TEXTURE_BASE_LEVEL once the render thread caught up
+    int initial_base_level; // Resident from the start and never evicted
+    uint64_t dropped_in_frame; // Packet carrying the last level drop, nothing is uploaded before it is drawn
+    int wanted_base_level;
+    int requested_base_level; // Finest level requested this frame, TEXTURE_MAX_LEVELS if none
+    uint64_t last_requested_frame;
+    uint64_t coarser_since_frame; // Since when fewer levels are wanted than resident, 0 if not
+} StreamedTexture;
+
+typedef struct {
+    StreamedTexture textures[MAX_STREAMED_TEXTURES];
+    int textures_count;
+    uint64_t frame_index;
+
+    // Stats
+    uint64_t levels_loaded_count;
+    uint64_t levels_evicted_count;
+    uint64_t budget_evictions_count;
+    uint64_t bytes_uploaded;
+    uint64_t worst_update_ns;
+} TextureStream;
+
+// Transform only entities that spin every frame, see `-e:`
+typedef struct {
+    TransformId* ids;
+    int count;
+} StressEntities;
+
 typedef struct {
     uint64_t tick;
     Camera cam;
 
-    Mesh mesh;
-    GLuint shader;
+    TransformSystem transforms;
+    TransformId level_transform;
+    StressEntities stress;
+
+    ClusterLight lights[MAX_LIGHTS];
+    int lights_count;
+    ClusterAssigner clusters;
+
+    LevelStream level;
+    GLuint shaders[SHADER_VARIANT_COUNT]; // Level shader per feature mask, 0 until a mesh needs it
     GLuint texture;
 } Game;
 
+// Texture level changes take the same path as deletes, packets in flight may still sample
+// the levels they replace
+typedef enum {
+    RENDER_DELETE_BUFFER,
+    RENDER_DELETE_TEXTURE,
+    RENDER_DELETE_PROGRAM,
+    RENDER_DELETE_TEXTURE_LEVEL, // Moves the base past `level` and releases it
+    RENDER_SET_TEXTURE_BASE_LEVEL,
+} RenderDeleteKind;
+
+typedef struct {
+    RenderDeleteKind kind;
+    GLuint name;
+    int level; // Texture level changes only
+} RenderDelete;
+
+typedef struct {
+    GLuint shader;
+    GLuint VBO;
+    int vertex_count;
+    mat4 model_mat;
+} RenderDraw;
+
+// Everything the render thread needs for one frame, copied out of the game state
+typedef struct {
+    uint64_t frame_index;
+
+    mat4 view_mat;
+    mat4 proj_mat;
+    GLuint texture;
+
+    RenderDraw draws[MAX_MESHES];
+    int draws_count;
+
+    // Clustered lights, see clusters.h
+    ClusterLight lights[MAX_LIGHTS];
+    int lights_count;
+    uint32_t cluster_ranges[CLUSTERS_COUNT * 2];
+    uint16_t light_indices[MAX_LIGHT_INDICES];
+    uint32_t light_indices_count;
+    float cluster_z_params[2]; // Scale, bias
+
+    GLsync uploads_fence; // Waited on before drawing
+    RenderDelete deletes[MAX_DEFERRED_DELETES]; // Done after drawing
+    int deletes_count;
+
+    GLuint overlay_shader;
+    OverlayDrawList overlay; // Drawn on top, empty when hidden
+
+    bool quit;
+} FramePacket;
+
+// The update thread (SDL callbacks) simulates and loads, the render thread owns the
+// drawing context and consumes frame packets in order (see RENDER_THREADED)
+typedef struct {
+    SDL_GLContext gl; // Shares objects with `Display.gl`, NULL without a render thread
+    SDL_Thread* thread;
+    SDL_AtomicInt failed;
+    bool running; // Packets are being consumed, by the render thread or inline
+
+    FramePacket packets[RENDER_FRAME_PACKETS];
+    SDL_Semaphore* free_packets;
+    SDL_Semaphore* ready_packets;
+    int write_index; // Update thread only
+    int read_index; // Render thread only
+    uint64_t frames_count;
+    SDL_AtomicU32 frames_retired; // Packets the render thread is done with, deletes included
+
+    RenderDelete pending_deletes[MAX_DEFERRED_DELETES]; // Update thread only
+    int pending_deletes_count;
+
+    GLuint VAO; // Render thread only
+    GLuint overlay_VAO;
+    GLuint overlay_VBO;
+    GLuint light_buffers[3]; // Lights, cluster ranges, light indices
+    GLuint light_textures[3]; // Buffer textures over them
+    SDL_AtomicU32 draw_us; // Last frame's submission time
+} Renderer;
+
+typedef struct {
+    Overlay overlay;
+    GLuint shader;
+    GLuint font_texture;
+    bool visible;
+
+    // Last frame's, shown on the next one
+    uint64_t build_ns;
+    int last_quads_count;
+    int last_batches_count;
+} Hud;
+
+// Everything needed to load an asset again into the same GL object
+typedef struct {
+    ResourceKind kind;
+    char path[MAX_PATH_LENGTH]; // Vertex shader path for shaders
+    GLuint handle; // VBO for meshes
+
+    // Shaders
+    char fragment_shader_path[MAX_PATH_LENGTH];
+    uint32_t features;
+
+    // Textures
+    GLint wrap_mode;
+    GLint min_filter_mode;
+    GLint mag_filter_mode;
+    GLenum texture_format;
+    bool flip_y;
+
+    // Meshes
+    Mesh* mesh;
+    LevelStream* level; // Streamed level bound through its source mdl, `mesh` is unused
+} AssetBinding;
+
+typedef struct {
+    bool enabled;
+    FileWatch watch;
+
+    AssetBinding bindings[MAX_ASSET_BINDINGS];
+    int bindings_count;
+} HotReload;
+
 struct Context {
     Display display;
     Game g;
 
-    SDL_IOStream* assets_io;
-    FileEntry* assets_io_files;
-    int assets_io_files_count;
+    Vfs vfs;
+    const char* mount_paths[VFS_MAX_MOUNTS - 1]; // Extra mounts from `-m:`, base archive first
+    int mount_priorities[VFS_MAX_MOUNTS - 1];
+    int mount_paths_count;
     bool* keyboard_state;
+
+    Arena frame_arena; // Reset at the start of every frame
+    Arena load_arena; // Loader scratch, every io_* call rewinds what it used
+    Arena assets_arena; // Assets index, lives as long as `vfs`
+    Pool mesh_pool;
+    GLfloat mesh_staging[MESH_STAGING_TRIANGLES * 3 * MDL_FLOATS_PER_VERTEX]; // See upload_mesh_mdl
+
+    ResourceRegistry resources;
+    HotReload hot_reload; // Dev mode only, see `-w:`
+    TextureStream texture_stream;
+    Renderer render;
+    Hud hud;
 } ctx = {0};
 
 
@@ -101,18 +388,93 @@ void quit_engine();
 void quit_game();
 
 
+FileEntry* io_find_file_entry(const char* path);
 FileEntry* io_get_file_entry(const char* path);
 
-char* io_read_text_file(const char* path);
+char* io_read_text_file(const char* path, Arena* arena);
+char* io_read_shader_variant(const char* path, uint32_t features, Arena* arena);
+
 GLuint io_load_texture(const char* path, GLint wrap_mode, GLint min_filter_mode, GLint mag_filter_mode, GLenum texture_format, bool flip_y, int* out_width, int* out_height);
+bool upload_texture(GLuint texture, const unsigned char* file_buffer, size_t file_size, GLint wrap_mode, GLint min_filter_mode, GLint mag_filter_mode, GLenum texture_format, bool flip_y, size_t replaced_gpu_bytes, int* out_width, int* out_height, size_t* out_gpu_bytes);
 void io_load_mesh_mdl(const char* path, Mesh* dest);
+bool upload_mesh_mdl(Mesh* mesh, SDL_IOStream* io, size_t replaced_gpu_bytes, size_t* out_gpu_bytes, Bvh* out_bvh);
+bool io_load_bvh(const char* mesh_path, Bvh* dest);
 
-GLuint create_generic_shader(char* vertex_shader_source, char* fragment_shader_source);
+GLuint create_generic_shader(const char* vertex_shader_path, const char* fragment_shader_path, uint32_t features);
+GLuint level_shader(uint32_t mesh_features);
+GLuint create_shader_program(char* vertex_shader_source, char* fragment_shader_source);
+GLuint compile_shader(GLenum type, const char* source);
+bool link_program_shaders(GLuint shader_program, GLuint vertex_shader, GLuint fragment_shader);
+bool link_shader_program(GLuint shader_program, const char* vertex_shader_source, const char* fragment_shader_source);
 
-void view_mat_from_cam(Camera* cam, mat4 dest);
+AssetBinding* hot_reload_bind(ResourceKind kind, const char* path, GLuint handle);
+void hot_reload_unbind(ResourceKind kind, GLuint handle);
+char* hot_reload_read_file(const char* path, Arena* arena, size_t* out_size);
+void hot_reload_poll();
+bool hot_reload_binding(AssetBinding* binding);
 
-char* bytes_to_human_readable(size_t bytes);
-char* str_new_formatted(const char* fmt, ...);
+void destroy_texture(GLuint texture);
+void destroy_mesh(Mesh* mesh);
+void destroy_shader(GLuint shader);
+
+size_t texture_gpu_bytes(int width, int height, GLenum texture_format, bool mipmapped);
+
+void view_mat_from_cam(Camera* cam, mat4 dest);
+void collide_camera(Camera* cam, vec3 previous_position, LevelStream* level);
+void pick_from_camera(Camera* cam, LevelStream* level);
+
+bool stream_open(LevelStream* level, const char* mesh_path, vec3 position);
+bool stream_load_cells(LevelStream* level, vec3 position);
+bool stream_reload(LevelStream* level);
+void stream_close(LevelStream* level);
+float stream_cell_distance(StreamCell* cell, vec3 position);
+bool stream_load_cell(LevelStream* level, StreamCell* cell);
+void stream_evict_cell(LevelStream* level, StreamCell* cell);
+bool stream_make_room(LevelStream* level, StreamCell* for_cell);
+void stream_update(LevelStream* level, vec3 position, float delta_seconds);
+void stream_report(LevelStream* level);
+
+bool texture_stream_add(GLuint texture, FileEntry* cooked_entry, GLint wrap_mode, GLint min_filter_mode, GLint mag_filter_mode, GLenum texture_format, bool flip_y, int* out_width, int* out_height, size_t* out_gpu_bytes);
+bool texture_stream_upload_levels(StreamedTexture* st, int first_level, int last_level);
+void texture_stream_drop_level(StreamedTexture* st);
+size_t texture_stream_resident_bytes(StreamedTexture* st);
+StreamedTexture* texture_stream_find(GLuint texture);
+void texture_stream_forget(GLuint texture);
+void texture_stream_request(GLuint texture, float uv_per_unit, float distance);
+void texture_stream_update();
+bool texture_stream_make_room(StreamedTexture* for_texture, size_t gpu_bytes);
+void texture_stream_report();
+float level_view_distance(LevelStream* level, Camera* cam);
+
+bool render_init();
+void render_quit();
+int render_thread(void* userdata);
+void render_create_objects();
+void render_destroy_objects();
+void render_consume_frame(FramePacket* packet, bool drawable);
+FramePacket* render_begin_frame();
+void render_submit_frame(FramePacket* packet);
+void render_draw_frame(FramePacket* packet);
+void render_delete(RenderDeleteKind kind, GLuint name);
+void render_texture_level(RenderDeleteKind kind, GLuint texture, int level);
+void render_defer(RenderDelete object);
+void render_forget_texture_levels(GLuint texture);
+void render_flush_deletes(RenderDelete* deletes, int deletes_count);
+bool render_frame_retired(uint64_t frame_index);
+void render_wait_idle();
+
+bool hud_init();
+void hud_quit();
+GLuint io_load_font(const char* path, FontHeader* out_font);
+void hud_draw_stats(FramePacket* packet, float delta_seconds, uint64_t update_ns);
+void render_draw_overlay(FramePacket* packet);
+void render_upload_lights(FramePacket* packet);
+GLint render_use_shader(FramePacket* packet, GLuint shader);
+
+void lights_spawn(Game* g);
+
+bool stress_spawn(StressEntities* stress, TransformSystem* ts, TransformId root, int count);
+void stress_update(StressEntities* stress, TransformSystem* ts, float time_seconds);
 
 /*
 ** Implementation
@@ -122,6 +484,45 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 {
     SDL_SetAppMetadata(PROJECT_NAME, "0.0.0", "dev.ivan_reshetnikov." PROJECT_NAME);
 
+    // Parse args
+    const char* binary_log_path = NULL;
+    const char* watch_path = NULL;
+    int stress_count = 0;
+
+    for (int arg_index = 1; arg_index < argc; arg_index++) {
+        char* arg = argv[arg_index];
+
+        if (SDL_strncmp(arg, "-l:", strlen("-l:")) == 0) {
+            binary_log_path = arg + strlen("-l:");
+        }
+        else if (SDL_strncmp(arg, "-w:", strlen("-w:")) == 0) {
+            watch_path = arg + strlen("-w:");
+        }
+        else if (SDL_strncmp(arg, "-e:", strlen("-e:")) == 0) {
+            stress_count = SDL_atoi(arg + strlen("-e:"));
+        }
+        else if (SDL_strncmp(arg, "-m:", strlen("-m:")) == 0 && ctx.mount_paths_count < VFS_MAX_MOUNTS - 1) {
+            // `-m:<archive or directory>[@<priority>]`, later mounts win by default
+            char* mount_path = arg + strlen("-m:");
+            char* priority = SDL_strrchr(mount_path, '@');
+            if (priority != NULL) *priority++ = '\0';
+
+            ctx.mount_paths[ctx.mount_paths_count] = mount_path;
+            ctx.mount_priorities[ctx.mount_paths_count] = priority != NULL ? SDL_atoi(priority) : ctx.mount_paths_count + 1;
+            ctx.mount_paths_count++;
+        }
+    }
+
+    log_init(true, binary_log_path);
+
+    // Dev mode, reload assets from their sources when they change
+    if (watch_path != NULL) {
+        ctx.hot_reload.enabled = file_watch_init(&ctx.hot_reload.watch, watch_path);
+        if (ctx.hot_reload.enabled) {
+            LOG_INFO("Hot reload enabled, watching %s", watch_path);
+        }
+    }
+
     if (!init_engine()) {
         LOG_CRITICAL("Failed to initialise engine!");
         return SDL_APP_FAILURE;
@@ -132,6 +533,11 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
         return SDL_APP_FAILURE;
     }
 
+    // Dev mode, measure transform updates with that many moving entities
+    if (stress_count > 0) {
+        stress_spawn(&ctx.g.stress, &ctx.g.transforms, ctx.g.level_transform, stress_count);
+    }
+
     return SDL_APP_CONTINUE;
 }
 
@@ -142,6 +548,25 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
         case SDL_EVENT_QUIT: {
             return SDL_APP_SUCCESS;
         } break;
+        case SDL_EVENT_KEY_DOWN: {
+            if (event->key.scancode == SDL_SCANCODE_F1 && !event->key.repeat) {
+                resources_report(&ctx.resources);
+            }
+            if (event->key.scancode == SDL_SCANCODE_F2 && !event->key.repeat) {
+                stream_report(&ctx.g.level);
+            }
+            if (event->key.scancode == SDL_SCANCODE_F3 && !event->key.repeat) {
+                texture_stream_report();
+            }
+            if (event->key.scancode == SDL_SCANCODE_F4 && !event->key.repeat && ctx.hud.shader != 0) {
+                ctx.hud.visible = !ctx.hud.visible;
+            }
+        } break;
+        case SDL_EVENT_MOUSE_BUTTON_DOWN: {
+            if (event->button.button == SDL_BUTTON_LEFT) {
+                pick_from_camera(&ctx.g.cam, &ctx.g.level);
+            }
+        } break;
         case SDL_EVENT_MOUSE_MOTION: {
             ctx.g.cam.rotation[1] += event->motion.xrel * 0.075;
             ctx.g.cam.rotation[0] += -event->motion.yrel * 0.075;
@@ -156,11 +581,25 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
 
 SDL_AppResult SDL_AppIterate(void *appstate)
 {
+    if (SDL_GetAtomicInt(&ctx.render.failed)) {
+        return SDL_APP_FAILURE;
+    }
+
+    uint64_t update_start_ns = SDL_GetTicksNS();
+
+    arena_reset(&ctx.frame_arena);
+
+    if (ctx.hot_reload.enabled) {
+        hot_reload_poll();
+    }
+
     /* Delta */
     float delta = 0.0;
+    float delta_seconds = 0.0;
     {
         uint64_t tick = SDL_GetTicks();
         delta = (float)(tick - ctx.g.tick) / (float)(1000.0f / ctx.display.target_refresh_rate);
+        delta_seconds = (float)(tick - ctx.g.tick) / 1000.0f;
         ctx.g.tick = tick;
     }
 
@@ -169,6 +608,9 @@ SDL_AppResult SDL_AppIterate(void *appstate)
     mat4 proj_mat;
     {
         // Movement
+        vec3 previous_position;
+        glm_vec3_copy(ctx.g.cam.position, previous_position);
+
         float speed = 0.25f;
         vec3 move_speed_vec = {1.0f * speed * delta, 1.0f * speed * delta, 1.0f * speed * delta};
         if (ctx.keyboard_state[SDL_SCANCODE_W]) glm_vec3_muladd(ctx.g.cam.front, move_speed_vec, ctx.g.cam.position);
@@ -176,39 +618,69 @@ SDL_AppResult SDL_AppIterate(void *appstate)
         if (ctx.keyboard_state[SDL_SCANCODE_A]) glm_vec3_mulsub(ctx.g.cam.right, move_speed_vec, ctx.g.cam.position);
         if (ctx.keyboard_state[SDL_SCANCODE_D]) glm_vec3_muladd(ctx.g.cam.right, move_speed_vec, ctx.g.cam.position);
 
+        collide_camera(&ctx.g.cam, previous_position, &ctx.g.level);
+
+        stream_update(&ctx.g.level, ctx.g.cam.position, delta_seconds);
+
+        texture_stream_request(ctx.g.texture, LEVEL_UV_PER_UNIT, level_view_distance(&ctx.g.level, &ctx.g.cam));
+        texture_stream_update();
+
+        stress_update(&ctx.g.stress, &ctx.g.transforms, ctx.g.tick / 1000.0f);
+        transform_update(&ctx.g.transforms, &ctx.frame_arena);
+
         view_mat_from_cam(&ctx.g.cam, view_mat);
-        glm_perspective(glm_rad(70.0f), (float)ctx.display.width / (float)ctx.display.height, 0.01f, 4096.0f, proj_mat);
+
+        float aspect = (float)ctx.display.width / (float)ctx.display.height;
+        glm_perspective(glm_rad(CAMERA_FOV_DEGREES), aspect, CAMERA_NEAR, CAMERA_FAR, proj_mat);
+
+        // Cluster bounds only depend on the projection
+        ClusterGrid* grid = &ctx.g.clusters.grid;
+        if (grid->aspect != aspect || grid->fov_y != glm_rad(CAMERA_FOV_DEGREES)) {
+            cluster_grid_build(grid, glm_rad(CAMERA_FOV_DEGREES), aspect, CLUSTER_NEAR, CAMERA_FAR);
+        }
     }
 
-    /* Finall pass */
+    /* Frame packet */
     {
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_CULL_FACE);
+        FramePacket* packet = render_begin_frame();
+
+        glm_mat4_copy(view_mat, packet->view_mat);
+        glm_mat4_copy(proj_mat, packet->proj_mat);
+        packet->texture = ctx.g.texture;
+
+        // Lights are assigned straight into the packet, the render thread only uploads them
+        if (ctx.g.clusters.grid.bounds_min[0] != NULL) {
+            cluster_assign(&ctx.g.clusters, &view_mat[0][0], ctx.g.lights, ctx.g.lights_count, packet->cluster_ranges, packet->light_indices, MAX_LIGHT_INDICES);
 
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            SDL_memcpy(packet->lights, ctx.g.lights, sizeof(ClusterLight) * ctx.g.lights_count);
+            packet->lights_count = ctx.g.lights_count;
+            packet->light_indices_count = ctx.g.clusters.references_count;
+            packet->cluster_z_params[0] = ctx.g.clusters.grid.z_scale;
+            packet->cluster_z_params[1] = ctx.g.clusters.grid.z_bias;
+        }
 
-        // Draw mesh
-        mat4 model_mat = GLM_MAT4_IDENTITY_INIT;
+        // Resident cells
+        for (int i = 0; i < ctx.g.level.cells_count && packet->draws_count < MAX_MESHES; i++) {
+            Mesh* mesh = ctx.g.level.cells[i].mesh;
+            if (mesh == NULL) continue;
 
-        glUseProgram(ctx.g.shader);
+            GLuint shader = level_shader(mesh->features);
+            if (shader == 0) continue;
 
-        glUniformMatrix4fv(glGetUniformLocation(ctx.g.shader, "u_model_mat"), 1, GL_FALSE, &model_mat[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(ctx.g.shader, "u_view_mat"), 1, GL_FALSE, &view_mat[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(ctx.g.shader, "u_proj_mat"), 1, GL_FALSE, &proj_mat[0][0]);
+            RenderDraw* draw = &packet->draws[packet->draws_count++];
+            draw->shader = shader;
+            draw->VBO = mesh->VBO;
+            draw->vertex_count = mesh->vertex_count;
+            SDL_memcpy(draw->model_mat, transform_world(&ctx.g.transforms, ctx.g.level_transform), sizeof(mat4));
+        }
 
-        // Material uniforms
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, ctx.g.texture);
-        glUniform1i(glGetUniformLocation(ctx.g.shader, "u_texture"), 0);
+        if (ctx.hud.visible) {
+            hud_draw_stats(packet, delta_seconds, SDL_GetTicksNS() - update_start_ns);
+        }
 
-        // Draw segment
-        glBindVertexArray(ctx.g.mesh.VAO);
-        glDrawArrays(GL_TRIANGLES, 0, ctx.g.mesh.vertex_count);
+        render_submit_frame(packet);
     }
 
-    // Flush
-    SDL_GL_SwapWindow(ctx.display.window);
     SDL_Delay(ctx.display.target_frame_delay_ms);
     return SDL_APP_CONTINUE;
 }
@@ -217,9 +689,12 @@ SDL_AppResult SDL_AppIterate(void *appstate)
 void SDL_AppQuit(void *appstate, SDL_AppResult result)
 {
     quit_game();
+    render_quit();
     quit_engine();
 
     LOG_INFO("Exit sucess");
+
+    log_quit();
 }
 
 
@@ -233,6 +708,20 @@ bool init_engine()
         return false;
     }
 
+    /* Allocators */
+    {
+        arena_init(&ctx.frame_arena, FRAME_ARENA_BLOCK_SIZE);
+        arena_init(&ctx.load_arena, LOAD_ARENA_BLOCK_SIZE);
+        arena_init(&ctx.assets_arena, ASSETS_ARENA_BLOCK_SIZE);
+
+        if (!pool_init(&ctx.mesh_pool, sizeof(Mesh), MAX_MESHES)) {
+            LOG_CRITICAL("Failed to create the mesh pool!");
+            return false;
+        }
+
+        resources_init(&ctx.resources);
+    }
+
     /* Window */
     {
         LOG_DEBUG("Creating window");
@@ -288,37 +777,44 @@ bool init_engine()
             LOG_CRITICAL("Failed to load OpenGL implementation!");
             return false;
         }
+
+        LOG_DEBUG("Starting renderer");
+
+        if (!render_init()) {
+            LOG_CRITICAL("Failed to start the renderer!");
+            return false;
+        }
     }
 
     /* Asset io */
     {
-        LOG_DEBUG("Opening assets io stream");
+        LOG_DEBUG("Mounting assets");
+
+        vfs_init(&ctx.vfs, &ctx.assets_arena);
 
-        ctx.assets_io = SDL_IOFromFile(ASSETS_FILE_PATH, "rb");
-        if (!ctx.assets_io) {
-            LOG_CRITICAL("Failed to open assets io steam! SDL error: \n%s", SDL_GetError());
+        if (!vfs_mount_archive(&ctx.vfs, ASSETS_FILE_PATH, 0)) {
+            LOG_CRITICAL("Failed to mount the base archive %s!", ASSETS_FILE_PATH);
             return false;
         }
 
-        // Get file count
-        SDL_ReadIO(ctx.assets_io, &ctx.assets_io_files_count, sizeof(int));
-        LOG_DEBUG("Loading %d files", ctx.assets_io_files_count);
-
-        // Load file index
-        ctx.assets_io_files = SDL_realloc(ctx.assets_io_files, sizeof(FileEntry) * ctx.assets_io_files_count);
+        // Patches and the dev overlay are optional, a broken one is skipped and leaves the
+        // index as the lower mounts made it
+        for (int i = 0; i < ctx.mount_paths_count; i++) {
+            if (!vfs_mount(&ctx.vfs, ctx.mount_paths[i], ASSETS_ROOT_PATH, ctx.mount_priorities[i])) {
+                LOG_WARNING("Skipping mount %s!", ctx.mount_paths[i]);
+            }
+        }
 
-        for (int i = 0; i < ctx.assets_io_files_count; i++) {
-            FileEntry* f = &ctx.assets_io_files[i];
+        vfs_report(&ctx.vfs);
+    }
 
-            // Path
-            int path_size = 0;
-            SDL_ReadIO(ctx.assets_io, &path_size, sizeof(int));
-            f->path = SDL_malloc(path_size);
-            SDL_ReadIO(ctx.assets_io, f->path, path_size);
+    /* Overlay */
+    {
+        LOG_DEBUG("Loading overlay");
 
-            // Offset + size
-            SDL_ReadIO(ctx.assets_io, &f->offset, sizeof(size_t));
-            SDL_ReadIO(ctx.assets_io, &f->size, sizeof(size_t));
+        // Only the stats are lost without it, archives packed before fonts were baked still run
+        if (!hud_init()) {
+            LOG_WARNING("Failed to load the overlay, stats stay in the log (F1-F3).");
         }
     }
 
@@ -343,13 +839,28 @@ bool init_game()
     glm_vec3_copy((vec3){0.0f, 0.0f, 0.0f}, ctx.g.cam.position);
     glm_vec3_copy((vec3){0.0f, 1.0f, 0.0f}, ctx.g.cam.up);
 
-    ctx.g.shader = create_generic_shader(
-        io_read_text_file("./assets/shaders/level.vs"),
-        io_read_text_file("./assets/shaders/level.fs"));
-    
+    resources_set_budget(&ctx.resources, LEVEL_CPU_BUDGET, LEVEL_GPU_BUDGET);
+
+    if (!transform_init(&ctx.g.transforms, INITIAL_TRANSFORMS)) {
+        LOG_ERROR("Failed to create the transforms!");
+        return false;
+    }
+
+    ctx.g.level_transform = transform_create(&ctx.g.transforms, TRANSFORM_INVALID);
+
     ctx.g.texture = io_load_texture("./assets/textures/brick_brown_wall.png", GL_REPEAT, GL_NEAREST, GL_NEAREST, 0, 0, NULL, NULL);
 
-    io_load_mesh_mdl("./assets/models/levels/tot.mdl", &ctx.g.mesh);
+    if (!stream_open(&ctx.g.level, "./assets/models/levels/tot.mdl", ctx.g.cam.position)) {
+        LOG_ERROR("Failed to open the level!");
+        return false;
+    }
+
+    if (!cluster_assigner_init(&ctx.g.clusters, LIGHT_CLUSTER_WORKERS)) {
+        LOG_ERROR("Failed to create the light clusters!");
+        return false;
+    }
+
+    lights_spawn(&ctx.g);
 
     LOG_INFO("Initialised game successfully");
     return true;
@@ -362,31 +873,58 @@ void quit_engine()
 
     SDL_SetWindowRelativeMouseMode(ctx.display.window, 0);
 
-    SDL_CloseIO(ctx.assets_io);
+    hud_quit();
+
+    int leaks_count = resources_report_leaks(&ctx.resources);
+    if (leaks_count > 0) {
+        LOG_WARNING("%d resources were still alive at exit!", leaks_count);
+    }
+    resources_quit(&ctx.resources);
+
+    file_watch_quit(&ctx.hot_reload.watch);
+
+    vfs_quit(&ctx.vfs);
     SDL_DestroyWindow(ctx.display.window);
     SDL_GL_DestroyContext(ctx.display.gl);
+
+    arena_free(&ctx.frame_arena);
+    arena_free(&ctx.load_arena);
+    arena_free(&ctx.assets_arena);
+    pool_free(&ctx.mesh_pool);
+
     SDL_Quit();
 }
 
 void quit_game()
 {
     LOG_DEBUG("Exiting game");
+
+    stream_close(&ctx.g.level);
+    SDL_free(ctx.g.stress.ids);
+    SDL_memset(&ctx.g.stress, 0, sizeof(StressEntities));
+    transform_quit(&ctx.g.transforms);
+    cluster_assigner_quit(&ctx.g.clusters);
+    ctx.g.lights_count = 0;
+    destroy_texture(ctx.g.texture);
+
+    for (int i = 0; i < SHADER_VARIANT_COUNT; i++) {
+        destroy_shader(ctx.g.shaders[i]);
+        ctx.g.shaders[i] = 0;
+    }
+
+    ctx.g.texture = 0;
 }
 
 
-FileEntry* io_get_file_entry(const char* path)
+FileEntry* io_find_file_entry(const char* path)
 {
-    FileEntry* file_entry = NULL;
-    for (int file_index = 0; file_index < ctx.assets_io_files_count; file_index++)
-    {
-        FileEntry* candidate_file_entry = &ctx.assets_io_files[file_index];
+    return vfs_find(&ctx.vfs, path);
+}
 
-        if (SDL_strcmp((const char*)candidate_file_entry->path, path) == 0) {
-            file_entry = candidate_file_entry;
-            break;
-        }
-    }
 
+FileEntry* io_get_file_entry(const char* path)
+{
+    FileEntry* file_entry = io_find_file_entry(path);
     if (file_entry == NULL) {
         LOG_ERROR("Could not find asset file entry with path: %s!", path);
     }
@@ -395,7 +933,7 @@ FileEntry* io_get_file_entry(const char* path)
 }
 
 
-char* io_read_text_file(const char* path)
+char* io_read_text_file(const char* path, Arena* arena)
 {
     FileEntry* file_entry = io_get_file_entry(path);
     if (file_entry == NULL) {
@@ -403,14 +941,17 @@ char* io_read_text_file(const char* path)
         return NULL;
     }
 
-    char* text_buffer = (char*)SDL_calloc(1, file_entry->size + 1);
+    char* text_buffer = (char*)arena_alloc(arena, file_entry->size + 1);
     if (!text_buffer) {
         LOG_ERROR("Failed to allocate text file buffer!");
         return NULL;
     }
 
-    SDL_SeekIO(ctx.assets_io, file_entry->offset, SDL_IO_SEEK_SET);
-    SDL_ReadIO(ctx.assets_io, text_buffer, file_entry->size);
+    SDL_IOStream* io = vfs_open(&ctx.vfs, file_entry, 0);
+    if (io == NULL || SDL_ReadIO(io, text_buffer, file_entry->size) < file_entry->size) {
+        LOG_ERROR("Failed to read %s!", path);
+        return NULL;
+    }
 
     text_buffer[file_entry->size] = '\0'; // Text files come without a null-terminator
 
@@ -418,34 +959,119 @@ char* io_read_text_file(const char* path)
 }
 
 
+char* io_read_shader_variant(const char* path, uint32_t features, Arena* arena)
+{
+    char variant_path[MAX_PATH_LENGTH];
+    SDL_snprintf(variant_path, MAX_PATH_LENGTH, SHADER_VARIANT_PATH_FORMAT, path, features & (SHADER_VARIANT_COUNT - 1));
+
+    if (io_find_file_entry(variant_path) != NULL) {
+        return io_read_text_file(variant_path, arena);
+    }
+
+    char* source = io_read_text_file(path, arena);
+    if (source == NULL) {
+        return NULL;
+    }
+
+    // Sources without features have no variants, every mask is the source itself
+    uint32_t declared_features = shader_parse_features(source);
+    if (declared_features == 0) {
+        return source;
+    }
+
+    // Archives packed before permutations existed only carry the raw source
+    LOG_WARNING("Shader variant %s was not packed, expanding at runtime.", variant_path);
+
+    return shader_expand_variant(arena, source, features & declared_features);
+}
+
+
 GLuint io_load_texture(const char* path, GLint wrap_mode, GLint min_filter_mode, GLint mag_filter_mode, GLenum texture_format, bool flip_y, int* out_width, int* out_height)
 {
-    FileEntry* file_entry = io_get_file_entry(path);
-    if (file_entry == NULL) {
-        LOG_ERROR("Could not find texture file!");
+    uint64_t load_start_ns = SDL_GetTicksNS();
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+
+    size_t gpu_bytes = 0;
+    bool uploaded = false;
+
+    // Cooked textures stream their mips in, the source image is the fallback for older archives
+    char cooked_path[MAX_PATH_LENGTH];
+    SDL_snprintf(cooked_path, MAX_PATH_LENGTH, "%s" TEXTURE_COOKED_SUFFIX, path);
+
+    FileEntry* cooked_entry = io_find_file_entry(cooked_path);
+    if (cooked_entry != NULL) {
+        uploaded = texture_stream_add(texture, cooked_entry, wrap_mode, min_filter_mode, mag_filter_mode, texture_format, flip_y, out_width, out_height, &gpu_bytes);
+    }
+    else {
+        FileEntry* file_entry = io_get_file_entry(path);
+        if (file_entry == NULL) {
+            LOG_ERROR("Could not find texture file!");
+            glDeleteTextures(1, &texture);
+            return 0;
+        }
+
+        ArenaMark load_mark = arena_mark(&ctx.load_arena);
+
+        // Load image file's binary
+        unsigned char* file_buffer = (unsigned char*)arena_alloc(&ctx.load_arena, file_entry->size);
+        if (!file_buffer) {
+            LOG_ERROR("Failed to allocate texture file buffer!");
+            glDeleteTextures(1, &texture);
+            return 0;
+        }
+
+        SDL_IOStream* io = vfs_open(&ctx.vfs, file_entry, 0);
+        if (io == NULL || SDL_ReadIO(io, file_buffer, file_entry->size) < file_entry->size) {
+            LOG_ERROR("Failed to read texture file %s!", path);
+            arena_rewind(load_mark);
+            glDeleteTextures(1, &texture);
+            return 0;
+        }
+
+        uploaded = upload_texture(texture, file_buffer, file_entry->size, wrap_mode, min_filter_mode, mag_filter_mode, texture_format, flip_y, 0, out_width, out_height, &gpu_bytes);
+
+        // Both the file buffer and the decoded pixels live in the load arena
+        arena_rewind(load_mark);
+    }
+
+    if (!uploaded) {
+        LOG_ERROR("Failed to load texture %s!", path);
+        glDeleteTextures(1, &texture);
         return 0;
     }
 
-    // Load image file's binary
-    unsigned char* file_buffer = (unsigned char*)SDL_malloc(file_entry->size);
-    SDL_SeekIO(ctx.assets_io, file_entry->offset, SDL_IO_SEEK_SET);
-    SDL_ReadIO(ctx.assets_io, file_buffer, file_entry->size);
+    resources_register(&ctx.resources, RESOURCE_TEXTURE, path, texture, 0, gpu_bytes, SDL_GetTicksNS() - load_start_ns);
 
+    AssetBinding* binding = hot_reload_bind(RESOURCE_TEXTURE, path, texture);
+    if (binding != NULL) {
+        binding->wrap_mode = wrap_mode;
+        binding->min_filter_mode = min_filter_mode;
+        binding->mag_filter_mode = mag_filter_mode;
+        binding->texture_format = texture_format;
+        binding->flip_y = flip_y;
+    }
+
+    return texture;    
+}
+
+
+bool upload_texture(GLuint texture, const unsigned char* file_buffer, size_t file_size, GLint wrap_mode, GLint min_filter_mode, GLint mag_filter_mode, GLenum texture_format, bool flip_y, size_t replaced_gpu_bytes, int* out_width, int* out_height, size_t* out_gpu_bytes)
+{
     // Load with stb_image
     stbi_set_flip_vertically_on_load(flip_y);
 
     int width, height, color_channel_count;
 
-    unsigned char* data = stbi_load_from_memory(file_buffer, (int)file_entry->size, &width, &height, &color_channel_count, 0);
+    stbi_arena = &ctx.load_arena;
+    unsigned char* data = stbi_load_from_memory(file_buffer, (int)file_size, &width, &height, &color_channel_count, 0);
+    stbi_arena = NULL;
 
     // Check if data loaded
     if (!data) {
         LOG_ERROR("Could not load texture from file buffer! stbi_load_from_memory failed.");
-
-        stbi_image_free(data);
-        SDL_free(file_buffer);
-
-        return 0;
+        return false;
     }
 
     // Detect texture format from color_channel_count if none given.
@@ -458,18 +1084,22 @@ GLuint io_load_texture(const char* path, GLint wrap_mode, GLint min_filter_mode,
         case 4: texture_format = GL_RGBA; break;
         default: {
             LOG_ERROR("Failed to detect texture format! Unusual channel count of: %d", color_channel_count);    
-
-            stbi_image_free(data);
-            SDL_free(file_buffer);
-            
-            return 0;
+            return false;
         } break;
         }
     }
     
+    bool mipmapped = min_filter_mode == GL_NEAREST_MIPMAP_NEAREST || min_filter_mode == GL_NEAREST_MIPMAP_LINEAR
+        || min_filter_mode == GL_LINEAR_MIPMAP_NEAREST || min_filter_mode == GL_LINEAR_MIPMAP_LINEAR;
+    size_t gpu_bytes = texture_gpu_bytes(width, height, texture_format, mipmapped);
+
+    // A reload only has to afford the difference to what it replaces
+    if (gpu_bytes > replaced_gpu_bytes && !resources_can_afford(&ctx.resources, 0, gpu_bytes - replaced_gpu_bytes)) {
+        LOG_ERROR("Texture does not fit the GPU memory budget!");
+        return false;
+    }
+
     // Upload to GPU
-    GLuint texture;
-    glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_mode);
@@ -477,18 +1107,23 @@ GLuint io_load_texture(const char* path, GLint wrap_mode, GLint min_filter_mode,
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter_mode);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter_mode);
 
+    // Hot reloads can land on a texture that was streaming, it becomes fully resident
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+
     glTexImage2D(GL_TEXTURE_2D, 0, texture_format, width, height, 0, texture_format, GL_UNSIGNED_BYTE, data);
     
     // Generate mipmaps if used
-    if (min_filter_mode == GL_LINEAR_MIPMAP_LINEAR || min_filter_mode == GL_LINEAR_MIPMAP_NEAREST) {
+    if (mipmapped) {
         glGenerateMipmap(GL_TEXTURE_2D);
     }
 
     // Set output variables if requested
     if (out_width != NULL) *out_width = width;
     if (out_height != NULL) *out_height = height;
+    if (out_gpu_bytes != NULL) *out_gpu_bytes = gpu_bytes;
 
-    return texture;    
+    return true;
 }
 
 
@@ -500,110 +1135,263 @@ void io_load_mesh_mdl(const char* path, Mesh* mesh)
         return;
     }
 
+    uint64_t load_start_ns = SDL_GetTicksNS();
+
+    // Create mesh, the vertex layout is set up by the render thread's VAO
+    glGenBuffers(1, &mesh->VBO);
+
+    // Meshes packed before BVHs were cooked get theirs built from the vertices
+    bool bvh_cooked = io_load_bvh(path, &mesh->bvh);
+    SDL_IOStream* io = vfs_open(&ctx.vfs, file_entry, 0);
+
+    size_t vertex_buffer_size = 0;
+    if (io == NULL || !upload_mesh_mdl(mesh, io, 0, &vertex_buffer_size, bvh_cooked ? NULL : &mesh->bvh)) {
+        LOG_ERROR("Failed to load mesh %s!", path);
+
+        bvh_free(&mesh->bvh);
+
+        // Never handed to the render thread, it can go right away
+        glDeleteBuffers(1, &mesh->VBO);
+        mesh->VBO = 0;
+        return;
+    }
+
+    resources_register(&ctx.resources, RESOURCE_MESH, path, mesh->VBO, sizeof(Mesh) + mesh->bvh.memory_size, vertex_buffer_size, SDL_GetTicksNS() - load_start_ns);
+
+    AssetBinding* binding = hot_reload_bind(RESOURCE_MESH, path, mesh->VBO);
+    if (binding != NULL) {
+        binding->mesh = mesh;
+    }
+}
+
+
+bool upload_mesh_mdl(Mesh* mesh, SDL_IOStream* io, size_t replaced_gpu_bytes, size_t* out_gpu_bytes, Bvh* out_bvh)
+{
     // Load buffer
     size_t bytes_read;
 
-    SDL_SeekIO(ctx.assets_io, file_entry->offset, SDL_IO_SEEK_SET);
-
     int tri_count = 0;
-    bytes_read = SDL_ReadIO(ctx.assets_io, &tri_count, sizeof(int));
-    if (bytes_read < sizeof(int)) {
+    bytes_read = SDL_ReadIO(io, &tri_count, sizeof(int));
+    if (bytes_read < sizeof(int) || tri_count < 0) {
         LOG_ERROR("Failed to read mesh size! SDL error:\n%s", SDL_GetError());
+        return false;
     }
 
-    int floats_per_vertex = ( // Attributes
-        3 // Position
-        + 2 // UV
-        + 3 // Normal
-    );
-    size_t vertex_buffer_size = sizeof(GLfloat) * floats_per_vertex * tri_count * 3;
+    size_t vertex_buffer_size = MDL_VERTEX_SIZE * tri_count * 3;
 
-    GLfloat* vertex_buffer = SDL_malloc(vertex_buffer_size);
-    if (!vertex_buffer) {
-        LOG_ERROR("Failed to allocate memory for the vertex buffer! SDL error:\n%s", SDL_GetError());
-        return;
+    size_t cpu_bytes = replaced_gpu_bytes == 0 ? sizeof(Mesh) : 0;
+    size_t extra_gpu_bytes = vertex_buffer_size > replaced_gpu_bytes ? vertex_buffer_size - replaced_gpu_bytes : 0;
+    if (!resources_can_afford(&ctx.resources, cpu_bytes, extra_gpu_bytes)) {
+        LOG_ERROR("Mesh does not fit the memory budget!");
+        return false;
     }
 
-    bytes_read = SDL_ReadIO(ctx.assets_io, vertex_buffer, vertex_buffer_size);
-    if (bytes_read < vertex_buffer_size) {
-        LOG_ERROR("Unexpected EOF or read error while loading the vertex buffer! SDL error:\n%s", SDL_GetError());
-        SDL_free(vertex_buffer);
-        return;
+    // Respecifying the buffer drops the old vertices, so a truncated file has to fail before that
+    Sint64 io_size = SDL_GetIOSize(io);
+    if (io_size >= 0 && (size_t)(io_size - SDL_TellIO(io)) < vertex_buffer_size) {
+        LOG_ERROR("Mesh file is truncated, expected %zu bytes of vertices!", vertex_buffer_size);
+        return false;
     }
 
-    LOG_DEBUG("Loaded %d polygons %s", tri_count, bytes_to_human_readable(vertex_buffer_size));
+    ArenaMark load_mark = arena_mark(&ctx.load_arena);
 
-    // Create mesh
-    mesh->vertex_count = tri_count * 3;
+    // Meshes without a cooked BVH keep the positions only, not the whole vertex buffer
+    GLfloat* positions = NULL;
+    if (out_bvh != NULL) {
+        positions = arena_alloc(&ctx.load_arena, sizeof(GLfloat) * 3 * 3 * SDL_max(tri_count, 1));
+        if (!positions) {
+            LOG_ERROR("Failed to allocate memory for the BVH positions!");
+            return false;
+        }
+    }
 
-    glGenVertexArrays(1, &mesh->VAO);
-    glGenBuffers(1, &mesh->VBO);
-    
-    glBindVertexArray(mesh->VAO);
+    mesh->vertex_count = 0;
 
-    glBindBuffer(GL_ARRAY_BUFFER, mesh->VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertex_buffer_size, vertex_buffer, GL_STATIC_DRAW);
+    float uv_min[2] = { FLT_MAX, FLT_MAX };
+    float uv_max[2] = { -FLT_MAX, -FLT_MAX };
 
-    size_t stride = sizeof(GLfloat) * floats_per_vertex;
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-    glEnableVertexAttribArray(0);
-    // UV attribute
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // Normal attribute
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(5 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertex_buffer_size, NULL, GL_STATIC_DRAW);
+
+    // Whole triangles per chunk, the driver copies each one out before the next read reuses
+    // the staging buffer
+    size_t chunk_size = sizeof(ctx.mesh_staging);
+    for (size_t offset = 0; offset < vertex_buffer_size; offset += chunk_size) {
+        size_t size = SDL_min(chunk_size, vertex_buffer_size - offset);
+
+        bytes_read = SDL_ReadIO(io, ctx.mesh_staging, size);
+        if (bytes_read < size) {
+            LOG_ERROR("Unexpected EOF or read error while loading the vertex buffer! SDL error:\n%s", SDL_GetError());
+            arena_rewind(load_mark);
+            return false;
+        }
 
-    // Free buffer from ram
-    SDL_free(vertex_buffer);
-}
+        glBufferSubData(GL_ARRAY_BUFFER, offset, size, ctx.mesh_staging);
 
+        size_t first_vertex = offset / MDL_VERTEX_SIZE;
+        size_t chunk_vertex_count = size / MDL_VERTEX_SIZE;
 
-GLuint create_generic_shader(char* vertex_shader_source, char* fragment_shader_source)
-{
-    if (strlen(vertex_shader_source) == 0) LOG_WARNING("Vertex shader source is empty!");
-    if (strlen(fragment_shader_source) == 0) LOG_WARNING("Fragment shader source is empty!");
+        for (size_t v = 0; v < chunk_vertex_count; v++) {
+            const GLfloat* vertex = &ctx.mesh_staging[v * MDL_FLOATS_PER_VERTEX];
 
-    int success;
+            uv_min[0] = SDL_min(uv_min[0], vertex[3]);
+            uv_min[1] = SDL_min(uv_min[1], vertex[4]);
+            uv_max[0] = SDL_max(uv_max[0], vertex[3]);
+            uv_max[1] = SDL_max(uv_max[1], vertex[4]);
 
-    GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, (const GLchar* const*)&vertex_shader_source, NULL);
-    glCompileShader(vertex_shader);
-    // Check for errors
-    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        int log_length;
-        glGetShaderiv(vertex_shader, GL_INFO_LOG_LENGTH, &log_length);
+            if (positions != NULL) SDL_memcpy(&positions[(first_vertex + v) * 3], vertex, sizeof(GLfloat) * 3);
+        }
+    }
 
-        char* error_log = (char*)alloca(log_length * sizeof(char)); // `alloca()` does not require an explicit SDL_free()
-        glGetShaderInfoLog(vertex_shader, log_length, NULL, error_log);
+    LOG_DEBUG("Loaded %d polygons %s", tri_count, bytes_to_human_readable(&ctx.load_arena, vertex_buffer_size));
 
-        LOG_ERROR("Failed to compile the vertex shader!\n%s", error_log);
+    if (out_bvh != NULL && !bvh_build(out_bvh, positions, 3, (uint32_t)tri_count, &ctx.load_arena)) {
+        LOG_ERROR("Failed to build the mesh BVH!");
+        arena_rewind(load_mark);
+        return false;
     }
 
-    GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, (const GLchar* const*)&fragment_shader_source, NULL);
-    glCompileShader(fragment_shader);
-    // Check for errors
-    glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        int log_length;
-        glGetShaderiv(fragment_shader, GL_INFO_LOG_LENGTH, &log_length);
+    mesh->vertex_count = tri_count * 3;
 
-        char* error_log = (char*)alloca(log_length * sizeof(char));
-        glGetShaderInfoLog(fragment_shader, log_length, NULL, error_log);
+    // Meshes exported without a UV map (all zeros or a single point) are textured in world space
+    bool has_uvs = uv_max[0] - uv_min[0] > MESH_MIN_UV_EXTENT && uv_max[1] - uv_min[1] > MESH_MIN_UV_EXTENT;
+    mesh->features = has_uvs ? 0 : SHADER_FEATURE_TRIPLANAR_MAPPING;
 
-        LOG_ERROR("Failed to compile the fragment shader!\n%s", error_log);
-    }
+    arena_rewind(load_mark);
 
-    GLuint shader_program = glCreateProgram();
-    glAttachShader(shader_program, vertex_shader);
-    glAttachShader(shader_program, fragment_shader);
-    glLinkProgram(shader_program);
-    // Check for errors
-    glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
-    if (!success) {
+    if (out_gpu_bytes != NULL) *out_gpu_bytes = vertex_buffer_size;
+
+    return true;
+}
+
+
+bool io_load_bvh(const char* mesh_path, Bvh* dest)
+{
+    SDL_memset(dest, 0, sizeof(Bvh));
+
+    char bvh_path[MAX_PATH_LENGTH];
+    SDL_snprintf(bvh_path, MAX_PATH_LENGTH, "%s" BVH_PATH_SUFFIX, mesh_path);
+
+    FileEntry* file_entry = io_find_file_entry(bvh_path);
+    if (file_entry == NULL) {
+        LOG_WARNING("No cooked BVH for %s, building it at load time.", mesh_path);
+        return false;
+    }
+
+    // The BVH is used in place, so it gets a heap block of its own instead of the load arena
+    void* memory = SDL_malloc(file_entry->size);
+    if (!memory) {
+        LOG_ERROR("Failed to allocate %zu bytes for %s!", file_entry->size, bvh_path);
+        return false;
+    }
+
+    SDL_IOStream* io = vfs_open(&ctx.vfs, file_entry, 0);
+    if (io == NULL || SDL_ReadIO(io, memory, file_entry->size) < file_entry->size) {
+        LOG_ERROR("Failed to read %s! SDL error:\n%s", bvh_path, SDL_GetError());
+        SDL_free(memory);
+        return false;
+    }
+
+    return bvh_from_memory(dest, memory, file_entry->size);
+}
+
+
+GLuint create_generic_shader(const char* vertex_shader_path, const char* fragment_shader_path, uint32_t features)
+{
+    uint64_t load_start_ns = SDL_GetTicksNS();
+
+    ArenaMark load_mark = arena_mark(&ctx.load_arena);
+
+    char* vertex_shader_source = io_read_shader_variant(vertex_shader_path, features, &ctx.load_arena);
+    char* fragment_shader_source = io_read_shader_variant(fragment_shader_path, features, &ctx.load_arena);
+
+    if (vertex_shader_source == NULL || fragment_shader_source == NULL) {
+        LOG_ERROR("Failed to read shader sources: %s, %s (features: 0x%02x)", vertex_shader_path, fragment_shader_path, features);
+
+        arena_rewind(load_mark);
+
+        return 0;
+    }
+
+    GLuint shader_program = create_shader_program(vertex_shader_source, fragment_shader_source);
+
+    arena_rewind(load_mark);
+
+    // Drivers don't expose program sizes on GL 3.3, so shaders only account for their load time
+    char resource_path[RESOURCE_PATH_LENGTH];
+    SDL_snprintf(resource_path, RESOURCE_PATH_LENGTH, "%s + %s #%02x", vertex_shader_path, fragment_shader_path, features);
+    resources_register(&ctx.resources, RESOURCE_SHADER, resource_path, shader_program, 0, 0, SDL_GetTicksNS() - load_start_ns);
+
+    AssetBinding* binding = hot_reload_bind(RESOURCE_SHADER, vertex_shader_path, shader_program);
+    if (binding != NULL) {
+        SDL_strlcpy(binding->fragment_shader_path, fragment_shader_path, MAX_PATH_LENGTH);
+        binding->features = features;
+    }
+
+    return shader_program;
+}
+
+
+GLuint level_shader(uint32_t mesh_features)
+{
+    uint32_t features = (LEVEL_SHADER_FEATURES | mesh_features) & (SHADER_VARIANT_COUNT - 1);
+
+    // Compiled the first time a mesh asks for it
+    if (ctx.g.shaders[features] == 0) {
+        ctx.g.shaders[features] = create_generic_shader("./assets/shaders/level.vs", "./assets/shaders/level.fs", features);
+    }
+
+    return ctx.g.shaders[features];
+}
+
+
+GLuint create_shader_program(char* vertex_shader_source, char* fragment_shader_source)
+{
+    GLuint shader_program = glCreateProgram();
+    link_shader_program(shader_program, vertex_shader_source, fragment_shader_source);
+
+    return shader_program;
+}
+
+
+GLuint compile_shader(GLenum type, const char* source)
+{
+    if (strlen(source) == 0) LOG_WARNING("%s shader source is empty!", type == GL_VERTEX_SHADER ? "Vertex" : "Fragment");
+
+    int success;
+
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, (const GLchar* const*)&source, NULL);
+    glCompileShader(shader);
+    // Check for errors
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        int log_length;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_length);
+
+        char* error_log = (char*)alloca(log_length * sizeof(char)); // `alloca()` does not require an explicit SDL_free()
+        glGetShaderInfoLog(shader, log_length, NULL, error_log);
+
+        LOG_ERROR("Failed to compile the %s shader!\n%s", type == GL_VERTEX_SHADER ? "vertex" : "fragment", error_log);
+
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+
+bool link_program_shaders(GLuint shader_program, GLuint vertex_shader, GLuint fragment_shader)
+{
+    int success;
+
+    glAttachShader(shader_program, vertex_shader);
+    glAttachShader(shader_program, fragment_shader);
+    glLinkProgram(shader_program);
+    // Check for errors
+    glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
+    if (!success) {
         int log_length;
         glGetProgramiv(shader_program, GL_INFO_LOG_LENGTH, &log_length);
 
@@ -613,12 +1401,277 @@ GLuint create_generic_shader(char* vertex_shader_source, char* fragment_shader_s
         LOG_ERROR("Failed to link the shader program!\n%s", error_log);
     }
 
+    return success;
+}
+
+
+bool link_shader_program(GLuint shader_program, const char* vertex_shader_source, const char* fragment_shader_source)
+{
+    GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_shader_source);
+    GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_shader_source);
+
+    if (vertex_shader == 0 || fragment_shader == 0) {
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
+        return false;
+    }
+
+    GLuint attached_shaders[2];
+    GLsizei attached_count = 0;
+    glGetAttachedShaders(shader_program, 2, &attached_count, attached_shaders);
+
+    // A program that is already in use gets relinked only once the new stages are known to
+    // link, a failed link would leave it unusable until the next successful reload
+    bool success = true;
+    if (attached_count > 0) {
+        GLuint probe_program = glCreateProgram();
+        success = link_program_shaders(probe_program, vertex_shader, fragment_shader);
+        glDeleteProgram(probe_program);
+
+        if (success) {
+            for (int i = 0; i < attached_count; i++) glDetachShader(shader_program, attached_shaders[i]);
+        }
+    }
+
+    if (success) {
+        success = link_program_shaders(shader_program, vertex_shader, fragment_shader);
+    }
+
+    // Flagged for deletion, they go away with the program or once detached by a reload
     glDeleteShader(vertex_shader);
     glDeleteShader(fragment_shader);
-    SDL_free(vertex_shader_source);
-    SDL_free(fragment_shader_source);
 
-    return shader_program;
+    return success;
+}
+
+
+AssetBinding* hot_reload_bind(ResourceKind kind, const char* path, GLuint handle)
+{
+    if (!ctx.hot_reload.enabled) return NULL;
+
+    if (ctx.hot_reload.bindings_count == MAX_ASSET_BINDINGS) {
+        LOG_WARNING("Too many hot reload bindings, %s will not be reloaded.", path);
+        return NULL;
+    }
+
+    AssetBinding* binding = &ctx.hot_reload.bindings[ctx.hot_reload.bindings_count++];
+    SDL_memset(binding, 0, sizeof(AssetBinding));
+    binding->kind = kind;
+    SDL_strlcpy(binding->path, path, MAX_PATH_LENGTH);
+    binding->handle = handle;
+
+    return binding;
+}
+
+
+void hot_reload_unbind(ResourceKind kind, GLuint handle)
+{
+    for (int i = 0; i < ctx.hot_reload.bindings_count; i++) {
+        AssetBinding* binding = &ctx.hot_reload.bindings[i];
+
+        if (binding->kind == kind && binding->handle == handle) {
+            *binding = ctx.hot_reload.bindings[--ctx.hot_reload.bindings_count];
+            return;
+        }
+    }
+}
+
+
+char* hot_reload_read_file(const char* path, Arena* arena, size_t* out_size)
+{
+    // Archive paths are the source paths as `pack` saw them, rooted at ASSETS_ROOT_PATH
+    if (SDL_strncmp(path, ASSETS_ROOT_PATH "/", strlen(ASSETS_ROOT_PATH "/")) != 0) return NULL;
+
+    char source_path[MAX_PATH_LENGTH];
+    SDL_snprintf(source_path, MAX_PATH_LENGTH, "%s/%s", ctx.hot_reload.watch.root, path + strlen(ASSETS_ROOT_PATH "/"));
+
+    SDL_IOStream* io = SDL_IOFromFile(source_path, "rb");
+    if (io == NULL) {
+        LOG_ERROR("Failed to open %s! SDL error:\n%s", source_path, SDL_GetError());
+        return NULL;
+    }
+
+    Sint64 size = SDL_GetIOSize(io);
+    char* buffer = size >= 0 ? (char*)arena_alloc(arena, (size_t)size + 1) : NULL;
+
+    if (buffer == NULL || SDL_ReadIO(io, buffer, (size_t)size) < (size_t)size) {
+        LOG_ERROR("Failed to read %s!", source_path);
+        SDL_CloseIO(io);
+        return NULL;
+    }
+
+    SDL_CloseIO(io);
+
+    buffer[size] = '\0'; // Lets shader sources be used as is
+    if (out_size != NULL) *out_size = (size_t)size;
+
+    return buffer;
+}
+
+
+void hot_reload_poll()
+{
+    char changed_paths[MAX_CHANGED_FILES_PER_FRAME][FILE_WATCH_PATH_LENGTH];
+    int changed_count = file_watch_poll(&ctx.hot_reload.watch, changed_paths, MAX_CHANGED_FILES_PER_FRAME);
+
+    // Objects are replaced in place, nothing in flight may still be drawing them
+    if (changed_count > 0) render_wait_idle();
+
+    for (int changed_index = 0; changed_index < changed_count; changed_index++) {
+        char path[MAX_PATH_LENGTH];
+        SDL_snprintf(path, MAX_PATH_LENGTH, "%s/%s", ASSETS_ROOT_PATH, changed_paths[changed_index]);
+
+        for (int i = 0; i < ctx.hot_reload.bindings_count; i++) {
+            AssetBinding* binding = &ctx.hot_reload.bindings[i];
+
+            bool matches = SDL_strcmp(binding->path, path) == 0;
+            if (binding->kind == RESOURCE_SHADER) matches = matches || SDL_strcmp(binding->fragment_shader_path, path) == 0;
+
+            if (matches) hot_reload_binding(binding);
+        }
+    }
+}
+
+
+bool hot_reload_binding(AssetBinding* binding)
+{
+    uint64_t load_start_ns = SDL_GetTicksNS();
+
+    ResourceId resource_id = resources_find(&ctx.resources, binding->kind, binding->handle);
+    ResourceRecord* record = resources_get(&ctx.resources, resource_id);
+    size_t replaced_gpu_bytes = record != NULL ? record->gpu_bytes : 0;
+
+    ArenaMark load_mark = arena_mark(&ctx.load_arena);
+
+    bool reloaded = false;
+    size_t cpu_bytes = record != NULL ? record->cpu_bytes : 0;
+    size_t gpu_bytes = 0;
+
+    switch (binding->kind)
+    {
+    case RESOURCE_TEXTURE: {
+        size_t file_size = 0;
+        char* file_buffer = hot_reload_read_file(binding->path, &ctx.load_arena, &file_size);
+        if (file_buffer == NULL) break;
+
+        // The loose image replaces every level, the texture stops streaming
+        texture_stream_forget(binding->handle);
+        reloaded = upload_texture(binding->handle, (unsigned char*)file_buffer, file_size, binding->wrap_mode, binding->min_filter_mode, binding->mag_filter_mode, binding->texture_format, binding->flip_y, replaced_gpu_bytes, NULL, NULL, &gpu_bytes);
+    } break;
+    case RESOURCE_MESH: {
+        if (binding->level != NULL) {
+            reloaded = stream_reload(binding->level);
+            break;
+        }
+
+        size_t file_size = 0;
+        char* file_buffer = hot_reload_read_file(binding->path, &ctx.load_arena, &file_size);
+        if (file_buffer == NULL) break;
+
+        // Loose meshes have no cooked BVH, the new one replaces the old only on success
+        Bvh bvh;
+        SDL_IOStream* io = SDL_IOFromConstMem(file_buffer, file_size);
+        reloaded = upload_mesh_mdl(binding->mesh, io, replaced_gpu_bytes, &gpu_bytes, &bvh);
+        SDL_CloseIO(io);
+
+        if (reloaded) {
+            bvh_free(&binding->mesh->bvh);
+            binding->mesh->bvh = bvh;
+            cpu_bytes = sizeof(Mesh) + bvh.memory_size;
+        }
+    } break;
+    case RESOURCE_SHADER: {
+        // Both stages are re-cooked from their sources, the unchanged one could have been
+        // edited before the watcher started too
+        const char* stage_paths[2] = { binding->path, binding->fragment_shader_path };
+        char* stage_sources[2] = { NULL, NULL };
+
+        for (int stage = 0; stage < 2; stage++) {
+            char* source = hot_reload_read_file(stage_paths[stage], &ctx.load_arena, NULL);
+
+            stage_sources[stage] = source != NULL
+                ? shader_expand_variant(&ctx.load_arena, source, binding->features & shader_parse_features(source))
+                : io_read_shader_variant(stage_paths[stage], binding->features, &ctx.load_arena);
+        }
+
+        if (stage_sources[0] == NULL || stage_sources[1] == NULL) break;
+
+        reloaded = link_shader_program(binding->handle, stage_sources[0], stage_sources[1]);
+    } break;
+    default: break;
+    }
+
+    arena_rewind(load_mark);
+
+    if (!reloaded) {
+        LOG_ERROR("Failed to hot reload %s %s, keeping the previous version.", resource_kind_names[binding->kind], binding->path);
+        return false;
+    }
+
+    if (record != NULL) {
+        resources_update(&ctx.resources, resource_id, cpu_bytes, gpu_bytes);
+        record->load_time_ns = SDL_GetTicksNS() - load_start_ns;
+    }
+
+    LOG_INFO("Hot reloaded %s %s in %.3f ms", resource_kind_names[binding->kind], binding->path, (SDL_GetTicksNS() - load_start_ns) / 1000000.0);
+    return true;
+}
+
+
+void destroy_texture(GLuint texture)
+{
+    if (texture == 0) return;
+
+    resources_release(&ctx.resources, resources_find(&ctx.resources, RESOURCE_TEXTURE, texture));
+    texture_stream_forget(texture);
+    hot_reload_unbind(RESOURCE_TEXTURE, texture);
+    render_delete(RENDER_DELETE_TEXTURE, texture);
+}
+
+
+void destroy_mesh(Mesh* mesh)
+{
+    if (mesh == NULL) return;
+
+    resources_release(&ctx.resources, resources_find(&ctx.resources, RESOURCE_MESH, mesh->VBO));
+    hot_reload_unbind(RESOURCE_MESH, mesh->VBO);
+    render_delete(RENDER_DELETE_BUFFER, mesh->VBO);
+    bvh_free(&mesh->bvh);
+
+    pool_release(&ctx.mesh_pool, mesh);
+}
+
+
+void destroy_shader(GLuint shader)
+{
+    if (shader == 0) return;
+
+    resources_release(&ctx.resources, resources_find(&ctx.resources, RESOURCE_SHADER, shader));
+    hot_reload_unbind(RESOURCE_SHADER, shader);
+    render_delete(RENDER_DELETE_PROGRAM, shader);
+}
+
+
+size_t texture_gpu_bytes(int width, int height, GLenum texture_format, bool mipmapped)
+{
+    size_t bytes_per_pixel = 4;
+    switch (texture_format)
+    {
+    case GL_RED: bytes_per_pixel = 1; break;
+    case GL_RG: bytes_per_pixel = 2; break;
+    case GL_RGB: bytes_per_pixel = 4; break; // Drivers pad RGB8 to 4 bytes
+    case GL_RGBA: bytes_per_pixel = 4; break;
+    }
+
+    size_t gpu_bytes = (size_t)width * height * bytes_per_pixel;
+
+    while (mipmapped && (width > 1 || height > 1)) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        gpu_bytes += (size_t)width * height * bytes_per_pixel;
+    }
+
+    return gpu_bytes;
 }
 
 
@@ -644,39 +1697,1565 @@ void view_mat_from_cam(Camera* cam, mat4 dest)
 }
 
 
-char* bytes_to_human_readable(size_t bytes)
+void collide_camera(Camera* cam, vec3 previous_position, LevelStream* level)
 {
-    const char* units[] = {"B", "KB", "MB", "GB", "TB", "PB"};
-    
-    const int units_count = sizeof(units) / sizeof(char*);
-    double count = (double)bytes;
-    int i = 0;
+    // Sub-step so a fast camera can't skip over a wall thinner than the collision sphere
+    vec3 move;
+    glm_vec3_sub(cam->position, previous_position, move);
+
+    int substeps = (int)ceilf(glm_vec3_norm(move) / CAMERA_COLLISION_RADIUS);
+    substeps = glm_clamp(substeps, 1, CAMERA_COLLISION_MAX_SUBSTEPS);
+    glm_vec3_scale(move, 1.0f / substeps, move);
 
-    while (count >= 1024.0 && i < units_count) {
-        count /= 1024.0;
-        i++;
+    vec3 position;
+    glm_vec3_copy(previous_position, position);
+
+    BvhContact contacts[CAMERA_COLLISION_MAX_CONTACTS];
+
+    for (int step = 0; step < substeps; step++) {
+        glm_vec3_add(position, move, position);
+
+        // Push out of the deepest contact, then look again, the rest often resolve with it
+        for (int iteration = 0; iteration < CAMERA_COLLISION_ITERATIONS; iteration++) {
+            BvhContact deepest = { .depth = 0.0f };
+
+            for (int cell_index = 0; cell_index < level->cells_count; cell_index++) {
+                Mesh* mesh = level->cells[cell_index].mesh;
+                if (mesh == NULL) continue;
+
+                int contacts_count = bvh_overlap_sphere(&mesh->bvh, position, CAMERA_COLLISION_RADIUS, contacts, CAMERA_COLLISION_MAX_CONTACTS);
+                for (int i = 0; i < contacts_count; i++) {
+                    if (contacts[i].depth > deepest.depth) deepest = contacts[i];
+                }
+            }
+
+            if (deepest.depth <= 0.0f) break;
+
+            glm_vec3_muladds(deepest.normal, deepest.depth, position);
+        }
     }
 
-    return str_new_formatted("%.2f %s", count, units[i]);
+    glm_vec3_copy(position, cam->position);
 }
 
 
-char* str_new_formatted(const char* fmt, ...) {
-    va_list args;
+void pick_from_camera(Camera* cam, LevelStream* level)
+{
+    BvhRayHit hit = { .t = PICK_DISTANCE };
+    StreamCell* hit_cell = NULL;
 
-    va_start(args, fmt);
-    int str_len = SDL_vsnprintf(NULL, 0, fmt, args) + 1;
-    va_end(args);
+    for (int cell_index = 0; cell_index < level->cells_count; cell_index++) {
+        StreamCell* cell = &level->cells[cell_index];
+        if (cell->mesh == NULL) continue;
 
-    char* str = (char*)SDL_calloc(1, str_len);
-    if (!str) {
-        LOG_ERROR("Failed to allocate enough memory for the new string.");
-        return NULL;
+        BvhRayHit cell_hit;
+        if (bvh_raycast(&cell->mesh->bvh, cam->position, cam->front, hit.t, &cell_hit)) {
+            hit = cell_hit;
+            hit_cell = cell;
+        }
+    }
+
+    if (hit_cell == NULL) {
+        LOG_INFO("Picked nothing");
+        return;
+    }
+
+    LOG_INFO("Picked triangle #%u of %s at %.2f: (%.2f, %.2f, %.2f)", hit.triangle, hit_cell->path, hit.t, hit.position[0], hit.position[1], hit.position[2]);
+}
+
+
+bool stream_open(LevelStream* level, const char* mesh_path, vec3 position)
+{
+    SDL_memset(level, 0, sizeof(LevelStream));
+    SDL_strlcpy(level->mesh_path, mesh_path, MAX_PATH_LENGTH);
+    glm_vec3_copy(position, level->last_camera_position);
+
+    if (!stream_load_cells(level, position)) return false;
+
+    // Cells are derived from the source, editing it reloads the whole level
+    AssetBinding* binding = hot_reload_bind(RESOURCE_MESH, mesh_path, 0);
+    if (binding != NULL) {
+        binding->level = level;
+    }
+
+    LOG_INFO("Opened level %s: %d cells, %d resident", mesh_path, level->cells_count, level->resident_count);
+    return true;
+}
+
+
+bool stream_load_cells(LevelStream* level, vec3 position)
+{
+    const char* mesh_path = level->mesh_path;
+
+    char index_path[MAX_PATH_LENGTH];
+    SDL_snprintf(index_path, MAX_PATH_LENGTH, "%s" MDL_CELLS_SUFFIX, mesh_path);
+
+    FileEntry* file_entry = io_find_file_entry(index_path);
+
+    MdlCellsHeader header = {0};
+    SDL_IOStream* io = file_entry != NULL ? vfs_open(&ctx.vfs, file_entry, 0) : NULL;
+    if (io == NULL) file_entry = NULL;
+
+    if (file_entry != NULL) {
+        bool valid = SDL_ReadIO(io, &header, sizeof(MdlCellsHeader)) == sizeof(MdlCellsHeader)
+            && SDL_memcmp(header.magic, MDL_CELLS_MAGIC, 4) == 0 && header.version == MDL_CELLS_VERSION
+            && file_entry->size == sizeof(MdlCellsHeader) + sizeof(MdlCell) * (size_t)header.cells_count;
+
+        if (!valid) {
+            LOG_ERROR("Invalid or outdated cells index: %s!", index_path);
+            file_entry = NULL;
+        }
+    }
+
+    // Levels packed before cells existed stream as one cell that is always needed
+    level->cells_count = file_entry != NULL ? (int)header.cells_count : 1;
+    level->cells = SDL_calloc(level->cells_count, sizeof(StreamCell));
+    if (!level->cells) {
+        LOG_ERROR("Failed to allocate %d stream cells!", level->cells_count);
+        level->cells_count = 0; // A failed reload leaves the level empty, not dangling
+        return false;
+    }
+
+    for (int i = 0; file_entry != NULL && i < level->cells_count; i++) {
+        StreamCell* cell = &level->cells[i];
+
+        if (SDL_ReadIO(io, &cell->info, sizeof(MdlCell)) < sizeof(MdlCell)) {
+            LOG_ERROR("Failed to read the cells index: %s!", index_path);
+            file_entry = NULL;
+            break;
+        }
+
+        SDL_snprintf(cell->path, MAX_PATH_LENGTH, MDL_CELL_PATH_FORMAT, mesh_path, cell->info.x, cell->info.z);
+    }
+
+    // Also when the index broke halfway, there is room for at least one cell then
+    if (file_entry == NULL) {
+        LOG_WARNING("No cells index for %s, keeping it resident as a whole.", mesh_path);
+
+        level->cells_count = 1;
+        StreamCell* cell = &level->cells[0];
+        SDL_memset(cell, 0, sizeof(StreamCell));
+
+        SDL_strlcpy(cell->path, mesh_path, MAX_PATH_LENGTH);
+        for (int axis = 0; axis < 3; axis++) {
+            cell->info.bounds_min[axis] = -FLT_MAX;
+            cell->info.bounds_max[axis] = FLT_MAX;
+        }
+    }
+
+    // Everything needed at the start position is loaded up front and not counted as a miss
+    for (int i = 0; i < level->cells_count; i++) {
+        StreamCell* cell = &level->cells[i];
+
+        cell->distance = stream_cell_distance(cell, position);
+        if (cell->distance <= STREAM_LOAD_RADIUS) {
+            stream_load_cell(level, cell);
+        }
+    }
+
+    return true;
+}
+
+
+bool stream_reload(LevelStream* level)
+{
+    for (int i = 0; i < level->cells_count; i++) {
+        stream_evict_cell(level, &level->cells[i]);
     }
 
-    va_start(args, fmt);
-    SDL_vsnprintf(str, str_len, fmt, args);
-    va_end(args);
+    SDL_free(level->cells);
+    level->cells = NULL;
+    level->cells_count = 0;
+
+    // The edited source may be the loose file the VFS still has open
+    vfs_close_loose(&ctx.vfs);
+
+    return stream_load_cells(level, level->last_camera_position);
+}
+
+
+void stream_close(LevelStream* level)
+{
+    for (int i = 0; i < level->cells_count; i++) {
+        stream_evict_cell(level, &level->cells[i]);
+    }
+
+    for (int i = 0; i < ctx.hot_reload.bindings_count; i++) {
+        if (ctx.hot_reload.bindings[i].level == level) {
+            ctx.hot_reload.bindings[i] = ctx.hot_reload.bindings[--ctx.hot_reload.bindings_count];
+            break;
+        }
+    }
+
+    SDL_free(level->cells);
+    SDL_memset(level, 0, sizeof(LevelStream));
+}
+
+
+float stream_cell_distance(StreamCell* cell, vec3 position)
+{
+    // Cells are laid out on the XZ plane, height doesn't matter
+    float dx = SDL_max(SDL_max(cell->info.bounds_min[0] - position[0], position[0] - cell->info.bounds_max[0]), 0.0f);
+    float dz = SDL_max(SDL_max(cell->info.bounds_min[2] - position[2], position[2] - cell->info.bounds_max[2]), 0.0f);
+
+    return sqrtf(dx * dx + dz * dz);
+}
+
+
+bool stream_load_cell(LevelStream* level, StreamCell* cell)
+{
+    if (cell->mesh != NULL) return true;
+
+    uint64_t load_start_ns = SDL_GetTicksNS();
+
+    Mesh* mesh = pool_alloc(&ctx.mesh_pool);
+    if (mesh == NULL) {
+        LOG_WARNING("No free mesh for %s, not streaming it in.", cell->path);
+        return false;
+    }
+
+    io_load_mesh_mdl(cell->path, mesh);
+    if (mesh->VBO == 0) {
+        pool_release(&ctx.mesh_pool, mesh);
+        return false;
+    }
+
+    // Cells have no loose file of their own, they reload with the level
+    hot_reload_unbind(RESOURCE_MESH, mesh->VBO);
+
+    cell->mesh = mesh;
+    level->resident_count++;
+    if (level->resident_count > level->peak_resident_count) level->peak_resident_count = level->resident_count;
+
+    level->loads_count++;
+    level->total_load_ns += SDL_GetTicksNS() - load_start_ns;
+
+    LOG_DEBUG("Streamed in %s (%.1f away)", cell->path, cell->distance);
+    return true;
+}
+
+
+void stream_evict_cell(LevelStream* level, StreamCell* cell)
+{
+    if (cell->mesh == NULL) return;
+
+    LOG_DEBUG("Streamed out %s (%.1f away)", cell->path, cell->distance);
+
+    destroy_mesh(cell->mesh);
+    cell->mesh = NULL;
+    cell->prefetched = false;
+
+    level->resident_count--;
+    level->evictions_count++;
+}
+
+
+bool stream_make_room(LevelStream* level, StreamCell* for_cell)
+{
+    // Estimate from the archive entries, a cell costs its vertices on the GPU and its BVH
+    size_t gpu_bytes = 0;
+    size_t cpu_bytes = sizeof(Mesh);
+
+    FileEntry* mesh_entry = io_find_file_entry(for_cell->path);
+    if (mesh_entry != NULL && mesh_entry->size >= sizeof(int)) gpu_bytes = mesh_entry->size - sizeof(int);
+
+    char bvh_path[MAX_PATH_LENGTH];
+    SDL_snprintf(bvh_path, MAX_PATH_LENGTH, "%s" BVH_PATH_SUFFIX, for_cell->path);
+    FileEntry* bvh_entry = io_find_file_entry(bvh_path);
+    if (bvh_entry != NULL) cpu_bytes += bvh_entry->size;
+
+    // Evict the farthest cells that aren't needed until the new one fits
+    while (!resources_can_afford(&ctx.resources, cpu_bytes, gpu_bytes)) {
+        StreamCell* farthest = NULL;
+
+        for (int i = 0; i < level->cells_count; i++) {
+            StreamCell* cell = &level->cells[i];
+            if (cell->mesh == NULL || cell->distance <= STREAM_LOAD_RADIUS) continue;
+            if (cell->distance <= for_cell->distance) continue; // Never trade a nearer cell for a farther one
+
+            if (farthest == NULL || cell->distance > farthest->distance) farthest = cell;
+        }
+
+        if (farthest == NULL) return false;
+
+        stream_evict_cell(level, farthest);
+        level->budget_evictions_count++;
+    }
+
+    return true;
+}
+
+
+void stream_update(LevelStream* level, vec3 position, float delta_seconds)
+{
+    uint64_t update_start_ns = SDL_GetTicksNS();
+
+    // Smoothed camera velocity, predicts where the camera will be when a load would finish
+    if (delta_seconds > 0.0f) {
+        vec3 instant_velocity;
+        glm_vec3_sub(position, level->last_camera_position, instant_velocity);
+        glm_vec3_scale(instant_velocity, 1.0f / delta_seconds, instant_velocity);
+        glm_vec3_lerp(level->velocity, instant_velocity, STREAM_VELOCITY_SMOOTHING, level->velocity);
+    }
+    glm_vec3_copy(position, level->last_camera_position);
+
+    vec3 predicted_position;
+    glm_vec3_copy(position, predicted_position);
+    glm_vec3_muladds(level->velocity, STREAM_PREFETCH_SECONDS, predicted_position);
+
+    for (int i = 0; i < level->cells_count; i++) {
+        StreamCell* cell = &level->cells[i];
+
+        cell->distance = stream_cell_distance(cell, position);
+        cell->predicted_distance = stream_cell_distance(cell, predicted_position);
+
+        if (cell->mesh != NULL && cell->prefetched && cell->distance <= STREAM_LOAD_RADIUS) {
+            level->prefetch_hits_count++;
+            cell->prefetched = false;
+        }
+    }
+
+    // Evict with some hysteresis so cells on the edge don't flicker in and out
+    for (int i = 0; i < level->cells_count; i++) {
+        StreamCell* cell = &level->cells[i];
+
+        if (cell->mesh != NULL && cell->distance > STREAM_UNLOAD_RADIUS && cell->predicted_distance > STREAM_UNLOAD_RADIUS) {
+            stream_evict_cell(level, cell);
+        }
+    }
+
+    // Load nearest first. Needed cells always load, they would be holes in the level
+    // otherwise. Prefetches stop at the per frame limits.
+    for (int loads = 0; ; loads++) {
+        StreamCell* nearest = NULL;
+        float nearest_distance = FLT_MAX;
+
+        for (int i = 0; i < level->cells_count; i++) {
+            StreamCell* cell = &level->cells[i];
+            if (cell->mesh != NULL || cell->load_failed) continue;
+
+            float distance = SDL_min(cell->distance, cell->predicted_distance);
+            if (distance > STREAM_LOAD_RADIUS) continue;
+
+            if (distance < nearest_distance) {
+                nearest = cell;
+                nearest_distance = distance;
+            }
+        }
+
+        if (nearest == NULL) break;
+
+        bool needed = nearest->distance <= STREAM_LOAD_RADIUS;
+        bool over_frame_budget = loads >= STREAM_MAX_LOADS_PER_FRAME || SDL_GetTicksNS() - update_start_ns > STREAM_FRAME_BUDGET_NS;
+        if (!needed && over_frame_budget) break;
+
+        if (!stream_make_room(level, nearest)) {
+            LOG_WARNING("Level memory budget is full, can not stream in %s.", nearest->path);
+            nearest->load_failed = true;
+            continue;
+        }
+
+        if (!stream_load_cell(level, nearest)) {
+            nearest->load_failed = true;
+            continue;
+        }
+
+        if (needed) {
+            level->misses_count++;
+        }
+        else {
+            nearest->prefetched = true;
+            level->prefetch_loads_count++;
+        }
+    }
+
+    // A failed cell is retried once it has gone out of range and comes back
+    for (int i = 0; i < level->cells_count; i++) {
+        StreamCell* cell = &level->cells[i];
+        if (cell->load_failed && cell->distance > STREAM_UNLOAD_RADIUS) cell->load_failed = false;
+    }
+
+    uint64_t update_ns = SDL_GetTicksNS() - update_start_ns;
+    if (update_ns > level->worst_update_ns) level->worst_update_ns = update_ns;
+    if (update_ns > STREAM_HITCH_NS) level->hitches_count++;
+}
+
+
+void stream_report(LevelStream* level)
+{
+    size_t cpu_bytes = 0;
+    size_t gpu_bytes = 0;
+
+    for (int i = 0; i < level->cells_count; i++) {
+        StreamCell* cell = &level->cells[i];
+        if (cell->mesh == NULL) continue;
+
+        ResourceRecord* record = resources_get(&ctx.resources, resources_find(&ctx.resources, RESOURCE_MESH, cell->mesh->VBO));
+        if (record != NULL) {
+            cpu_bytes += record->cpu_bytes;
+            gpu_bytes += record->gpu_bytes;
+        }
+    }
+
+    ArenaMark frame_mark = arena_mark(&ctx.frame_arena);
+
+    LOG_INFO("Level streaming:");
+    LOG_INFO("  resident: %d/%d cells (peak %d), cpu: %s, gpu: %s", level->resident_count, level->cells_count, level->peak_resident_count,
+        bytes_to_human_readable(&ctx.frame_arena, cpu_bytes), bytes_to_human_readable(&ctx.frame_arena, gpu_bytes));
+    LOG_INFO("  loads: %llu (%.3f ms avg), prefetched: %llu, prefetch hits: %llu, misses: %llu",
+        (unsigned long long)level->loads_count, level->loads_count ? level->total_load_ns / 1000000.0 / level->loads_count : 0.0,
+        (unsigned long long)level->prefetch_loads_count, (unsigned long long)level->prefetch_hits_count, (unsigned long long)level->misses_count);
+    LOG_INFO("  evictions: %llu (%llu for budget), hitches: %llu, worst update: %.3f ms",
+        (unsigned long long)level->evictions_count, (unsigned long long)level->budget_evictions_count,
+        (unsigned long long)level->hitches_count, level->worst_update_ns / 1000000.0);
+
+    arena_rewind(frame_mark);
+}
+
+
+bool texture_stream_add(GLuint texture, FileEntry* cooked_entry, GLint wrap_mode, GLint min_filter_mode, GLint mag_filter_mode, GLenum texture_format, bool flip_y, int* out_width, int* out_height, size_t* out_gpu_bytes)
+{
+    if (ctx.texture_stream.textures_count == MAX_STREAMED_TEXTURES) {
+        LOG_ERROR("Too many streamed textures, can not add %s!", cooked_entry->path);
+        return false;
+    }
+
+    StreamedTexture* st = &ctx.texture_stream.textures[ctx.texture_stream.textures_count];
+    SDL_memset(st, 0, sizeof(StreamedTexture));
+
+    st->texture = texture;
+    st->flip_y = flip_y;
+    SDL_strlcpy(st->path, cooked_entry->path, MAX_PATH_LENGTH);
+
+    SDL_IOStream* io = vfs_open(&ctx.vfs, cooked_entry, 0);
+    if (io == NULL) return false;
+
+    // Archive entries share one stream, reading past an entry would read the next one
+    TextureHeader* header = &st->header;
+    if (cooked_entry->size < sizeof(TextureHeader) || SDL_ReadIO(io, header, sizeof(TextureHeader)) < sizeof(TextureHeader)) {
+        LOG_ERROR("Failed to read the cooked texture header: %s!", cooked_entry->path);
+        return false;
+    }
+
+    if (SDL_memcmp(header->magic, TEXTURE_MAGIC, 4) != 0 || header->version != TEXTURE_VERSION
+        || header->levels_count == 0 || header->levels_count > TEXTURE_MAX_LEVELS) {
+        LOG_ERROR("Invalid or outdated cooked texture: %s!", cooked_entry->path);
+        return false;
+    }
+
+    size_t levels_size = sizeof(TextureLevel) * header->levels_count;
+    st->data_offset = sizeof(TextureHeader) + levels_size;
+    if (cooked_entry->size < st->data_offset || SDL_ReadIO(io, st->levels, levels_size) < levels_size) {
+        LOG_ERROR("Failed to read the level table of %s!", cooked_entry->path);
+        return false;
+    }
+
+    // Every level read and upload trusts the table from here on
+    if (!texture_levels_valid(header, st->levels, cooked_entry->size - st->data_offset)) {
+        LOG_ERROR("Corrupt level table in %s!", cooked_entry->path);
+        return false;
+    }
+
+    st->entry = cooked_entry;
+
+    // Detect texture format from the channel count if none given.
+    st->format = texture_format;
+    if (st->format == 0) {
+        switch (header->channels)
+        {
+        case 1: st->format = GL_RED; break;
+        case 2: st->format = GL_RG; break;
+        case 3: st->format = GL_RGB; break;
+        case 4: st->format = GL_RGBA; break;
+        default: {
+            LOG_ERROR("Failed to detect texture format! Unusual channel count of: %u", header->channels);
+            return false;
+        } break;
+        }
+    }
+
+    // Start from the finest level that is still small, everything coarser comes with it
+    int last_level = (int)header->levels_count - 1;
+    st->initial_base_level = last_level;
+    while (st->initial_base_level > 0
+        && SDL_max(st->levels[st->initial_base_level - 1].width, st->levels[st->initial_base_level - 1].height) <= TEXTURE_STREAM_INITIAL_SIZE) {
+        st->initial_base_level--;
+    }
+
+    size_t initial_gpu_bytes = 0;
+    for (int level = st->initial_base_level; level <= last_level; level++) {
+        initial_gpu_bytes += texture_gpu_bytes(st->levels[level].width, st->levels[level].height, st->format, false);
+    }
+
+    if (!resources_can_afford(&ctx.resources, 0, initial_gpu_bytes)) {
+        LOG_ERROR("Texture %s does not fit the GPU memory budget!", cooked_entry->path);
+        return false;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_mode);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_mode);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter_mode);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter_mode);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, last_level);
+
+    st->resident_base_level = last_level + 1; // Nothing yet
+    if (!texture_stream_upload_levels(st, st->initial_base_level, last_level)) {
+        return false;
+    }
+
+    // No packet references the new texture yet, its base is set right away
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, st->initial_base_level);
+
+    st->wanted_base_level = st->initial_base_level;
+    st->requested_base_level = TEXTURE_MAX_LEVELS;
+    st->last_requested_frame = ctx.texture_stream.frame_index;
+
+    ctx.texture_stream.textures_count++;
+
+    if (out_width != NULL) *out_width = header->width;
+    if (out_height != NULL) *out_height = header->height;
+    if (out_gpu_bytes != NULL) *out_gpu_bytes = texture_stream_resident_bytes(st);
+
+    return true;
+}
+
+
+bool texture_stream_upload_levels(StreamedTexture* st, int first_level, int last_level)
+{
+    // Coarser levels come first in the archive, so the whole range is one read
+    TextureLevel* finest = &st->levels[first_level];
+    TextureLevel* coarsest = &st->levels[last_level];
+    size_t range_offset = coarsest->offset;
+    size_t range_size = finest->offset + finest->size - coarsest->offset;
+
+    ArenaMark load_mark = arena_mark(&ctx.load_arena);
+
+    unsigned char* buffer = (unsigned char*)arena_alloc(&ctx.load_arena, range_size);
+    if (!buffer) {
+        LOG_ERROR("Failed to allocate %zu bytes for texture levels!", range_size);
+        return false;
+    }
+
+    SDL_IOStream* io = vfs_open(&ctx.vfs, st->entry, st->data_offset + range_offset);
+    if (io == NULL || SDL_ReadIO(io, buffer, range_size) < range_size) {
+        LOG_ERROR("Failed to read levels %d-%d of %s! SDL error:\n%s", first_level, last_level, st->path, SDL_GetError());
+        arena_rewind(load_mark);
+        return false;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, st->texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (int level = last_level; level >= first_level; level--) {
+        TextureLevel* l = &st->levels[level];
+        unsigned char* pixels = buffer + (l->offset - range_offset);
+
+        if (st->flip_y) {
+            size_t row_size = (size_t)l->width * st->header.channels;
+            unsigned char* row_swap = (unsigned char*)arena_alloc(&ctx.load_arena, row_size);
+
+            for (uint32_t y = 0; row_swap != NULL && y < l->height / 2; y++) {
+                unsigned char* top = pixels + row_size * y;
+                unsigned char* bottom = pixels + row_size * (l->height - 1 - y);
+                SDL_memcpy(row_swap, top, row_size);
+                SDL_memcpy(top, bottom, row_size);
+                SDL_memcpy(bottom, row_swap, row_size);
+            }
+        }
+
+        glTexImage2D(GL_TEXTURE_2D, level, st->format, l->width, l->height, 0, st->format, GL_UNSIGNED_BYTE, pixels);
+
+        ctx.texture_stream.bytes_uploaded += l->size;
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // The caller moves GL_TEXTURE_BASE_LEVEL, once the new levels are defined so the
+    // texture stays complete
+    if (first_level < st->resident_base_level) {
+        ctx.texture_stream.levels_loaded_count += SDL_min(st->resident_base_level, last_level + 1) - first_level;
+        st->resident_base_level = first_level;
+    }
+
+    arena_rewind(load_mark);
+    return true;
+}
+
+
+void texture_stream_drop_level(StreamedTexture* st)
+{
+    if (st->resident_base_level >= st->initial_base_level) return;
+
+    int level = st->resident_base_level;
+
+    // Released by the render thread once no packet samples it anymore, the level isn't
+    // uploaded again before then
+    render_texture_level(RENDER_DELETE_TEXTURE_LEVEL, st->texture, level);
+    st->dropped_in_frame = ctx.render.frames_count;
+
+    st->resident_base_level = level + 1;
+    ctx.texture_stream.levels_evicted_count++;
+
+    resources_update(&ctx.resources, resources_find(&ctx.resources, RESOURCE_TEXTURE, st->texture), 0, texture_stream_resident_bytes(st));
+}
+
+
+size_t texture_stream_resident_bytes(StreamedTexture* st)
+{
+    size_t gpu_bytes = 0;
+    for (int level = st->resident_base_level; level < (int)st->header.levels_count; level++) {
+        gpu_bytes += texture_gpu_bytes(st->levels[level].width, st->levels[level].height, st->format, false);
+    }
+
+    return gpu_bytes;
+}
+
+
+StreamedTexture* texture_stream_find(GLuint texture)
+{
+    for (int i = 0; i < ctx.texture_stream.textures_count; i++) {
+        if (ctx.texture_stream.textures[i].texture == texture) return &ctx.texture_stream.textures[i];
+    }
+
+    return NULL;
+}
+
+
+void texture_stream_forget(GLuint texture)
+{
+    StreamedTexture* st = texture_stream_find(texture);
+    if (st == NULL) return;
+
+    // Whoever takes over the texture defines its levels from scratch
+    render_forget_texture_levels(texture);
+
+    *st = ctx.texture_stream.textures[--ctx.texture_stream.textures_count];
+}
+
+
+void texture_stream_request(GLuint texture, float uv_per_unit, float distance)
+{
+    StreamedTexture* st = texture_stream_find(texture);
+    if (st == NULL) return;
+
+    // Texels per world unit on the texture against pixels per world unit on screen at
+    // `distance`, every halving of the ratio is one level coarser
+    float pixels_per_unit = ctx.display.height / (2.0f * SDL_max(distance, 0.001f) * tanf(glm_rad(CAMERA_FOV_DEGREES) * 0.5f));
+    float texels_per_unit = SDL_max(st->header.width, st->header.height) * uv_per_unit;
+
+    int level = 0;
+    float ratio = texels_per_unit / pixels_per_unit;
+    while (ratio >= 2.0f && level < st->initial_base_level) {
+        ratio *= 0.5f;
+        level++;
+    }
+
+    st->requested_base_level = SDL_min(st->requested_base_level, level);
+}
+
+
+void texture_stream_update()
+{
+    TextureStream* ts = &ctx.texture_stream;
+    uint64_t update_start_ns = SDL_GetTicksNS();
+
+    ts->frame_index++;
+
+    for (int i = 0; i < ts->textures_count; i++) {
+        StreamedTexture* st = &ts->textures[i];
+
+        // Textures nobody asked for in a while fall back to their initial levels
+        if (st->requested_base_level < TEXTURE_MAX_LEVELS) {
+            st->wanted_base_level = st->requested_base_level;
+            st->last_requested_frame = ts->frame_index;
+        }
+        else if (ts->frame_index - st->last_requested_frame > TEXTURE_STREAM_IDLE_FRAMES) {
+            st->wanted_base_level = st->initial_base_level;
+        }
+        st->requested_base_level = TEXTURE_MAX_LEVELS;
+
+        // Drop levels that stayed unneeded for a while, one at a time
+        if (st->resident_base_level < st->wanted_base_level) {
+            if (st->coarser_since_frame == 0) {
+                st->coarser_since_frame = ts->frame_index;
+            }
+            else if (ts->frame_index - st->coarser_since_frame >= TEXTURE_STREAM_EVICT_FRAMES) {
+                texture_stream_drop_level(st);
+                st->coarser_since_frame = ts->frame_index;
+            }
+        }
+        else {
+            st->coarser_since_frame = 0;
+        }
+    }
+
+    // Stream in one level at a time, largest deficit first, within the upload budget
+    size_t uploaded_bytes = 0;
+    while (uploaded_bytes < TEXTURE_STREAM_UPLOAD_BUDGET) {
+        StreamedTexture* neediest = NULL;
+        for (int i = 0; i < ts->textures_count; i++) {
+            StreamedTexture* st = &ts->textures[i];
+            if (st->resident_base_level <= st->wanted_base_level) continue;
+            if (!render_frame_retired(st->dropped_in_frame)) continue;
+
+            if (neediest == NULL || st->resident_base_level - st->wanted_base_level > neediest->resident_base_level - neediest->wanted_base_level) {
+                neediest = st;
+            }
+        }
+
+        if (neediest == NULL) break;
+
+        int level = neediest->resident_base_level - 1;
+        size_t level_gpu_bytes = texture_gpu_bytes(neediest->levels[level].width, neediest->levels[level].height, neediest->format, false);
+
+        if (!texture_stream_make_room(neediest, level_gpu_bytes)) {
+            // Settle for what is resident until the budget frees up
+            neediest->wanted_base_level = neediest->resident_base_level;
+            continue;
+        }
+
+        if (!texture_stream_upload_levels(neediest, level, level)) {
+            neediest->wanted_base_level = neediest->resident_base_level;
+            continue;
+        }
+
+        // Levels below the base aren't sampled, so the upload itself can't disturb packets in
+        // flight. They keep the old base, the new level is drawn from the next packet on.
+        render_texture_level(RENDER_SET_TEXTURE_BASE_LEVEL, neediest->texture, level);
+
+        resources_update(&ctx.resources, resources_find(&ctx.resources, RESOURCE_TEXTURE, neediest->texture), 0, texture_stream_resident_bytes(neediest));
+        uploaded_bytes += neediest->levels[level].size;
+    }
+
+    uint64_t update_ns = SDL_GetTicksNS() - update_start_ns;
+    if (update_ns > ts->worst_update_ns) ts->worst_update_ns = update_ns;
+}
+
+
+bool texture_stream_make_room(StreamedTexture* for_texture, size_t gpu_bytes)
+{
+    TextureStream* ts = &ctx.texture_stream;
+
+    while (!resources_can_afford(&ctx.resources, 0, gpu_bytes)) {
+        // Levels finer than wanted go first, then the least recently requested textures
+        StreamedTexture* victim = NULL;
+        for (int i = 0; i < ts->textures_count; i++) {
+            StreamedTexture* st = &ts->textures[i];
+            if (st == for_texture || st->resident_base_level >= st->initial_base_level) continue;
+
+            bool surplus = st->resident_base_level < st->wanted_base_level;
+            bool victim_surplus = victim != NULL && victim->resident_base_level < victim->wanted_base_level;
+
+            if (victim == NULL
+                || (surplus && !victim_surplus)
+                || (surplus == victim_surplus && st->last_requested_frame < victim->last_requested_frame)) {
+                victim = st;
+            }
+        }
+
+        // Never starve a texture that is in use for one that is less needed
+        if (victim == NULL) return false;
+        if (victim->resident_base_level >= victim->wanted_base_level && victim->last_requested_frame == ts->frame_index
+            && victim->resident_base_level - victim->wanted_base_level >= for_texture->resident_base_level - 1 - for_texture->wanted_base_level) {
+            return false;
+        }
+
+        texture_stream_drop_level(victim);
+        ts->budget_evictions_count++;
+    }
+
+    return true;
+}
+
+
+void texture_stream_report()
+{
+    TextureStream* ts = &ctx.texture_stream;
+    ArenaMark frame_mark = arena_mark(&ctx.frame_arena);
+
+    size_t resident_bytes = 0;
+    size_t full_bytes = 0;
+
+    LOG_INFO("Texture streaming:");
+    for (int i = 0; i < ts->textures_count; i++) {
+        StreamedTexture* st = &ts->textures[i];
+
+        size_t st_resident_bytes = texture_stream_resident_bytes(st);
+        resident_bytes += st_resident_bytes;
+        full_bytes += texture_gpu_bytes(st->header.width, st->header.height, st->format, st->header.levels_count > 1);
+
+        LOG_INFO("  %4ux%-4u base %2d (wanted %2d, initial %2d) %10s  %s",
+            st->levels[st->resident_base_level].width, st->levels[st->resident_base_level].height,
+            st->resident_base_level, st->wanted_base_level, st->initial_base_level,
+            bytes_to_human_readable(&ctx.frame_arena, st_resident_bytes), st->path);
+    }
+
+    LOG_INFO("  resident: %s of %s fully resident", bytes_to_human_readable(&ctx.frame_arena, resident_bytes), bytes_to_human_readable(&ctx.frame_arena, full_bytes));
+    LOG_INFO("  levels loaded: %llu, evicted: %llu (%llu for budget), uploaded: %s, worst update: %.3f ms",
+        (unsigned long long)ts->levels_loaded_count, (unsigned long long)ts->levels_evicted_count, (unsigned long long)ts->budget_evictions_count,
+        bytes_to_human_readable(&ctx.frame_arena, ts->bytes_uploaded), ts->worst_update_ns / 1000000.0);
+
+    arena_rewind(frame_mark);
+}
+
+
+float level_view_distance(LevelStream* level, Camera* cam)
+{
+    // Nearest hit of a ray through the center and the middle of each screen edge, so walls
+    // right next to the camera count even when looking down a corridor
+    float half_height = tanf(glm_rad(CAMERA_FOV_DEGREES) * 0.5f);
+    float half_width = half_height * (float)ctx.display.width / (float)ctx.display.height;
+
+    vec3 cam_up;
+    glm_cross(cam->right, cam->front, cam_up);
+
+    float offsets[5][2] = { { 0.0f, 0.0f }, { -half_width, 0.0f }, { half_width, 0.0f }, { 0.0f, -half_height }, { 0.0f, half_height } };
+    float nearest = PICK_DISTANCE;
+
+    for (int ray = 0; ray < 5; ray++) {
+        vec3 direction;
+        glm_vec3_copy(cam->front, direction);
+        glm_vec3_muladds(cam->right, offsets[ray][0], direction);
+        glm_vec3_muladds(cam_up, offsets[ray][1], direction);
+        glm_vec3_normalize(direction);
+
+        for (int i = 0; i < level->cells_count; i++) {
+            Mesh* mesh = level->cells[i].mesh;
+            if (mesh == NULL) continue;
+
+            BvhRayHit hit;
+            if (bvh_raycast(&mesh->bvh, cam->position, direction, nearest, &hit)) nearest = hit.t;
+        }
+    }
+
+    return nearest;
+}
+
+
+bool render_init()
+{
+    Renderer* r = &ctx.render;
+
+    r->free_packets = SDL_CreateSemaphore(RENDER_FRAME_PACKETS);
+    r->ready_packets = SDL_CreateSemaphore(0);
+    if (r->free_packets == NULL || r->ready_packets == NULL) {
+        LOG_CRITICAL("Failed to create the frame packet semaphores! SDL error: \n%s", SDL_GetError());
+        return false;
+    }
+
+#if RENDER_THREADED
+    // Created while the update context is current so the two share objects
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+    r->gl = SDL_GL_CreateContext(ctx.display.window);
+    if (r->gl == NULL) {
+        LOG_CRITICAL("Failed to create the render OpenGL context! SDL error: \n%s", SDL_GetError());
+        return false;
+    }
+
+    // Creating a context makes it current, the update thread keeps its own
+    SDL_GL_MakeCurrent(ctx.display.window, ctx.display.gl);
+
+    r->thread = SDL_CreateThread(render_thread, "render", NULL);
+    if (r->thread == NULL) {
+        LOG_CRITICAL("Failed to start the render thread! SDL error: \n%s", SDL_GetError());
+        return false;
+    }
+#else
+    // Drawn on the update context, deletes are still deferred past the packet being filled
+    render_create_objects();
+#endif
+
+    r->running = true;
+
+    return true;
+}
+
+
+void render_quit()
+{
+    Renderer* r = &ctx.render;
+
+    if (r->running) {
+        // The last packet only carries the remaining deletes
+        FramePacket* packet = render_begin_frame();
+        packet->quit = true;
+        render_submit_frame(packet);
+
+#if RENDER_THREADED
+        SDL_WaitThread(r->thread, NULL);
+        r->thread = NULL;
+#else
+        render_destroy_objects();
+#endif
+        r->running = false;
+    }
+
+    // Fences of packets the render thread could not draw, sync objects are shared
+    for (int i = 0; i < RENDER_FRAME_PACKETS; i++) {
+        if (r->packets[i].uploads_fence != NULL) glDeleteSync(r->packets[i].uploads_fence);
+        r->packets[i].uploads_fence = NULL;
+    }
+
+    // Nothing renders anymore, whatever is left can go right away
+    render_flush_deletes(r->pending_deletes, r->pending_deletes_count);
+    r->pending_deletes_count = 0;
+
+    if (r->gl != NULL) SDL_GL_DestroyContext(r->gl);
+    if (r->free_packets != NULL) SDL_DestroySemaphore(r->free_packets);
+    if (r->ready_packets != NULL) SDL_DestroySemaphore(r->ready_packets);
+
+    r->gl = NULL;
+    r->free_packets = NULL;
+    r->ready_packets = NULL;
+}
+
+
+int render_thread(void* userdata)
+{
+    (void)userdata;
+    Renderer* r = &ctx.render;
+
+    bool current = SDL_GL_MakeCurrent(ctx.display.window, r->gl);
+    if (!current) {
+        LOG_CRITICAL("Failed to make the render OpenGL context current! SDL error: \n%s", SDL_GetError());
+        SDL_SetAtomicInt(&r->failed, 1);
+    }
+    else {
+        render_create_objects();
+    }
+
+    // Packets are consumed even without a context so the update thread never blocks forever
+    for (;;) {
+        SDL_WaitSemaphore(r->ready_packets);
+
+        FramePacket* packet = &r->packets[r->read_index];
+        r->read_index = (r->read_index + 1) % RENDER_FRAME_PACKETS;
+
+        bool quit = packet->quit;
+        render_consume_frame(packet, current);
+
+        if (quit) break;
+    }
+
+    if (current) {
+        render_destroy_objects();
+        SDL_GL_MakeCurrent(ctx.display.window, NULL);
+    }
+
+    return 0;
+}
+
+
+void render_create_objects()
+{
+    Renderer* r = &ctx.render;
+
+    // VAOs are not shared between contexts, every mesh is drawn through this one
+    glGenVertexArrays(1, &r->VAO);
+
+    // The overlay layout never changes, orphaning keeps the buffer name
+    glGenVertexArrays(1, &r->overlay_VAO);
+    glGenBuffers(1, &r->overlay_VBO);
+
+    glBindVertexArray(r->overlay_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, r->overlay_VBO);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex), (void*)offsetof(OverlayVertex, x));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex), (void*)offsetof(OverlayVertex, u));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(OverlayVertex), (void*)offsetof(OverlayVertex, color));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+
+    // Light data is read through buffer textures, GL 3.3 has no storage buffers
+    GLenum light_formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R16UI };
+    glGenBuffers(3, r->light_buffers);
+    glGenTextures(3, r->light_textures);
+
+    for (int i = 0; i < 3; i++) {
+        glBindBuffer(GL_TEXTURE_BUFFER, r->light_buffers[i]);
+        glBindTexture(GL_TEXTURE_BUFFER, r->light_textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, light_formats[i], r->light_buffers[i]);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+
+void render_destroy_objects()
+{
+    Renderer* r = &ctx.render;
+
+    glDeleteVertexArrays(1, &r->VAO);
+    glDeleteVertexArrays(1, &r->overlay_VAO);
+    glDeleteBuffers(1, &r->overlay_VBO);
+    glDeleteTextures(3, r->light_textures);
+    glDeleteBuffers(3, r->light_buffers);
+    SDL_memset(r->light_textures, 0, sizeof(r->light_textures));
+    SDL_memset(r->light_buffers, 0, sizeof(r->light_buffers));
+    r->VAO = 0;
+    r->overlay_VAO = 0;
+    r->overlay_VBO = 0;
+}
+
+
+void render_consume_frame(FramePacket* packet, bool drawable)
+{
+    Renderer* r = &ctx.render;
+
+    if (drawable) {
+        uint64_t draw_start_ns = SDL_GetTicksNS();
+
+        render_draw_frame(packet);
+        render_flush_deletes(packet->deletes, packet->deletes_count);
+
+        SDL_SetAtomicU32(&r->draw_us, (Uint32)((SDL_GetTicksNS() - draw_start_ns) / 1000));
+    }
+    packet->deletes_count = 0;
+    SDL_SetAtomicU32(&r->frames_retired, (Uint32)(packet->frame_index + 1));
+
+    SDL_SignalSemaphore(r->free_packets);
+}
+
+
+FramePacket* render_begin_frame()
+{
+    Renderer* r = &ctx.render;
+
+    // Blocks only while the render thread is a whole packet behind
+    SDL_WaitSemaphore(r->free_packets);
+
+    FramePacket* packet = &r->packets[r->write_index];
+    packet->frame_index = r->frames_count++;
+
+    // Left over when the render thread has no context to wait on it
+    if (packet->uploads_fence != NULL) glDeleteSync(packet->uploads_fence);
+    packet->uploads_fence = NULL;
+
+    packet->draws_count = 0;
+    packet->lights_count = 0;
+    packet->light_indices_count = 0;
+    packet->deletes_count = 0;
+    packet->quit = false;
+    packet->overlay_shader = 0;
+    packet->overlay.vertices_count = 0;
+    packet->overlay.batches_count = 0;
+
+    return packet;
+}
+
+
+void render_submit_frame(FramePacket* packet)
+{
+    Renderer* r = &ctx.render;
+
+    // Deletes ride along with the first packet that no longer references the objects
+    SDL_memcpy(packet->deletes, r->pending_deletes, sizeof(RenderDelete) * r->pending_deletes_count);
+    packet->deletes_count = r->pending_deletes_count;
+    r->pending_deletes_count = 0;
+
+    r->write_index = (r->write_index + 1) % RENDER_FRAME_PACKETS;
+
+#if RENDER_THREADED
+    // Uploads made on the update context this frame are visible to the render context
+    // once it waited on this
+    packet->uploads_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    SDL_SignalSemaphore(r->ready_packets);
+#else
+    // Same context, the uploads are already ordered before the draws
+    render_consume_frame(packet, true);
+#endif
+}
+
+
+void render_draw_frame(FramePacket* packet)
+{
+    if (packet->uploads_fence != NULL) {
+        glWaitSync(packet->uploads_fence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(packet->uploads_fence);
+        packet->uploads_fence = NULL;
+    }
+
+    if (packet->quit) return;
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Draw mesh
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, packet->texture);
+
+    render_upload_lights(packet);
+
+    glBindVertexArray(ctx.render.VAO);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+
+    // Cells of one level mostly share a variant, the program only changes between runs of them
+    GLuint bound_shader = 0;
+    GLint model_mat_location = -1;
+
+    for (int i = 0; i < packet->draws_count; i++) {
+        RenderDraw* draw = &packet->draws[i];
+
+        if (draw->shader != bound_shader) {
+            bound_shader = draw->shader;
+            model_mat_location = render_use_shader(packet, bound_shader);
+        }
+
+        glUniformMatrix4fv(model_mat_location, 1, GL_FALSE, &draw->model_mat[0][0]);
+        glBindBuffer(GL_ARRAY_BUFFER, draw->VBO);
+
+        // Position, UV, normal
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, MDL_VERTEX_SIZE, (void*)0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, MDL_VERTEX_SIZE, (void*)(3 * sizeof(float)));
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, MDL_VERTEX_SIZE, (void*)(5 * sizeof(float)));
+
+        glDrawArrays(GL_TRIANGLES, 0, draw->vertex_count);
+    }
+
+    render_draw_overlay(packet);
+
+    // Flush
+    SDL_GL_SwapWindow(ctx.display.window);
+}
+
+
+void render_delete(RenderDeleteKind kind, GLuint name)
+{
+    render_defer((RenderDelete){ .kind = kind, .name = name });
+}
+
+
+void render_texture_level(RenderDeleteKind kind, GLuint texture, int level)
+{
+    render_defer((RenderDelete){ .kind = kind, .name = texture, .level = level });
+}
+
+
+void render_defer(RenderDelete object)
+{
+    Renderer* r = &ctx.render;
+
+    // Packets in flight can still reference the object, and a name deleted now could be
+    // handed out again for something else before they are drawn
+    if (!r->running) {
+        render_flush_deletes(&object, 1);
+        return;
+    }
+
+    if (r->pending_deletes_count == MAX_DEFERRED_DELETES) {
+        LOG_WARNING("Too many deferred GL deletes, waiting for the render thread.");
+        render_wait_idle();
+        render_flush_deletes(&object, 1);
+        return;
+    }
+
+    r->pending_deletes[r->pending_deletes_count++] = object;
+}
+
+
+void render_forget_texture_levels(GLuint texture)
+{
+    Renderer* r = &ctx.render;
+
+    // Order matters between the changes that are kept
+    int kept_count = 0;
+    for (int i = 0; i < r->pending_deletes_count; i++) {
+        RenderDelete* object = &r->pending_deletes[i];
+
+        bool level_change = object->kind == RENDER_DELETE_TEXTURE_LEVEL || object->kind == RENDER_SET_TEXTURE_BASE_LEVEL;
+        if (level_change && object->name == texture) continue;
+
+        r->pending_deletes[kept_count++] = *object;
+    }
+
+    r->pending_deletes_count = kept_count;
+}
+
+
+void render_flush_deletes(RenderDelete* deletes, int deletes_count)
+{
+    for (int i = 0; i < deletes_count; i++) {
+        switch (deletes[i].kind)
+        {
+        case RENDER_DELETE_BUFFER: glDeleteBuffers(1, &deletes[i].name); break;
+        case RENDER_DELETE_TEXTURE: glDeleteTextures(1, &deletes[i].name); break;
+        case RENDER_DELETE_PROGRAM: glDeleteProgram(deletes[i].name); break;
+        case RENDER_DELETE_TEXTURE_LEVEL: {
+            // Move the base first so the texture never references the level being released
+            glBindTexture(GL_TEXTURE_2D, deletes[i].name);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, deletes[i].level + 1);
+            glTexImage2D(GL_TEXTURE_2D, deletes[i].level, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        } break;
+        case RENDER_SET_TEXTURE_BASE_LEVEL: {
+            glBindTexture(GL_TEXTURE_2D, deletes[i].name);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, deletes[i].level);
+        } break;
+        }
+    }
+}
+
+
+bool render_frame_retired(uint64_t frame_index)
+{
+    Renderer* r = &ctx.render;
+
+    // Without a renderer every change happens right away
+    if (!r->running) return true;
+
+    return (Sint32)(SDL_GetAtomicU32(&r->frames_retired) - (Uint32)(frame_index + 1)) >= 0;
+}
+
+
+void render_wait_idle()
+{
+    Renderer* r = &ctx.render;
+    if (!r->running) return;
+
+    // Every packet back in the free pool means nothing is queued or being drawn
+    for (int i = 0; i < RENDER_FRAME_PACKETS; i++) SDL_WaitSemaphore(r->free_packets);
+    for (int i = 0; i < RENDER_FRAME_PACKETS; i++) SDL_SignalSemaphore(r->free_packets);
+}
+
+
+bool hud_init()
+{
+    Hud* hud = &ctx.hud;
+
+    FontHeader font;
+    hud->font_texture = io_load_font(ASSETS_ROOT_PATH "/" FONT_OVERLAY_PATH, &font);
+    if (hud->font_texture == 0) return false;
+
+    hud->shader = create_generic_shader("./assets/shaders/overlay.vs", "./assets/shaders/overlay.fs", 0);
+    if (hud->shader == 0) {
+        destroy_texture(hud->font_texture);
+        hud->font_texture = 0;
+        return false;
+    }
+
+    overlay_init(&hud->overlay, &font, hud->font_texture);
+    hud->visible = true;
+
+    return true;
+}
+
+
+void hud_quit()
+{
+    destroy_texture(ctx.hud.font_texture);
+    destroy_shader(ctx.hud.shader);
+
+    ctx.hud.font_texture = 0;
+    ctx.hud.shader = 0;
+    ctx.hud.visible = false;
+}
+
+
+GLuint io_load_font(const char* path, FontHeader* out_font)
+{
+    uint64_t load_start_ns = SDL_GetTicksNS();
+
+    FileEntry* file_entry = io_get_file_entry(path);
+    if (file_entry == NULL) {
+        LOG_ERROR("Could not find font file!");
+        return 0;
+    }
+
+    FontHeader header = {0};
+    SDL_IOStream* io = vfs_open(&ctx.vfs, file_entry, 0);
+    if (io == NULL || SDL_ReadIO(io, &header, sizeof(FontHeader)) < sizeof(FontHeader)) {
+        LOG_ERROR("Failed to read the font header: %s!", path);
+        return 0;
+    }
+
+    if (!font_header_valid(&header, file_entry->size)) {
+        LOG_ERROR("Invalid or outdated font: %s!", path);
+        return 0;
+    }
+
+    size_t atlas_size = (size_t)header.atlas_width * header.atlas_height;
+
+    ArenaMark load_mark = arena_mark(&ctx.load_arena);
+
+    unsigned char* atlas = (unsigned char*)arena_alloc(&ctx.load_arena, atlas_size);
+    if (!atlas) {
+        LOG_ERROR("Failed to allocate %zu bytes for the font atlas!", atlas_size);
+        arena_rewind(load_mark);
+        return 0;
+    }
+
+    if (SDL_ReadIO(io, atlas, atlas_size) < atlas_size) {
+        LOG_ERROR("Failed to read the font atlas: %s! SDL error:\n%s", path, SDL_GetError());
+        arena_rewind(load_mark);
+        return 0;
+    }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, header.atlas_width, header.atlas_height, 0, GL_RED, GL_UNSIGNED_BYTE, atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    arena_rewind(load_mark);
+
+    resources_register(&ctx.resources, RESOURCE_TEXTURE, path, texture, 0, texture_gpu_bytes(header.atlas_width, header.atlas_height, GL_RED, false), SDL_GetTicksNS() - load_start_ns);
+
+    *out_font = header;
+    return texture;
+}
+
+
+void hud_draw_stats(FramePacket* packet, float delta_seconds, uint64_t update_ns)
+{
+    Hud* hud = &ctx.hud;
+    Overlay* overlay = &hud->overlay;
+
+    uint64_t build_start_ns = SDL_GetTicksNS();
+
+    overlay_begin(overlay);
+
+    ArenaMark frame_mark = arena_mark(&ctx.frame_arena);
+
+    float scale = HUD_TEXT_SCALE;
+    float x = HUD_MARGIN;
+    float y = HUD_MARGIN;
+    uint32_t color = OVERLAY_RGBA(255, 255, 255, 255);
+
+    LevelStream* level = &ctx.g.level;
+
+    y = overlay_textf(overlay, 1, x, y, scale, color, "frame  %6.2f ms  %5.0f fps", delta_seconds * 1000.0f, delta_seconds > 0.0f ? 1.0f / delta_seconds : 0.0f);
+    y = overlay_textf(overlay, 1, x, y, scale, color, "update %6.2f ms", update_ns / 1000000.0);
+    y = overlay_textf(overlay, 1, x, y, scale, color, "render %6.2f ms", SDL_GetAtomicU32(&ctx.render.draw_us) / 1000.0);
+    y = overlay_textf(overlay, 1, x, y, scale, color, "hud    %6.3f ms  %d quads", hud->build_ns / 1000000.0, hud->last_quads_count);
+    y = overlay_textf(overlay, 1, x, y, scale, color, "draws  %d level, %d overlay", packet->draws_count, hud->last_batches_count);
+    y = overlay_textf(overlay, 1, x, y, scale, color, "cells  %d / %d resident", level->resident_count, level->cells_count);
+    y = overlay_textf(overlay, 1, x, y, scale, color, "lights %d, %u refs, %.3f ms", packet->lights_count, packet->light_indices_count, ctx.g.clusters.assign_ns / 1000000.0);
+    y = overlay_textf(overlay, 1, x, y, scale, color, "xforms %u, %u moved, %.3f ms", ctx.g.transforms.count, ctx.g.transforms.updated_count, ctx.g.transforms.update_ns / 1000000.0);
+    y = overlay_textf(overlay, 1, x, y, scale, color, "cpu    %s / %s",
+        bytes_to_human_readable(&ctx.frame_arena, resources_total_cpu_bytes(&ctx.resources)),
+        bytes_to_human_readable(&ctx.frame_arena, ctx.resources.cpu_budget));
+    y = overlay_textf(overlay, 1, x, y, scale, color, "gpu    %s / %s",
+        bytes_to_human_readable(&ctx.frame_arena, resources_total_gpu_bytes(&ctx.resources)),
+        bytes_to_human_readable(&ctx.frame_arena, ctx.resources.gpu_budget));
+
+    arena_rewind(frame_mark);
+
+    // Backdrop sized to the text, one layer below it
+    float width = HUD_STATS_COLUMNS * overlay->font.glyph_width * scale;
+    overlay_rect(overlay, 0, x - HUD_MARGIN * 0.5f, HUD_MARGIN * 0.5f, width + HUD_MARGIN, y - HUD_MARGIN * 0.5f, OVERLAY_RGBA(0, 0, 0, 160));
+
+    overlay_build(overlay, &packet->overlay);
+    packet->overlay_shader = hud->shader;
+
+    hud->last_quads_count = overlay->quads_count;
+    hud->last_batches_count = packet->overlay.batches_count;
+    hud->build_ns = SDL_GetTicksNS() - build_start_ns;
+}
+
+
+void render_draw_overlay(FramePacket* packet)
+{
+    Renderer* r = &ctx.render;
+    OverlayDrawList* list = &packet->overlay;
+
+    if (list->vertices_count == 0 || packet->overlay_shader == 0) return;
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glUseProgram(packet->overlay_shader);
+    glUniform2f(glGetUniformLocation(packet->overlay_shader, "u_screen_size"), (float)ctx.display.width, (float)ctx.display.height);
+    glUniform1i(glGetUniformLocation(packet->overlay_shader, "u_texture"), 0);
+
+    // Orphan the previous frame's vertices instead of waiting for the GPU to be done with them
+    glBindVertexArray(r->overlay_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, r->overlay_VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(list->vertices), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(OverlayVertex) * list->vertices_count, list->vertices);
+
+    glActiveTexture(GL_TEXTURE0);
+    for (int i = 0; i < list->batches_count; i++) {
+        OverlayBatch* batch = &list->batches[i];
+
+        glBindTexture(GL_TEXTURE_2D, batch->texture);
+        glDrawArrays(GL_TRIANGLES, batch->first_vertex, batch->vertices_count);
+    }
+
+    glDisable(GL_BLEND);
+}
+
+
+void render_upload_lights(FramePacket* packet)
+{
+    Renderer* r = &ctx.render;
+
+    // Orphaned every frame like the overlay vertices, an empty buffer texture is still valid
+    const void* data[3] = { packet->lights, packet->cluster_ranges, packet->light_indices };
+    size_t sizes[3] = {
+        sizeof(ClusterLight) * packet->lights_count,
+        sizeof(packet->cluster_ranges),
+        sizeof(uint16_t) * packet->light_indices_count,
+    };
+    size_t capacities[3] = { sizeof(packet->lights), sizeof(packet->cluster_ranges), sizeof(packet->light_indices) };
+
+    for (int i = 0; i < 3; i++) {
+        glBindBuffer(GL_TEXTURE_BUFFER, r->light_buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, capacities[i], NULL, GL_STREAM_DRAW);
+        if (sizes[i] > 0) glBufferSubData(GL_TEXTURE_BUFFER, 0, sizes[i], data[i]);
+
+        glActiveTexture(GL_TEXTURE1 + i);
+        glBindTexture(GL_TEXTURE_BUFFER, r->light_textures[i]);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+
+GLint render_use_shader(FramePacket* packet, GLuint shader)
+{
+    glUseProgram(shader);
+
+    glUniformMatrix4fv(glGetUniformLocation(shader, "u_view_mat"), 1, GL_FALSE, &packet->view_mat[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(shader, "u_proj_mat"), 1, GL_FALSE, &packet->proj_mat[0][0]);
+
+    // Material uniforms
+    glUniform1i(glGetUniformLocation(shader, "u_texture"), 0);
+
+    // Not there in variants built without LIGHTING, setting them is then a no-op
+    glUniform1i(glGetUniformLocation(shader, "u_lights"), 1);
+    glUniform1i(glGetUniformLocation(shader, "u_cluster_ranges"), 2);
+    glUniform1i(glGetUniformLocation(shader, "u_light_indices"), 3);
+    glUniform3ui(glGetUniformLocation(shader, "u_cluster_dims"), CLUSTER_DIM_X, CLUSTER_DIM_Y, CLUSTER_DIM_Z);
+    glUniform2f(glGetUniformLocation(shader, "u_cluster_z_params"), packet->cluster_z_params[0], packet->cluster_z_params[1]);
+    glUniform2f(glGetUniformLocation(shader, "u_screen_size"), (float)ctx.display.width, (float)ctx.display.height);
+
+    return glGetUniformLocation(shader, "u_model_mat");
+}
+
+
+bool stress_spawn(StressEntities* stress, TransformSystem* ts, TransformId root, int count)
+{
+    stress->ids = SDL_malloc(sizeof(TransformId) * count);
+    if (stress->ids == NULL) {
+        LOG_ERROR("Failed to allocate %d stress entities!", count);
+        return false;
+    }
+
+    transform_grow(ts, ts->count + count);
+
+    // Short chains so the hierarchy is exercised, not only flat roots
+    TransformId previous = root;
+    for (int i = 0; i < count; i++) {
+        TransformId parent = i % STRESS_CHAIN_LENGTH == 0 ? root : previous;
+
+        TransformId id = transform_create(ts, parent);
+        if (id == TRANSFORM_INVALID) break;
+
+        // Chain roots on a grid, the rest offset from their parent
+        float grid_position[3] = { (float)(i % 100) - 50.0f, 0.5f, (float)(i / 100 % 100) - 50.0f };
+        float chain_position[3] = { 1.0f, 0.0f, 0.0f };
+        transform_set_position(ts, id, parent == root ? grid_position : chain_position);
+
+        stress->ids[stress->count++] = id;
+        previous = id;
+    }
+
+    LOG_INFO("Spawned %d stress entities", stress->count);
+    return true;
+}
+
+
+void stress_update(StressEntities* stress, TransformSystem* ts, float time_seconds)
+{
+    // Every entity spins, so every world matrix is rebuilt every frame
+    for (int i = 0; i < stress->count; i++) {
+        float half_angle = (time_seconds + i * 0.01f) * 0.5f;
+        float rotation[4] = { 0.0f, sinf(half_angle), 0.0f, cosf(half_angle) };
+
+        transform_set_rotation(ts, stress->ids[i], rotation);
+    }
+}
+
+
+void lights_spawn(Game* g)
+{
+    LevelStream* level = &g->level;
+    if (level->cells_count == 0) return;
+
+    // Bounds of the whole level from the cell index, nothing needs to be resident. A level
+    // without an index is one unbounded cell, that one is always resident and its BVH root
+    // has the real bounds.
+    vec3 bounds_min = { FLT_MAX, FLT_MAX, FLT_MAX };
+    vec3 bounds_max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (int i = 0; i < level->cells_count; i++) {
+        StreamCell* cell = &level->cells[i];
+
+        const float* cell_min = cell->info.bounds_min;
+        const float* cell_max = cell->info.bounds_max;
+        if (cell_min[0] == -FLT_MAX || cell_max[0] == FLT_MAX) {
+            if (cell->mesh == NULL || cell->mesh->bvh.header == NULL || cell->mesh->bvh.header->triangles_count == 0) continue;
+
+            cell_min = cell->mesh->bvh.nodes[0].bounds_min;
+            cell_max = cell->mesh->bvh.nodes[0].bounds_max;
+        }
+
+        glm_vec3_minv(bounds_min, (float*)cell_min, bounds_min);
+        glm_vec3_maxv(bounds_max, (float*)cell_max, bounds_max);
+    }
+
+    if (bounds_min[0] > bounds_max[0] || bounds_min[2] > bounds_max[2]) {
+        LOG_WARNING("The level has no known bounds, not placing any lights.");
+        g->lights_count = 0;
+        return;
+    }
+
+    const float palette[4][3] = {
+        { 1.0f, 0.55f, 0.25f },
+        { 0.35f, 0.6f, 1.0f },
+        { 1.0f, 0.9f, 0.7f },
+        { 0.5f, 1.0f, 0.45f },
+    };
+
+    float step_x = (bounds_max[0] - bounds_min[0]) / LEVEL_LIGHTS_PER_SIDE;
+    float step_z = (bounds_max[2] - bounds_min[2]) / LEVEL_LIGHTS_PER_SIDE;
+    float height = bounds_min[1] + (bounds_max[1] - bounds_min[1]) * 0.25f;
+
+    g->lights_count = 0;
+    for (int z = 0; z < LEVEL_LIGHTS_PER_SIDE; z++) {
+        for (int x = 0; x < LEVEL_LIGHTS_PER_SIDE && g->lights_count < MAX_LIGHTS; x++) {
+            ClusterLight* light = &g->lights[g->lights_count];
+
+            light->position[0] = bounds_min[0] + (x + 0.5f) * step_x;
+            light->position[1] = height;
+            light->position[2] = bounds_min[2] + (z + 0.5f) * step_z;
+            light->radius = SDL_max(step_x, step_z) * 1.5f;
+
+            SDL_memcpy(light->color, palette[(x + z * 3) % 4], sizeof(light->color));
+            light->intensity = 1.5f;
+
+            g->lights_count++;
+        }
+    }
 
-    return str;
+    LOG_INFO("Placed %d lights over the level", g->lights_count);
 }
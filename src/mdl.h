@@ -0,0 +1,67 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+/*
+** mdl meshes
+**
+** An `int` triangle count followed by `count * 3` interleaved vertices, no indices:
+**
+**     position (3 floats), uv (2 floats), normal (3 floats)
+**
+** Levels are also split by `pack` into cells on a square XZ grid, bucketed by triangle
+** centroid, so they can be streamed around the camera. Every cell is a valid mdl of its own
+** at `<mesh path>.cell.<x>_<z>`, listed in a `<mesh path>.cells` index with its triangle
+** bounds (which can stick out of the grid square).
+*/
+
+/*
+** Macros
+*/
+
+#define MDL_FLOATS_PER_VERTEX (3 + 2 + 3) // Position, UV, normal
+#define MDL_VERTEX_SIZE (sizeof(float) * MDL_FLOATS_PER_VERTEX)
+
+#define MDL_CELLS_MAGIC "CEL1"
+#define MDL_CELLS_VERSION 1
+#define MDL_CELLS_SUFFIX ".cells"
+#define MDL_CELL_PATH_FORMAT "%s.cell.%d_%d"
+#define MDL_CELL_SIZE 16.0f
+
+/*
+** Structs
+*/
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    float cell_size;
+    uint32_t cells_count;
+} MdlCellsHeader;
+
+typedef struct {
+    int32_t x;
+    int32_t z;
+    uint32_t triangles_count;
+    uint32_t reserved;
+    float bounds_min[3];
+    float bounds_max[3];
+} MdlCell;
+
+/*
+** Declarations
+*/
+
+bool mdl_is_source_path(const char* path);
+
+/*
+** Implementation
+*/
+
+bool mdl_is_source_path(const char* path)
+{
+    const char* extension = SDL_strrchr(path, '.');
+    if (extension == NULL) return false;
+
+    return SDL_strcmp(extension, ".mdl") == 0;
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <stdarg.h>
+
+#include "font.h"
+
+/*
+** 2D overlay
+**
+** Immediate mode quads and text in screen pixels, top left origin. Quads are queued during
+** the frame and `overlay_build` sorts them by layer, then texture, into one vertex array and
+** a list of batches, one draw call each. Text and untextured quads share the font atlas, so a
+** HUD made of only those is a single batch. Within a layer and texture quads keep their
+** submission order.
+*/
+
+/*
+** Macros
+*/
+
+#define OVERLAY_MAX_QUADS 4096
+#define OVERLAY_MAX_BATCHES 64
+#define OVERLAY_VERTICES_PER_QUAD 6
+#define OVERLAY_TEXT_LENGTH 512
+
+#define OVERLAY_RGBA(r, g, b, a) ((uint32_t)(r) | ((uint32_t)(g) << 8) | ((uint32_t)(b) << 16) | ((uint32_t)(a) << 24))
+
+/*
+** Structs
+*/
+
+typedef struct {
+    float x, y;
+    float u, v;
+    uint32_t color; // RGBA8, red in the lowest byte
+} OverlayVertex;
+
+typedef struct {
+    uint64_t key; // Layer, texture, submission order
+    uint32_t texture;
+    float rect[4]; // x0, y0, x1, y1
+    float uv[4]; // u0, v0, u1, v1
+    uint32_t color;
+} OverlayQuad;
+
+typedef struct {
+    uint32_t texture;
+    int first_vertex;
+    int vertices_count;
+} OverlayBatch;
+
+// What the render thread needs to draw the overlay of one frame
+typedef struct {
+    OverlayVertex vertices[OVERLAY_MAX_QUADS * OVERLAY_VERTICES_PER_QUAD];
+    int vertices_count;
+
+    OverlayBatch batches[OVERLAY_MAX_BATCHES];
+    int batches_count;
+} OverlayDrawList;
+
+typedef struct {
+    OverlayQuad quads[OVERLAY_MAX_QUADS];
+    int quads_count;
+    int dropped_count; // Quads over the limit this frame
+
+    FontHeader font;
+    uint32_t font_texture;
+    float solid_uv[2]; // Center of the font's solid cell
+} Overlay;
+
+/*
+** Declarations
+*/
+
+void overlay_init(Overlay* overlay, const FontHeader* font, uint32_t font_texture);
+void overlay_begin(Overlay* overlay);
+void overlay_build(Overlay* overlay, OverlayDrawList* out);
+
+void overlay_quad(Overlay* overlay, int layer, uint32_t texture, const float rect[4], const float uv[4], uint32_t color);
+void overlay_rect(Overlay* overlay, int layer, float x, float y, float width, float height, uint32_t color);
+float overlay_text(Overlay* overlay, int layer, float x, float y, float scale, uint32_t color, const char* text);
+float overlay_textf(Overlay* overlay, int layer, float x, float y, float scale, uint32_t color, const char* format, ...);
+
+int overlay_compare_quads(const void* a, const void* b);
+
+/*
+** Implementation
+*/
+
+void overlay_init(Overlay* overlay, const FontHeader* font, uint32_t font_texture)
+{
+    SDL_memset(overlay, 0, sizeof(Overlay));
+
+    overlay->font = *font;
+    overlay->font_texture = font_texture;
+
+    float solid_uv[4];
+    font_cell_uv(font, font->solid_cell, solid_uv);
+    overlay->solid_uv[0] = (solid_uv[0] + solid_uv[2]) * 0.5f;
+    overlay->solid_uv[1] = (solid_uv[1] + solid_uv[3]) * 0.5f;
+}
+
+
+void overlay_begin(Overlay* overlay)
+{
+    overlay->quads_count = 0;
+    overlay->dropped_count = 0;
+}
+
+
+void overlay_build(Overlay* overlay, OverlayDrawList* out)
+{
+    out->vertices_count = 0;
+    out->batches_count = 0;
+
+    // Stable, the submission order is the lowest part of the key
+    SDL_qsort(overlay->quads, overlay->quads_count, sizeof(OverlayQuad), overlay_compare_quads);
+
+    for (int i = 0; i < overlay->quads_count; i++) {
+        OverlayQuad* quad = &overlay->quads[i];
+
+        OverlayBatch* batch = out->batches_count > 0 ? &out->batches[out->batches_count - 1] : NULL;
+        if (batch == NULL || batch->texture != quad->texture) {
+            if (out->batches_count == OVERLAY_MAX_BATCHES) {
+                overlay->dropped_count += overlay->quads_count - i;
+                break;
+            }
+
+            batch = &out->batches[out->batches_count++];
+            batch->texture = quad->texture;
+            batch->first_vertex = out->vertices_count;
+            batch->vertices_count = 0;
+        }
+
+        // Two triangles, counter clockwise on screen
+        const float* r = quad->rect;
+        const float* uv = quad->uv;
+        OverlayVertex* v = &out->vertices[out->vertices_count];
+
+        v[0] = (OverlayVertex){ r[0], r[1], uv[0], uv[1], quad->color };
+        v[1] = (OverlayVertex){ r[0], r[3], uv[0], uv[3], quad->color };
+        v[2] = (OverlayVertex){ r[2], r[3], uv[2], uv[3], quad->color };
+        v[3] = v[0];
+        v[4] = v[2];
+        v[5] = (OverlayVertex){ r[2], r[1], uv[2], uv[1], quad->color };
+
+        out->vertices_count += OVERLAY_VERTICES_PER_QUAD;
+        batch->vertices_count += OVERLAY_VERTICES_PER_QUAD;
+    }
+}
+
+
+void overlay_quad(Overlay* overlay, int layer, uint32_t texture, const float rect[4], const float uv[4], uint32_t color)
+{
+    if (overlay->quads_count == OVERLAY_MAX_QUADS) {
+        overlay->dropped_count++;
+        return;
+    }
+
+    OverlayQuad* quad = &overlay->quads[overlay->quads_count];
+    quad->key = ((uint64_t)(layer & 0xff) << 56) | ((uint64_t)(texture & 0xffffff) << 32) | (uint32_t)overlay->quads_count;
+    quad->texture = texture;
+    SDL_memcpy(quad->rect, rect, sizeof(quad->rect));
+    SDL_memcpy(quad->uv, uv, sizeof(quad->uv));
+    quad->color = color;
+
+    overlay->quads_count++;
+}
+
+
+void overlay_rect(Overlay* overlay, int layer, float x, float y, float width, float height, uint32_t color)
+{
+    float rect[4] = { x, y, x + width, y + height };
+    float uv[4] = { overlay->solid_uv[0], overlay->solid_uv[1], overlay->solid_uv[0], overlay->solid_uv[1] };
+
+    overlay_quad(overlay, layer, overlay->font_texture, rect, uv, color);
+}
+
+
+float overlay_text(Overlay* overlay, int layer, float x, float y, float scale, uint32_t color, const char* text)
+{
+    float glyph_width = overlay->font.glyph_width * scale;
+    float glyph_height = overlay->font.glyph_height * scale;
+
+    float pen_x = x;
+    float pen_y = y;
+
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '\n') {
+            pen_x = x;
+            pen_y += glyph_height;
+            continue;
+        }
+
+        uint32_t cell = (uint32_t)(unsigned char)*c - overlay->font.first_char;
+        if (cell >= overlay->font.chars_count) cell = '?' - overlay->font.first_char;
+
+        // Spaces only move the pen
+        if (*c != ' ') {
+            float rect[4] = { pen_x, pen_y, pen_x + glyph_width, pen_y + glyph_height };
+            float uv[4];
+            font_cell_uv(&overlay->font, cell, uv);
+
+            overlay_quad(overlay, layer, overlay->font_texture, rect, uv, color);
+        }
+
+        pen_x += glyph_width;
+    }
+
+    // Where the next line starts
+    return pen_y + glyph_height;
+}
+
+
+float overlay_textf(Overlay* overlay, int layer, float x, float y, float scale, uint32_t color, const char* format, ...)
+{
+    char text[OVERLAY_TEXT_LENGTH];
+
+    va_list args;
+    va_start(args, format);
+    SDL_vsnprintf(text, OVERLAY_TEXT_LENGTH, format, args);
+    va_end(args);
+
+    return overlay_text(overlay, layer, x, y, scale, color, text);
+}
+
+
+int overlay_compare_quads(const void* a, const void* b)
+{
+    uint64_t key_a = ((const OverlayQuad*)a)->key;
+    uint64_t key_b = ((const OverlayQuad*)b)->key;
+
+    return (key_a > key_b) - (key_a < key_b);
+}
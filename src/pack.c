@@ -1,4 +1,21 @@
+#include "log.h"
 #include "str_utils.h"
+#include "shader_features.h"
+#include "mdl.h"
+#include "bvh.h"
+#include "texture_format.h"
+#include "font.h"
+#include "archive.h"
+#include "dir_scan.h"
+
+// stb_image allocates through this arena while an image is being decoded (heap if NULL)
+Arena* stbi_arena = NULL;
+
+#define STBI_MALLOC(size) arena_alloc(stbi_arena, size)
+#define STBI_REALLOC(ptr, size) arena_realloc(stbi_arena, ptr, size)
+#define STBI_FREE(ptr) arena_release(stbi_arena, ptr)
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
 
 /*
 ** Macros
@@ -6,21 +23,12 @@
 
 #define MAX_PATH_LENGTH 512
 
-#define __FILENAME__ (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
+#define GENERATED_ARENA_BLOCK_SIZE (256 * 1024)
+#define SCRATCH_ARENA_BLOCK_SIZE (16 * 1024 * 1024)
+#define COPY_CHUNK_SIZE (1024 * 1024)
 
 #define BYTES_TO_PB(b) (double)b / (1024.0 * 1024.0 * 1024.0 * 1024.0 * 1024.0)
 
-#define LOG_DEBUG(format_string, ...) \
-    SDL_Log("debug:    %s:%d %s - " format_string "\n", __FILENAME__, __LINE__, __func__, ##__VA_ARGS__)
-#define LOG_INFO(format_string, ...) \
-    SDL_Log("info:     %s:%d %s - " format_string "\n", __FILENAME__, __LINE__, __func__, ##__VA_ARGS__)
-#define LOG_WARNING(format_string, ...) \
-    SDL_Log("warning:  %s:%d %s - " format_string "\n", __FILENAME__, __LINE__, __func__, ##__VA_ARGS__)
-#define LOG_ERROR(format_string, ...) \
-    SDL_Log("error:    %s:%d %s - " format_string "\n", __FILENAME__, __LINE__, __func__, ##__VA_ARGS__)
-#define LOG_CRITICAL(format_string, ...) \
-    SDL_Log("critical: %s:%d %s - " format_string "\n", __FILENAME__, __LINE__, __func__, ##__VA_ARGS__)
-
 /*
 ** Structs
 */
@@ -30,32 +38,59 @@ typedef struct {
     char path[MAX_PATH_LENGTH];
     size_t file_offset;
     size_t file_size;
+
+    void* data; // Generated contents (e.g. shader variants) until written out, NULL if the entry is read from `path`
+    int alias_of; // Index of the entry whose contents this one shares, -1 if it has its own
+    uint32_t flags; // ARCHIVE_ENTRY_*
+
+    bool dumped; // Its blob is in the output file, entries that failed are left out of the index
 } FileEntry;
 
 /*
 ** Declarations
 */
 
-void scan_dir(char* path);
-
-SDL_EnumerationResult list_dir(void *userdata, const char *dirname, const char *fname);
+void* read_whole_file(const char* path, Arena* arena, size_t* out_size);
 
-size_t get_file_size(char* path);
+int push_file_entry(const char* path, size_t file_size, void* data, int alias_of);
+void dump_file_entries(SDL_IOStream* out_file);
+bool dump_file_entry(SDL_IOStream* out_file, FileEntry* file_entry);
+void push_shader_variants(int source_entry_index);
+void push_mesh_bvh(const char* mesh_path, const unsigned char* mdl, size_t mdl_size);
+void push_mesh_cells(int source_entry_index);
+int compare_cell_keys(const void* a, const void* b);
+void push_cooked_texture(int source_entry_index);
+void push_overlay_font(const char* root_path);
 
 /*
 ** Implementation
 */
 
-char** in_files_paths = NULL;
-int in_files_count = 0;
 char** exclusion_patterns = NULL;
 int exclusion_patterns_count = 0;
+char** inclusion_patterns = NULL;
+int inclusion_patterns_count = 0;
+
+FileEntry* file_entires = NULL;
+int file_entires_count = 0;
+int file_entires_capacity = 0;
+int dumped_entries_count = 0; // Entries before this one have been written out, successfully or not
+
+uint32_t blob_alignment = ARCHIVE_DEFAULT_ALIGNMENT;
+
+Arena generated_arena = {0}; // Contents generated from the current source, rewound once they are written out
+Arena scratch_arena = {0}; // Per file, rewound after each one
 
 int main(int args_count, char* args[])
 {
+    arena_init(&generated_arena, GENERATED_ARENA_BLOCK_SIZE);
+    arena_init(&scratch_arena, SCRATCH_ARENA_BLOCK_SIZE);
+
     // Parse args
     char* in_path = SDL_strdup("assets");
     char* out_path = SDL_strdup("assets.bin");
+    char* binary_log_path = NULL;
+    int threads_count = SDL_GetNumLogicalCPUCores();
 
     for (int arg_index = 1; arg_index < args_count; arg_index++) {
         char* arg = args[arg_index];
@@ -74,213 +109,585 @@ int main(int args_count, char* args[])
 
             exclusion_patterns[exclusion_patterns_count++] = SDL_strdup(arg + 3);
         }
+
+        if (str_starts_with(arg, "-f:")) {
+            size_t new_size = sizeof(char*) * (inclusion_patterns_count + 1);
+            inclusion_patterns = SDL_realloc(inclusion_patterns, new_size);
+
+            inclusion_patterns[inclusion_patterns_count++] = SDL_strdup(arg + 3);
+        }
+
+        if (str_starts_with(arg, "-j:")) {
+            threads_count = SDL_atoi(arg + strlen("-j:"));
+        }
+
+        if (str_starts_with(arg, "-a:")) {
+            blob_alignment = (uint32_t)SDL_atoi(arg + strlen("-a:"));
+        }
+
+        if (str_starts_with(arg, "-l:")) {
+            binary_log_path = str_override(binary_log_path, arg + strlen("-l:"));
+        }
     }
 
+    log_init(true, binary_log_path);
+
     LOG_INFO("Input dir: %s", in_path);
     LOG_INFO("Ouput file: %s", out_path);
-    LOG_INFO("Excluded files: %d", exclusion_patterns_count);
+    LOG_INFO("Exclusion patterns: %d, inclusion patterns: %d", exclusion_patterns_count, inclusion_patterns_count);
+
+    if (!archive_is_valid_alignment(blob_alignment)) {
+        LOG_ERROR("Blob alignment must be a power of two up to %d, got %u!", ARCHIVE_MAX_ALIGNMENT, blob_alignment);
+        log_quit();
+        return 1;
+    }
 
     // Scan
     LOG_INFO("Scanning input directory");
-    scan_dir(in_path);
+
+    PathMatcher matcher;
+    if (!path_matcher_compile(&matcher, inclusion_patterns, inclusion_patterns_count, exclusion_patterns, exclusion_patterns_count)) {
+        log_quit();
+        return 1;
+    }
+
+    DirScan scan;
+    if (!dir_scan(&scan, in_path, &matcher, threads_count)) {
+        LOG_ERROR("Some of %s could not be scanned, the archive will miss files!", in_path);
+    }
+
+    LOG_INFO("Scanned %llu directories with %d threads in %.2f ms: %d files, %llu excluded",
+        (unsigned long long)scan.dirs_count, scan.workers_count, scan.scan_ns / 1000000.0, scan.files_count, (unsigned long long)scan.excluded_count);
 
     // Create output file file
     LOG_INFO("Creating output file");
     SDL_IOStream* out_file = SDL_IOFromFile(out_path, "w");
     if (!out_file) {
         LOG_ERROR("Failed to open output file! SDL error:\n%s", SDL_GetError());
+        log_quit();
         return 1;
     }
 
-    // Header
-    LOG_DEBUG("Writing header");
-    SDL_WriteIO(out_file, &in_files_count, sizeof(int));
+    // Header, patched with the entries count and index offset once they are known
+    ArchiveHeader header = {0};
+    SDL_memcpy(header.magic, ARCHIVE_MAGIC, 4);
+    header.version = ARCHIVE_VERSION;
+    header.alignment = blob_alignment;
 
-    size_t header_size = SDL_TellIO(out_file);
+    if (!archive_write_header(out_file, &header)) {
+        SDL_CloseIO(out_file);
+        log_quit();
+        return 1;
+    }
 
-    // File index
-    LOG_DEBUG("Creating file index");
-    FileEntry* file_entires = NULL;
-    int file_entires_count = 0;
-
-    // We will first write the header & the file entires index then pack
-    // then raw data of each file, one after another.
-    // We use increment this variable evry time a file's data is written to track when the next one begins.
-    size_t file_entires_size = sizeof(FileEntry) * in_files_count;
-    file_entires = SDL_malloc(file_entires_size);
-
-    size_t index_section_size = 0;
-    size_t file_offset = 0;
-    for (int i = 0; i < in_files_count; i++) {
-        char* file_path = in_files_paths[i];
-        LOG_DEBUG("Creating entry #%d: %s", i, file_path);
-
-        FileEntry* f = &file_entires[file_entires_count++];
-
-        // Path
-        f->path_size = strlen(file_path) + 1;
-        SDL_memset(f->path, 0, MAX_PATH_LENGTH);
-        SDL_memcpy(f->path, file_path, f->path_size + 1);
-
-        // File size
-        size_t file_size = get_file_size(f->path);
+    // File contents, streamed out as each source file and what is derived from it get their entries
+    LOG_DEBUG("Writing file contents");
+    for (int i = 0; i < scan.files_count; i++) {
+        char* file_path = scan.files[i].path;
+        LOG_DEBUG("Creating entry #%d: %s", file_entires_count, file_path);
+
+        // Sized by the scan
+        size_t file_size = scan.files[i].size;
         if (file_size == 0) {
-            LOG_ERROR("Failed to measure file size: %s, skipping!", f->path);
+            LOG_WARNING("Skipping empty file: %s", file_path);
             continue;
         }
 
-        f->file_size = file_size;
-
-        // Offset
-        // IMPORTANT: This is the offset that is the sum of the size of every file from earlier.
-        // This it not a global file offset YET! We need to ADD to this variable:
-        // - the size of the header
-        // - and the size of the index section (WHICH IS DYNAMIC!)
-        f->file_offset = file_offset;
-        file_offset += f->file_size;
-
-        // Index section
-        index_section_size += (
-            sizeof(int)
-            + f->path_size
-            + sizeof(size_t)
-            + sizeof(size_t)
-        );
-    }
-    
-    // Converting dump (sum of sizes of files from earlier) offset to global (output file) offset
-    for (int i = 0; i < file_entires_count; i++) {
-        FileEntry* f = &file_entires[i];
+        int entry_index = push_file_entry(file_path, file_size, NULL, -1);
+
+        if (shader_is_source_path(file_path)) {
+            push_shader_variants(entry_index);
+        }
+
+        if (mdl_is_source_path(file_path)) {
+            push_mesh_cells(entry_index);
+        }
 
-        f->file_offset += header_size + index_section_size;
+        if (texture_is_source_path(file_path)) {
+            push_cooked_texture(entry_index);
+        }
+
+        dump_file_entries(out_file);
     }
 
-    // Write file index
+    push_overlay_font(in_path);
+    dump_file_entries(out_file);
+
+    // File index
     LOG_DEBUG("Writing file index");
+    header.index_offset = (uint64_t)SDL_TellIO(out_file);
+
     for (int i = 0; i < file_entires_count; i++) {
         FileEntry* f = &file_entires[i];
-        
-        // Path
-        SDL_WriteIO(out_file, &f->path_size, sizeof(int));
-        SDL_WriteIO(out_file, f->path, f->path_size);
 
-        // Offset + size
-        SDL_WriteIO(out_file, &f->file_offset, sizeof(size_t));
-        SDL_WriteIO(out_file, &f->file_size, sizeof(size_t));
+        if (!f->dumped) continue;
+
+        if (archive_write_index_entry(out_file, f->path, f->path_size, f->file_offset, f->file_size, f->flags)) {
+            header.entries_count++;
+        }
     }
 
-    // Write file contents
-    LOG_DEBUG("Writing file contents");
-    for (int i = 0; i < file_entires_count; i++) {
-        FileEntry* file_entry = &file_entires[i];
-        
-        LOG_INFO("Dumping %s: %s", bytes_to_human_readable(file_entry->file_size), file_entry->path);
+    size_t out_file_size = SDL_TellIO(out_file);
 
-        SDL_IOStream* file_io = SDL_IOFromFile(file_entry->path, "r");
-        if (!file_io) {
-            LOG_ERROR("Failed to open file: %s, skipping! SDL error:\n%s", file_entry->path, SDL_GetError());
-            continue;
+    LOG_DEBUG("Patching header");
+    bool finished = archive_write_header(out_file, &header);
+
+    SDL_CloseIO(out_file);
+
+    if (!finished) {
+        LOG_ERROR("%s is incomplete and will not mount!", out_path);
+        log_quit();
+        return 1;
+    }
+
+    arena_reset(&scratch_arena);
+    LOG_INFO("%s created successfully! Final size: %s", out_path, bytes_to_human_readable(&scratch_arena, out_file_size));
+
+    dir_scan_free(&scan);
+    path_matcher_free(&matcher);
+
+    arena_free(&generated_arena);
+    arena_free(&scratch_arena);
+
+    log_quit();
+
+    return 0;
+}
+
+
+int push_file_entry(const char* path, size_t file_size, void* data, int alias_of)
+{
+    if (file_entires_count == file_entires_capacity) {
+        file_entires_capacity = file_entires_capacity ? file_entires_capacity * 2 : 64;
+        file_entires = SDL_realloc(file_entires, sizeof(FileEntry) * file_entires_capacity);
+    }
+
+    FileEntry* f = &file_entires[file_entires_count];
+
+    // Path
+    f->path_size = strlen(path) + 1;
+    SDL_memset(f->path, 0, MAX_PATH_LENGTH);
+    SDL_memcpy(f->path, path, f->path_size);
+
+    f->file_offset = 0;
+    f->file_size = file_size;
+    f->data = data;
+    f->alias_of = alias_of;
+    f->flags = data != NULL ? ARCHIVE_ENTRY_GENERATED : 0;
+    f->dumped = false;
+
+    // An alias of a generated entry is generated too (e.g. a shader variant reducing to another)
+    if (alias_of >= 0) f->flags = ARCHIVE_ENTRY_ALIAS | (file_entires[alias_of].flags & ARCHIVE_ENTRY_GENERATED);
+
+    return file_entires_count++;
+}
+
+
+void dump_file_entries(SDL_IOStream* out_file)
+{
+    for (; dumped_entries_count < file_entires_count; dumped_entries_count++) {
+        FileEntry* f = &file_entires[dumped_entries_count];
+        f->dumped = dump_file_entry(out_file, f);
+        f->data = NULL;
+    }
+
+    // Only paths, offsets and sizes are kept for the index
+    arena_reset(&generated_arena);
+}
+
+
+bool dump_file_entry(SDL_IOStream* out_file, FileEntry* file_entry)
+{
+    // Aliases point at the blob of an earlier entry, which is already out
+    if (file_entry->alias_of >= 0) {
+        FileEntry* target = &file_entires[file_entry->alias_of];
+
+        file_entry->file_offset = target->file_offset;
+        file_entry->file_size = target->file_size;
+
+        return target->dumped;
+    }
+
+    Sint64 blob_offset = archive_write_padding(out_file, blob_alignment);
+    if (blob_offset < 0) {
+        LOG_ERROR("Failed to pad the output file before %s! SDL error:\n%s", file_entry->path, SDL_GetError());
+        return false;
+    }
+
+    file_entry->file_offset = (size_t)blob_offset;
+
+    arena_reset(&scratch_arena);
+
+    if (file_entry->data != NULL) {
+        LOG_DEBUG("Dumping %s: %s", bytes_to_human_readable(&scratch_arena, file_entry->file_size), file_entry->path);
+
+        size_t written_bytes = SDL_WriteIO(out_file, file_entry->data, file_entry->file_size);
+        if (written_bytes < file_entry->file_size) {
+            LOG_ERROR("Failed to fully write the generated file into the output file! Written: %zu/%zu bytes. SDL error:\n%s", written_bytes, file_entry->file_size, SDL_GetError());
+            return false;
         }
 
-        void* file_buffer = SDL_malloc(file_entry->file_size);
-        if (!file_buffer) {
-            LOG_ERROR("Failed to allocate file buffer: %s, skipping! SDL error:\n%s", file_entry->path, SDL_GetError());
+        return true;
+    }
+
+    SDL_IOStream* file_io = SDL_IOFromFile(file_entry->path, "r");
+    if (!file_io) {
+        LOG_ERROR("Failed to open file: %s, skipping! SDL error:\n%s", file_entry->path, SDL_GetError());
+        return false;
+    }
+
+    void* chunk = arena_alloc(&scratch_arena, COPY_CHUNK_SIZE);
+    if (!chunk) {
+        LOG_ERROR("Failed to allocate the copy buffer: %s, skipping! SDL error:\n%s", file_entry->path, SDL_GetError());
+        SDL_CloseIO(file_io);
+        return false;
+    }
+
+    // Copied in chunks until the end, the size is whatever was read rather than what the scan saw
+    size_t copied_bytes = 0;
+    for (;;) {
+        size_t read_bytes = SDL_ReadIO(file_io, chunk, COPY_CHUNK_SIZE);
+        if (read_bytes == 0) break;
+
+        size_t written_bytes = SDL_WriteIO(out_file, chunk, read_bytes);
+        copied_bytes += written_bytes;
+
+        if (written_bytes < read_bytes) {
+            LOG_ERROR("Failed to fully write the input file into the output file! Written: %zu bytes. SDL error:\n%s", copied_bytes, SDL_GetError());
             SDL_CloseIO(file_io);
-            continue;
+            return false;
         }
+    }
 
-        size_t read_bytes = SDL_ReadIO(file_io, file_buffer, file_entry->file_size);
-        if (read_bytes < file_entry->file_size) {
-            LOG_ERROR("Failed to read the input file fully! Written: %zu/%zu bytes. SDL error:\n%s", read_bytes, file_entry->file_size, SDL_GetError());
-            SDL_free(file_buffer);
-            SDL_CloseIO(file_io);
+    bool read_failed = SDL_GetIOStatus(file_io) == SDL_IO_STATUS_ERROR;
+    SDL_CloseIO(file_io);
+
+    if (read_failed) {
+        LOG_ERROR("Failed to read the input file fully: %s! Read: %zu bytes. SDL error:\n%s", file_entry->path, copied_bytes, SDL_GetError());
+        return false;
+    }
+
+    file_entry->file_size = copied_bytes;
+    LOG_DEBUG("Dumped %s: %s", bytes_to_human_readable(&scratch_arena, copied_bytes), file_entry->path);
+
+    return true;
+}
+
+
+void push_shader_variants(int source_entry_index)
+{
+    char source_path[MAX_PATH_LENGTH];
+    SDL_strlcpy(source_path, file_entires[source_entry_index].path, MAX_PATH_LENGTH);
+
+    arena_reset(&scratch_arena);
+
+    char* source = (char*)read_whole_file(source_path, &scratch_arena, NULL);
+    if (!source) {
+        LOG_ERROR("Failed to read shader source: %s, skipping variants! SDL error:\n%s", source_path, SDL_GetError());
+        return;
+    }
+
+    uint32_t declared_features = shader_parse_features(source);
+
+    // Without the pragma every mask is the source itself, the runtime reads it directly
+    if (declared_features == 0) return;
+
+    // Masks are visited in ascending order, so the variant a mask reduces to
+    // (`mask & declared_features` <= mask) always has its entry already.
+    int variant_entries[SHADER_VARIANT_COUNT];
+
+    for (uint32_t mask = 0; mask < SHADER_VARIANT_COUNT; mask++) {
+        char variant_path[MAX_PATH_LENGTH];
+        SDL_snprintf(variant_path, MAX_PATH_LENGTH, SHADER_VARIANT_PATH_FORMAT, source_path, mask);
+
+        uint32_t effective_mask = mask & declared_features;
+        if (effective_mask != mask) {
+            int alias_of = variant_entries[effective_mask];
+            variant_entries[mask] = push_file_entry(variant_path, file_entires[alias_of].file_size, NULL, alias_of);
             continue;
         }
 
-        size_t written_bytes = SDL_WriteIO(out_file, file_buffer, file_entry->file_size);
-        if (written_bytes < file_entry->file_size) {
-            LOG_ERROR("Failed to fully write the input file into the output file! Written: %zu/%zu bytes. SDL error:\n%s", written_bytes, file_entry->file_size, SDL_GetError());
-            SDL_free(file_buffer);
-            SDL_CloseIO(file_io);
-            continue;
+        char* variant_source = shader_expand_variant(&generated_arena, source, mask);
+        if (!variant_source) {
+            LOG_ERROR("Failed to expand shader variant: %s, skipping variants!", variant_path);
+            break;
         }
 
-        SDL_free(file_buffer);
-        SDL_CloseIO(file_io);
+        LOG_DEBUG("Expanded shader variant: %s", variant_path);
+        variant_entries[mask] = push_file_entry(variant_path, strlen(variant_source), variant_source, -1);
     }
+}
 
-    size_t out_file_size = SDL_TellIO(out_file);
 
-    SDL_CloseIO(out_file);
+void push_mesh_bvh(const char* mesh_path, const unsigned char* mdl, size_t mdl_size)
+{
+    char bvh_path[MAX_PATH_LENGTH];
+    SDL_snprintf(bvh_path, MAX_PATH_LENGTH, "%s" BVH_PATH_SUFFIX, mesh_path);
 
-    LOG_INFO("%s created successfully! Final size: %s", out_path, bytes_to_human_readable(out_file_size));
+    int tri_count = 0;
+    if (mdl_size >= sizeof(int)) SDL_memcpy(&tri_count, mdl, sizeof(int));
 
-    return 0;
+    if (mdl_size < sizeof(int) || tri_count < 0 || (size_t)tri_count > (mdl_size - sizeof(int)) / (MDL_VERTEX_SIZE * 3)) {
+        LOG_ERROR("Malformed mesh: %s, skipping its BVH!", mesh_path);
+        return;
+    }
+
+    Bvh bvh;
+    if (!bvh_build(&bvh, (const float*)(mdl + sizeof(int)), MDL_FLOATS_PER_VERTEX, (uint32_t)tri_count, &scratch_arena)) {
+        LOG_ERROR("Failed to build BVH: %s, skipping!", bvh_path);
+        return;
+    }
+
+    void* bvh_data = arena_alloc(&generated_arena, bvh.memory_size);
+    if (!bvh_data) {
+        LOG_ERROR("Failed to allocate BVH: %s, skipping!", bvh_path);
+        bvh_free(&bvh);
+        return;
+    }
+
+    SDL_memcpy(bvh_data, bvh.memory, bvh.memory_size);
+
+    LOG_DEBUG("Built BVH: %s (%u nodes, %u packets)", bvh_path, bvh.header->nodes_count, bvh.header->packets_count);
+    push_file_entry(bvh_path, bvh.memory_size, bvh_data, -1);
+
+    bvh_free(&bvh);
 }
 
 
-void scan_dir(char* path)
+void push_mesh_cells(int source_entry_index)
 {
-    if (!SDL_EnumerateDirectory(path, list_dir, NULL)) {
-        LOG_ERROR("Failed to list directory: %s! SDL error:\n%s", path, SDL_GetError());
+    char source_path[MAX_PATH_LENGTH];
+    SDL_strlcpy(source_path, file_entires[source_entry_index].path, MAX_PATH_LENGTH);
+
+    arena_reset(&scratch_arena);
+
+    size_t file_size = 0;
+    unsigned char* mdl = (unsigned char*)read_whole_file(source_path, &scratch_arena, &file_size);
+    if (!mdl) {
+        LOG_ERROR("Failed to read mesh: %s, skipping cells!", source_path);
+        return;
     }
-}
 
+    int tri_count = 0;
+    if (file_size >= sizeof(int)) SDL_memcpy(&tri_count, mdl, sizeof(int));
 
-SDL_EnumerationResult list_dir(void *userdata, const char *dir_name, const char *file_name) {
-    char full_path[MAX_PATH_LENGTH];
-    SDL_snprintf(full_path, MAX_PATH_LENGTH, "%s%s", dir_name, file_name);
+    if (tri_count < 0 || file_size < sizeof(int) + MDL_VERTEX_SIZE * 3 * (size_t)tri_count) {
+        LOG_ERROR("Malformed mesh: %s, skipping cells!", source_path);
+        return;
+    }
+
+    // The whole mesh keeps a BVH too, for anything that loads it in one piece
+    push_mesh_bvh(source_path, mdl, file_size);
+
+    const float* vertices = (const float*)(mdl + sizeof(int));
+
+    // Bucket triangles by the cell of their centroid. Sorting by cell key keeps each cell's
+    // triangles in their original order.
+    typedef struct {
+        int32_t x;
+        int32_t z;
+        int triangle;
+    } CellKey;
+
+    CellKey* keys = arena_alloc(&scratch_arena, sizeof(CellKey) * (tri_count > 0 ? tri_count : 1));
+    if (!keys) {
+        LOG_ERROR("Failed to allocate cell keys: %s, skipping cells!", source_path);
+        return;
+    }
 
-    SDL_PathInfo info;
-    if (SDL_GetPathInfo(full_path, &info)) {
-        if (info.type == SDL_PATHTYPE_DIRECTORY) {
-            scan_dir(full_path);
+    for (int i = 0; i < tri_count; i++) {
+        float centroid_x = 0.0f;
+        float centroid_z = 0.0f;
+        for (int corner = 0; corner < 3; corner++) {
+            const float* v = vertices + (i * 3 + corner) * MDL_FLOATS_PER_VERTEX;
+            centroid_x += v[0] / 3.0f;
+            centroid_z += v[2] / 3.0f;
         }
-        else if (info.type == SDL_PATHTYPE_FILE) {
-            // Check if excluded
-            bool excluded = false;
 
-            for (int i = 0; i < exclusion_patterns_count; i++) {
-                char* pattern = exclusion_patterns[i];
+        keys[i].x = (int32_t)SDL_floorf(centroid_x / MDL_CELL_SIZE);
+        keys[i].z = (int32_t)SDL_floorf(centroid_z / MDL_CELL_SIZE);
+        keys[i].triangle = i;
+    }
 
-                if (str_wildcard_match(full_path, pattern)) {
-                    excluded = true;
-                    LOG_DEBUG("Excluding %s, matched exclusion pattern: %s", full_path, pattern);
-                    break;
-                }
-            }
+    SDL_qsort(keys, tri_count, sizeof(CellKey), compare_cell_keys);
 
-            if (!excluded) {
-                size_t new_size = sizeof(char*) * (in_files_count + 1);
-                in_files_paths = SDL_realloc(in_files_paths, new_size);
-                
-                in_files_paths[in_files_count] = SDL_strdup(full_path);
+    int cells_count = 0;
+    for (int i = 0; i < tri_count; i++) {
+        if (i == 0 || keys[i].x != keys[i - 1].x || keys[i].z != keys[i - 1].z) cells_count++;
+    }
+
+    size_t index_size = sizeof(MdlCellsHeader) + sizeof(MdlCell) * cells_count;
+    unsigned char* index = arena_alloc_zero(&generated_arena, index_size);
+    if (!index) {
+        LOG_ERROR("Failed to allocate the cells index: %s, skipping cells!", source_path);
+        return;
+    }
 
-                in_files_count++;
+    MdlCellsHeader* header = (MdlCellsHeader*)index;
+    SDL_memcpy(header->magic, MDL_CELLS_MAGIC, 4);
+    header->version = MDL_CELLS_VERSION;
+    header->cell_size = MDL_CELL_SIZE;
+    header->cells_count = cells_count;
+
+    MdlCell* cells = (MdlCell*)(header + 1);
+
+    int cell_index = 0;
+    for (int run_start = 0; run_start < tri_count; cell_index++) {
+        int run_end = run_start;
+        while (run_end < tri_count && keys[run_end].x == keys[run_start].x && keys[run_end].z == keys[run_start].z) run_end++;
+
+        int cell_tri_count = run_end - run_start;
+        size_t cell_size = sizeof(int) + MDL_VERTEX_SIZE * 3 * cell_tri_count;
+
+        unsigned char* cell_mdl = arena_alloc(&generated_arena, cell_size);
+        if (!cell_mdl) {
+            LOG_ERROR("Failed to allocate a cell of %s, skipping cells!", source_path);
+            return;
+        }
+
+        MdlCell* cell = &cells[cell_index];
+        cell->x = keys[run_start].x;
+        cell->z = keys[run_start].z;
+        cell->triangles_count = cell_tri_count;
+        for (int axis = 0; axis < 3; axis++) {
+            cell->bounds_min[axis] = FLT_MAX;
+            cell->bounds_max[axis] = -FLT_MAX;
+        }
+
+        SDL_memcpy(cell_mdl, &cell_tri_count, sizeof(int));
+        float* cell_vertices = (float*)(cell_mdl + sizeof(int));
+
+        for (int i = 0; i < cell_tri_count; i++) {
+            const float* source = vertices + keys[run_start + i].triangle * 3 * MDL_FLOATS_PER_VERTEX;
+            SDL_memcpy(cell_vertices + i * 3 * MDL_FLOATS_PER_VERTEX, source, MDL_VERTEX_SIZE * 3);
+
+            for (int corner = 0; corner < 3; corner++) {
+                for (int axis = 0; axis < 3; axis++) {
+                    float value = source[corner * MDL_FLOATS_PER_VERTEX + axis];
+                    if (value < cell->bounds_min[axis]) cell->bounds_min[axis] = value;
+                    if (value > cell->bounds_max[axis]) cell->bounds_max[axis] = value;
+                }
             }
         }
-        
-    } else {
-        LOG_ERROR("Failed to get path info for: %s! SDL error:\n%s", full_path, SDL_GetError());
+
+        char cell_path[MAX_PATH_LENGTH];
+        SDL_snprintf(cell_path, MAX_PATH_LENGTH, MDL_CELL_PATH_FORMAT, source_path, cell->x, cell->z);
+
+        LOG_DEBUG("Split cell: %s (%d triangles)", cell_path, cell_tri_count);
+        push_file_entry(cell_path, cell_size, cell_mdl, -1);
+        push_mesh_bvh(cell_path, cell_mdl, cell_size);
+
+        run_start = run_end;
+    }
+
+    char index_path[MAX_PATH_LENGTH];
+    SDL_snprintf(index_path, MAX_PATH_LENGTH, "%s" MDL_CELLS_SUFFIX, source_path);
+    push_file_entry(index_path, index_size, index, -1);
+
+    LOG_INFO("Split %s into %d cells", source_path, cells_count);
+}
+
+
+int compare_cell_keys(const void* a, const void* b)
+{
+    const int32_t* key_a = (const int32_t*)a;
+    const int32_t* key_b = (const int32_t*)b;
+
+    // x, z, then the triangle index to keep the sort stable
+    for (int i = 0; i < 3; i++) {
+        if (key_a[i] != key_b[i]) return key_a[i] < key_b[i] ? -1 : 1;
     }
 
-    return SDL_ENUM_CONTINUE;
+    return 0;
 }
 
 
-size_t get_file_size(char* path)
+void push_cooked_texture(int source_entry_index)
+{
+    char source_path[MAX_PATH_LENGTH];
+    SDL_strlcpy(source_path, file_entires[source_entry_index].path, MAX_PATH_LENGTH);
+
+    char cooked_path[MAX_PATH_LENGTH];
+    SDL_snprintf(cooked_path, MAX_PATH_LENGTH, "%s" TEXTURE_COOKED_SUFFIX, source_path);
+
+    arena_reset(&scratch_arena);
+
+    size_t file_size = 0;
+    unsigned char* file_buffer = (unsigned char*)read_whole_file(source_path, &scratch_arena, &file_size);
+    if (!file_buffer) {
+        LOG_ERROR("Failed to read image: %s, skipping cooking!", source_path);
+        return;
+    }
+
+    int width, height, channels;
+
+    stbi_arena = &scratch_arena;
+    unsigned char* pixels = stbi_load_from_memory(file_buffer, (int)file_size, &width, &height, &channels, 0);
+    stbi_arena = NULL;
+
+    if (!pixels) {
+        LOG_ERROR("Failed to decode image: %s (%s), skipping cooking!", source_path, stbi_failure_reason());
+        return;
+    }
+
+    size_t cooked_size = 0;
+    void* cooked = texture_cook(&generated_arena, pixels, width, height, channels, &cooked_size);
+    if (!cooked) {
+        LOG_ERROR("Failed to cook texture: %s, skipping!", cooked_path);
+        return;
+    }
+
+    LOG_DEBUG("Cooked texture: %s (%dx%d, %d channels, %d levels)", cooked_path, width, height, channels, texture_levels_count(width, height));
+    push_file_entry(cooked_path, cooked_size, cooked, -1);
+}
+
+
+void push_overlay_font(const char* root_path)
+{
+    char font_path[MAX_PATH_LENGTH];
+    SDL_snprintf(font_path, MAX_PATH_LENGTH, "%s/" FONT_OVERLAY_PATH, root_path);
+
+    size_t baked_size = 0;
+    void* baked = font_bake(&generated_arena, &baked_size);
+    if (!baked) {
+        LOG_ERROR("Failed to bake the overlay font, skipping!");
+        return;
+    }
+
+    LOG_DEBUG("Baked overlay font: %s", font_path);
+    push_file_entry(font_path, baked_size, baked, -1);
+}
+
+
+void* read_whole_file(const char* path, Arena* arena, size_t* out_size)
 {
     SDL_IOStream* f = SDL_IOFromFile(path, "r");
     if (!f) {
         LOG_ERROR("Failed to open file: %s! SDL error:\n%s", path, SDL_GetError());
-        return 0;
+        return NULL;
     }
 
-    SDL_SeekIO(f, 0, SDL_IO_SEEK_END);
+    size_t file_size = (size_t)SDL_GetIOSize(f);
 
-    size_t file_size = SDL_TellIO(f);
+    // Null-terminated so text files can be used as strings directly
+    char* buffer = (char*)arena_alloc(arena, file_size + 1);
+    if (!buffer) {
+        LOG_ERROR("Failed to allocate file buffer: %s", path);
+        SDL_CloseIO(f);
+        return NULL;
+    }
 
+    size_t read_bytes = SDL_ReadIO(f, buffer, file_size);
     SDL_CloseIO(f);
 
-    return file_size;
+    if (read_bytes < file_size) {
+        LOG_ERROR("Failed to read the file fully! Read: %zu/%zu bytes. SDL error:\n%s", read_bytes, file_size, SDL_GetError());
+        return NULL;
+    }
+
+    buffer[file_size] = '\0';
+
+    if (out_size != NULL) *out_size = file_size;
+
+    return buffer;
 }
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include "str_utils.h"
+
+/*
+** Resource registry
+**
+** Every loaded asset handle gets a record with its resident CPU bytes, estimated GPU bytes
+** and load time. Totals per kind are kept up to date so budgets can be checked before a load
+** instead of after it. Anything still registered at shutdown is reported as a leak.
+*/
+
+/*
+** Macros
+*/
+
+#define RESOURCE_PATH_LENGTH 256
+#define RESOURCE_INVALID_ID -1
+
+/*
+** Structs
+*/
+
+typedef enum {
+    RESOURCE_TEXTURE,
+    RESOURCE_MESH,
+    RESOURCE_SHADER,
+    RESOURCE_KIND_COUNT,
+} ResourceKind;
+
+static const char* resource_kind_names[RESOURCE_KIND_COUNT] = {
+    "texture",
+    "mesh",
+    "shader",
+};
+
+typedef int ResourceId;
+
+typedef struct {
+    ResourceKind kind;
+    char path[RESOURCE_PATH_LENGTH];
+    uint32_t handle; // GL object name
+
+    size_t cpu_bytes;
+    size_t gpu_bytes;
+    uint64_t load_time_ns;
+
+    bool alive;
+    ResourceId next_free;
+} ResourceRecord;
+
+typedef struct {
+    ResourceRecord* records;
+    int records_count;
+    int records_capacity;
+    ResourceId first_free;
+
+    int alive_count[RESOURCE_KIND_COUNT];
+    size_t cpu_bytes[RESOURCE_KIND_COUNT];
+    size_t gpu_bytes[RESOURCE_KIND_COUNT];
+
+    size_t peak_cpu_bytes;
+    size_t peak_gpu_bytes;
+
+    // 0 means unlimited
+    size_t cpu_budget;
+    size_t gpu_budget;
+} ResourceRegistry;
+
+/*
+** Declarations
+*/
+
+void resources_init(ResourceRegistry* reg);
+void resources_quit(ResourceRegistry* reg);
+
+ResourceId resources_register(ResourceRegistry* reg, ResourceKind kind, const char* path, uint32_t handle, size_t cpu_bytes, size_t gpu_bytes, uint64_t load_time_ns);
+void resources_update(ResourceRegistry* reg, ResourceId id, size_t cpu_bytes, size_t gpu_bytes);
+void resources_release(ResourceRegistry* reg, ResourceId id);
+ResourceId resources_find(ResourceRegistry* reg, ResourceKind kind, uint32_t handle);
+ResourceRecord* resources_get(ResourceRegistry* reg, ResourceId id);
+
+size_t resources_total_cpu_bytes(ResourceRegistry* reg);
+size_t resources_total_gpu_bytes(ResourceRegistry* reg);
+
+void resources_set_budget(ResourceRegistry* reg, size_t cpu_budget, size_t gpu_budget);
+bool resources_can_afford(ResourceRegistry* reg, size_t cpu_bytes, size_t gpu_bytes);
+
+void resources_report(ResourceRegistry* reg);
+int resources_report_leaks(ResourceRegistry* reg);
+
+/*
+** Implementation
+*/
+
+void resources_init(ResourceRegistry* reg)
+{
+    SDL_memset(reg, 0, sizeof(ResourceRegistry));
+    reg->first_free = RESOURCE_INVALID_ID;
+}
+
+
+void resources_quit(ResourceRegistry* reg)
+{
+    SDL_free(reg->records);
+    SDL_memset(reg, 0, sizeof(ResourceRegistry));
+    reg->first_free = RESOURCE_INVALID_ID;
+}
+
+
+ResourceId resources_register(ResourceRegistry* reg, ResourceKind kind, const char* path, uint32_t handle, size_t cpu_bytes, size_t gpu_bytes, uint64_t load_time_ns)
+{
+    ResourceId id = reg->first_free;
+
+    if (id != RESOURCE_INVALID_ID) {
+        reg->first_free = reg->records[id].next_free;
+    }
+    else {
+        if (reg->records_count == reg->records_capacity) {
+            int new_capacity = reg->records_capacity ? reg->records_capacity * 2 : 64;
+
+            ResourceRecord* new_records = SDL_realloc(reg->records, sizeof(ResourceRecord) * new_capacity);
+            if (!new_records) {
+                LOG_ERROR("Failed to grow the resource registry to %d records.", new_capacity);
+                return RESOURCE_INVALID_ID;
+            }
+
+            reg->records = new_records;
+            reg->records_capacity = new_capacity;
+        }
+
+        id = reg->records_count++;
+    }
+
+    ResourceRecord* r = &reg->records[id];
+    r->kind = kind;
+    SDL_strlcpy(r->path, path, RESOURCE_PATH_LENGTH);
+    r->handle = handle;
+    r->cpu_bytes = 0;
+    r->gpu_bytes = 0;
+    r->load_time_ns = load_time_ns;
+    r->alive = true;
+    r->next_free = RESOURCE_INVALID_ID;
+
+    reg->alive_count[kind]++;
+    resources_update(reg, id, cpu_bytes, gpu_bytes);
+
+    return id;
+}
+
+
+void resources_update(ResourceRegistry* reg, ResourceId id, size_t cpu_bytes, size_t gpu_bytes)
+{
+    ResourceRecord* r = resources_get(reg, id);
+    if (r == NULL) return;
+
+    reg->cpu_bytes[r->kind] = reg->cpu_bytes[r->kind] - r->cpu_bytes + cpu_bytes;
+    reg->gpu_bytes[r->kind] = reg->gpu_bytes[r->kind] - r->gpu_bytes + gpu_bytes;
+    r->cpu_bytes = cpu_bytes;
+    r->gpu_bytes = gpu_bytes;
+
+    size_t total_cpu_bytes = resources_total_cpu_bytes(reg);
+    size_t total_gpu_bytes = resources_total_gpu_bytes(reg);
+    if (total_cpu_bytes > reg->peak_cpu_bytes) reg->peak_cpu_bytes = total_cpu_bytes;
+    if (total_gpu_bytes > reg->peak_gpu_bytes) reg->peak_gpu_bytes = total_gpu_bytes;
+
+    if (reg->cpu_budget != 0 && total_cpu_bytes > reg->cpu_budget) {
+        LOG_WARNING("CPU memory budget exceeded by %s: %s", resource_kind_names[r->kind], r->path);
+    }
+    if (reg->gpu_budget != 0 && total_gpu_bytes > reg->gpu_budget) {
+        LOG_WARNING("GPU memory budget exceeded by %s: %s", resource_kind_names[r->kind], r->path);
+    }
+}
+
+
+void resources_release(ResourceRegistry* reg, ResourceId id)
+{
+    ResourceRecord* r = resources_get(reg, id);
+    if (r == NULL) return;
+
+    resources_update(reg, id, 0, 0);
+
+    reg->alive_count[r->kind]--;
+    r->alive = false;
+    r->next_free = reg->first_free;
+    reg->first_free = id;
+}
+
+
+ResourceId resources_find(ResourceRegistry* reg, ResourceKind kind, uint32_t handle)
+{
+    for (int i = 0; i < reg->records_count; i++) {
+        ResourceRecord* r = &reg->records[i];
+
+        if (r->alive && r->kind == kind && r->handle == handle) return i;
+    }
+
+    return RESOURCE_INVALID_ID;
+}
+
+
+ResourceRecord* resources_get(ResourceRegistry* reg, ResourceId id)
+{
+    if (id < 0 || id >= reg->records_count || !reg->records[id].alive) return NULL;
+
+    return &reg->records[id];
+}
+
+
+size_t resources_total_cpu_bytes(ResourceRegistry* reg)
+{
+    size_t total = 0;
+    for (int i = 0; i < RESOURCE_KIND_COUNT; i++) total += reg->cpu_bytes[i];
+
+    return total;
+}
+
+
+size_t resources_total_gpu_bytes(ResourceRegistry* reg)
+{
+    size_t total = 0;
+    for (int i = 0; i < RESOURCE_KIND_COUNT; i++) total += reg->gpu_bytes[i];
+
+    return total;
+}
+
+
+void resources_set_budget(ResourceRegistry* reg, size_t cpu_budget, size_t gpu_budget)
+{
+    reg->cpu_budget = cpu_budget;
+    reg->gpu_budget = gpu_budget;
+}
+
+
+bool resources_can_afford(ResourceRegistry* reg, size_t cpu_bytes, size_t gpu_bytes)
+{
+    if (reg->cpu_budget != 0 && resources_total_cpu_bytes(reg) + cpu_bytes > reg->cpu_budget) return false;
+    if (reg->gpu_budget != 0 && resources_total_gpu_bytes(reg) + gpu_bytes > reg->gpu_budget) return false;
+
+    return true;
+}
+
+
+void resources_report(ResourceRegistry* reg)
+{
+    char human_cpu[32];
+    char human_gpu[32];
+    Arena scratch;
+    arena_init(&scratch, 4096);
+
+    LOG_INFO("Resources:");
+    for (int i = 0; i < reg->records_count; i++) {
+        ResourceRecord* r = &reg->records[i];
+        if (!r->alive) continue;
+
+        SDL_strlcpy(human_cpu, bytes_to_human_readable(&scratch, r->cpu_bytes), sizeof(human_cpu));
+        SDL_strlcpy(human_gpu, bytes_to_human_readable(&scratch, r->gpu_bytes), sizeof(human_gpu));
+        arena_reset(&scratch);
+
+        LOG_INFO("  #%-4d %-8s cpu: %10s  gpu: %10s  load: %8.3f ms  %s", i, resource_kind_names[r->kind], human_cpu, human_gpu, r->load_time_ns / 1000000.0, r->path);
+    }
+
+    for (int kind = 0; kind < RESOURCE_KIND_COUNT; kind++) {
+        SDL_strlcpy(human_cpu, bytes_to_human_readable(&scratch, reg->cpu_bytes[kind]), sizeof(human_cpu));
+        SDL_strlcpy(human_gpu, bytes_to_human_readable(&scratch, reg->gpu_bytes[kind]), sizeof(human_gpu));
+        arena_reset(&scratch);
+
+        LOG_INFO("  %-8s x%-4d cpu: %10s  gpu: %10s", resource_kind_names[kind], reg->alive_count[kind], human_cpu, human_gpu);
+    }
+
+    LOG_INFO("  total cpu: %s (peak %s, budget %s)",
+        bytes_to_human_readable(&scratch, resources_total_cpu_bytes(reg)),
+        bytes_to_human_readable(&scratch, reg->peak_cpu_bytes),
+        reg->cpu_budget ? bytes_to_human_readable(&scratch, reg->cpu_budget) : "none");
+    LOG_INFO("  total gpu: %s (peak %s, budget %s)",
+        bytes_to_human_readable(&scratch, resources_total_gpu_bytes(reg)),
+        bytes_to_human_readable(&scratch, reg->peak_gpu_bytes),
+        reg->gpu_budget ? bytes_to_human_readable(&scratch, reg->gpu_budget) : "none");
+
+    arena_free(&scratch);
+}
+
+
+int resources_report_leaks(ResourceRegistry* reg)
+{
+    int leaks_count = 0;
+
+    for (int i = 0; i < reg->records_count; i++) {
+        ResourceRecord* r = &reg->records[i];
+        if (!r->alive) continue;
+
+        LOG_WARNING("Leaked %s #%d (GL name %u, cpu %zu B, gpu %zu B): %s", resource_kind_names[r->kind], i, r->handle, r->cpu_bytes, r->gpu_bytes, r->path);
+        leaks_count++;
+    }
+
+    return leaks_count;
+}
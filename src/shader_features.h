@@ -0,0 +1,143 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include "log.h"
+
+#include "arena.h"
+
+/*
+** Shader permutations
+**
+** A shader source opts into permutations with a pragma right after its `#version` line:
+**
+**     #pragma shader_features TRIPLANAR_MAPPING VERTEX_SNAPPING
+**
+** Each listed keyword is a bit in the feature mask. `pack` stores one expanded source per
+** combination of the declared keywords under `<path>#<mask>`, and aliases every other mask
+** to the variant it reduces to, so the runtime can look up any mask with a single index hit.
+** Sources without the pragma get no variants and are read through their own path. GLSL
+** compilers ignore unknown pragmas, so raw sources still compile (as mask 0).
+*/
+
+/*
+** Macros
+*/
+
+#define SHADER_FEATURES_PRAGMA "#pragma shader_features"
+#define SHADER_VARIANT_PATH_FORMAT "%s#%02x"
+
+#define SHADER_FEATURE_COUNT 4
+#define SHADER_VARIANT_COUNT (1 << SHADER_FEATURE_COUNT)
+
+/*
+** Structs
+*/
+
+typedef enum {
+    SHADER_FEATURE_TRIPLANAR_MAPPING = 1 << 0,
+    SHADER_FEATURE_VERTEX_SNAPPING = 1 << 1,
+    SHADER_FEATURE_AFFINE_MAPPING = 1 << 2,
+    SHADER_FEATURE_LIGHTING = 1 << 3,
+} ShaderFeature;
+
+static const char* shader_feature_names[SHADER_FEATURE_COUNT] = {
+    "TRIPLANAR_MAPPING",
+    "VERTEX_SNAPPING",
+    "AFFINE_MAPPING",
+    "LIGHTING",
+};
+
+/*
+** Declarations
+*/
+
+bool shader_is_source_path(const char* path);
+uint32_t shader_parse_features(const char* source);
+char* shader_expand_variant(Arena* arena, const char* source, uint32_t features);
+
+/*
+** Implementation
+*/
+
+bool shader_is_source_path(const char* path)
+{
+    const char* extension = SDL_strrchr(path, '.');
+    if (extension == NULL) return false;
+
+    return SDL_strcmp(extension, ".vs") == 0 || SDL_strcmp(extension, ".fs") == 0;
+}
+
+
+uint32_t shader_parse_features(const char* source)
+{
+    const char* pragma = SDL_strstr(source, SHADER_FEATURES_PRAGMA);
+    if (pragma == NULL) return 0;
+
+    uint32_t features = 0;
+
+    const char* cursor = pragma + strlen(SHADER_FEATURES_PRAGMA);
+    while (*cursor != '\0' && *cursor != '\n' && *cursor != '\r') {
+        // Skip separators
+        if (*cursor == ' ' || *cursor == '\t') {
+            cursor++;
+            continue;
+        }
+
+        // Keyword
+        const char* keyword = cursor;
+        while (*cursor != '\0' && *cursor != '\n' && *cursor != '\r' && *cursor != ' ' && *cursor != '\t') {
+            cursor++;
+        }
+        size_t keyword_length = cursor - keyword;
+
+        bool known = false;
+        for (int i = 0; i < SHADER_FEATURE_COUNT; i++) {
+            if (strlen(shader_feature_names[i]) == keyword_length && SDL_strncmp(shader_feature_names[i], keyword, keyword_length) == 0) {
+                features |= 1u << i;
+                known = true;
+                break;
+            }
+        }
+
+        if (!known) {
+            LOG_WARNING("Unknown shader feature keyword: %.*s, ignoring.", (int)keyword_length, keyword);
+        }
+    }
+
+    return features;
+}
+
+
+char* shader_expand_variant(Arena* arena, const char* source, uint32_t features)
+{
+    // The defines have to go after `#version`, which must stay the first directive.
+    size_t insert_at = 0;
+    if (SDL_strncmp(source, "#version", strlen("#version")) == 0) {
+        const char* line_end = SDL_strchr(source, '\n');
+        insert_at = line_end ? (size_t)(line_end - source) + 1 : strlen(source);
+    }
+
+    size_t defines_size = 0;
+    for (int i = 0; i < SHADER_FEATURE_COUNT; i++) {
+        if (features & (1u << i)) defines_size += strlen("#define  1\n") + strlen(shader_feature_names[i]);
+    }
+
+    size_t source_size = strlen(source);
+    char* expanded = (char*)arena_alloc_zero(arena, source_size + defines_size + 1);
+    if (!expanded) {
+        LOG_ERROR("Failed to allocate memory for the shader variant.");
+        return NULL;
+    }
+
+    SDL_memcpy(expanded, source, insert_at);
+
+    char* cursor = expanded + insert_at;
+    for (int i = 0; i < SHADER_FEATURE_COUNT; i++) {
+        if (features & (1u << i)) cursor += SDL_snprintf(cursor, defines_size + 1, "#define %s 1\n", shader_feature_names[i]);
+    }
+
+    SDL_memcpy(cursor, source + insert_at, source_size - insert_at);
+
+    return expanded;
+}
@@ -1,5 +1,9 @@
+#pragma once
+
 #include <SDL3/SDL.h>
 
+#include "log.h"
+
 #ifdef __linux__
     #include <fnmatch.h>
 #endif
@@ -7,16 +11,19 @@
     #include <Shlwapi.h>
 #endif
 
+#include "arena.h"
+
 
-char* bytes_to_human_readable(size_t bytes);
+// Functions returning new strings allocate them from `arena`, or from the heap if it is NULL.
+char* bytes_to_human_readable(Arena* arena, size_t bytes);
 void str_path_ensure_forward_slash(char* path);
-char* str_new_formatted(const char* fmt, ...);
+char* str_new_formatted(Arena* arena, const char* fmt, ...);
 bool str_starts_with(char* str, char* prefix);
 char* str_override(char* dest, char* str);
 bool str_wildcard_match(char* str, char* pattern);
 
 
-char* bytes_to_human_readable(size_t bytes)
+char* bytes_to_human_readable(Arena* arena, size_t bytes)
 {
     const char* units[] = {"B", "KB", "MB", "GB", "TB", "PB"};
     
@@ -24,12 +31,12 @@ char* bytes_to_human_readable(size_t bytes)
     double count = (double)bytes;
     int i = 0;
 
-    while (count >= 1024.0 && i < units_count) {
+    while (count >= 1024.0 && i < units_count - 1) {
         count /= 1024.0;
         i++;
     }
 
-    return str_new_formatted("%.2f %s", count, units[i]);
+    return str_new_formatted(arena, "%.2f %s", count, units[i]);
 }
 
 
@@ -64,16 +71,16 @@ char* str_override(char* dest, char* str)
 }
 
 
-char* str_new_formatted(const char* fmt, ...) {
+char* str_new_formatted(Arena* arena, const char* fmt, ...) {
     va_list args;
 
     va_start(args, fmt);
     int str_len = SDL_vsnprintf(NULL, 0, fmt, args) + 1;
     va_end(args);
 
-    char* str = (char*)SDL_calloc(1, str_len);
+    char* str = (char*)arena_alloc(arena, str_len);
     if (!str) {
-        SDL_Log("Failed to allocate enough memory for the new string.");
+        LOG_ERROR("Failed to allocate enough memory for the new string.");
         return NULL;
     }
 
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include "log.h"
+#include "arena.h"
+
+/*
+** Cooked textures
+**
+** `pack` decodes every image once and stores it at `<image path>.tex` as raw 8 bit texels
+** with a full box filtered mip chain:
+**
+**     TextureHeader, TextureLevel[levels_count] (indexed by GL level), level data
+**
+** Level data is ordered smallest first, so any set of the coarsest levels is one contiguous
+** read at the start of the data and finer levels can be streamed in one by one later.
+** Rows are tightly packed (GL_UNPACK_ALIGNMENT 1), top row first as stb_image returns them.
+*/
+
+/*
+** Macros
+*/
+
+#define TEXTURE_MAGIC "TEX1"
+#define TEXTURE_VERSION 1
+#define TEXTURE_COOKED_SUFFIX ".tex"
+
+#define TEXTURE_MAX_LEVELS 16
+#define TEXTURE_MAX_SIZE 65536 // Past any GL_MAX_TEXTURE_SIZE, keeps level sizes of a corrupt header in range
+
+/*
+** Structs
+*/
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t levels_count;
+    uint32_t reserved[2];
+} TextureHeader;
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset; // From the start of the level data
+    uint64_t size;
+} TextureLevel;
+
+/*
+** Declarations
+*/
+
+bool texture_is_source_path(const char* path);
+int texture_levels_count(int width, int height);
+bool texture_levels_valid(const TextureHeader* header, const TextureLevel* levels, uint64_t data_size);
+void* texture_cook(Arena* arena, const unsigned char* pixels, int width, int height, int channels, size_t* out_size);
+void texture_downsample(const unsigned char* src, int src_width, int src_height, unsigned char* dest, int dest_width, int dest_height, int channels);
+
+/*
+** Implementation
+*/
+
+bool texture_is_source_path(const char* path)
+{
+    const char* extension = SDL_strrchr(path, '.');
+    if (extension == NULL) return false;
+
+    const char* image_extensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp" };
+    for (int i = 0; i < (int)(sizeof(image_extensions) / sizeof(char*)); i++) {
+        if (SDL_strcasecmp(extension, image_extensions[i]) == 0) return true;
+    }
+
+    return false;
+}
+
+
+int texture_levels_count(int width, int height)
+{
+    int levels_count = 1;
+    while ((width > 1 || height > 1) && levels_count < TEXTURE_MAX_LEVELS) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        levels_count++;
+    }
+
+    return levels_count;
+}
+
+
+bool texture_levels_valid(const TextureHeader* header, const TextureLevel* levels, uint64_t data_size)
+{
+    if (header->width == 0 || header->height == 0 || header->width > TEXTURE_MAX_SIZE || header->height > TEXTURE_MAX_SIZE) return false;
+    if (header->channels == 0 || header->channels > 4) return false;
+    if ((int)header->levels_count != texture_levels_count((int)header->width, (int)header->height)) return false;
+
+    // Exactly the layout `texture_cook` writes: halving sizes, tightly packed, smallest first
+    uint64_t offset = 0;
+    for (int level = (int)header->levels_count - 1; level >= 0; level--) {
+        const TextureLevel* l = &levels[level];
+
+        uint32_t width = SDL_max(header->width >> level, 1);
+        uint32_t height = SDL_max(header->height >> level, 1);
+        if (l->width != width || l->height != height) return false;
+        if (l->size != (uint64_t)width * height * header->channels || l->offset != offset) return false;
+
+        offset += l->size;
+    }
+
+    return offset <= data_size;
+}
+
+
+void* texture_cook(Arena* arena, const unsigned char* pixels, int width, int height, int channels, size_t* out_size)
+{
+    int levels_count = texture_levels_count(width, height);
+
+    TextureLevel levels[TEXTURE_MAX_LEVELS];
+    size_t data_size = 0;
+
+    for (int level = 0; level < levels_count; level++) {
+        levels[level].width = (uint32_t)SDL_max(width >> level, 1);
+        levels[level].height = (uint32_t)SDL_max(height >> level, 1);
+
+        levels[level].size = (uint64_t)levels[level].width * levels[level].height * channels;
+        data_size += levels[level].size;
+    }
+
+    // Smallest first
+    uint64_t offset = 0;
+    for (int level = levels_count - 1; level >= 0; level--) {
+        levels[level].offset = offset;
+        offset += levels[level].size;
+    }
+
+    size_t table_size = sizeof(TextureHeader) + sizeof(TextureLevel) * levels_count;
+    size_t cooked_size = table_size + data_size;
+
+    unsigned char* cooked = (unsigned char*)arena_alloc(arena, cooked_size);
+    if (!cooked) {
+        LOG_ERROR("Failed to allocate %zu bytes for a cooked texture!", cooked_size);
+        return NULL;
+    }
+
+    TextureHeader* header = (TextureHeader*)cooked;
+    SDL_memset(header, 0, sizeof(TextureHeader));
+    SDL_memcpy(header->magic, TEXTURE_MAGIC, 4);
+    header->version = TEXTURE_VERSION;
+    header->width = width;
+    header->height = height;
+    header->channels = channels;
+    header->levels_count = levels_count;
+
+    SDL_memcpy(cooked + sizeof(TextureHeader), levels, sizeof(TextureLevel) * levels_count);
+
+    unsigned char* data = cooked + table_size;
+    SDL_memcpy(data + levels[0].offset, pixels, levels[0].size);
+
+    // Each level is filtered from the previous one, already in place in the output
+    for (int level = 1; level < levels_count; level++) {
+        texture_downsample(
+            data + levels[level - 1].offset, levels[level - 1].width, levels[level - 1].height,
+            data + levels[level].offset, levels[level].width, levels[level].height,
+            channels);
+    }
+
+    if (out_size != NULL) *out_size = cooked_size;
+
+    return cooked;
+}
+
+
+void texture_downsample(const unsigned char* src, int src_width, int src_height, unsigned char* dest, int dest_width, int dest_height, int channels)
+{
+    // 2x2 box filter, a 1 texel wide side filters along the other axis only
+    int step_x = src_width > 1 ? 1 : 0;
+    int step_y = src_height > 1 ? 1 : 0;
+
+    for (int y = 0; y < dest_height; y++) {
+        const unsigned char* row_0 = src + (size_t)(y * 2) * src_width * channels;
+        const unsigned char* row_1 = src + (size_t)(y * 2 + step_y) * src_width * channels;
+
+        for (int x = 0; x < dest_width; x++) {
+            int x_0 = x * 2 * channels;
+            int x_1 = (x * 2 + step_x) * channels;
+
+            for (int c = 0; c < channels; c++) {
+                int sum = row_0[x_0 + c] + row_0[x_1 + c] + row_1[x_0 + c] + row_1[x_1 + c];
+                dest[((size_t)y * dest_width + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+}
@@ -0,0 +1,573 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+#include "log.h"
+#include "arena.h"
+
+/*
+** Transforms
+**
+** Local position, rotation (quaternion, xyzw) and scale of every object in structure of
+** arrays form, plus the world matrix derived from them and the parent chain. Column major
+** 4x4 matrices, the same layout as cglm's mat4.
+**
+** Handles stay stable, the dense arrays behind them are kept in topological order (parents
+** before their children) so one linear pass updates the whole hierarchy. Setters only mark a
+** transform dirty, `transform_update` propagates that to the children and rebuilds the dirty
+** world matrices 4 at a time (SSE2, scalar fallback elsewhere). Groups of 4 without a dirty
+** transform are skipped with a single compare.
+**
+** Destroying only flags a transform. The next `transform_update` drops every flagged one in a
+** single stable pass, which keeps the order, and turns their children into roots.
+*/
+
+/*
+** Macros
+*/
+
+#define TRANSFORM_INVALID UINT32_MAX
+#define TRANSFORM_LANES 4
+#define TRANSFORM_ALIGNMENT 64
+
+/*
+** Structs
+*/
+
+typedef uint32_t TransformId;
+
+typedef struct {
+    // Dense, in topological order, capacity is a multiple of TRANSFORM_LANES
+    float* position[3];
+    float* rotation[4];
+    float* scale[3];
+    uint32_t* parent; // Dense index, TRANSFORM_INVALID for roots
+    uint8_t* dirty;
+    uint8_t* destroyed; // Removed by the next update
+    float (*world)[16];
+    TransformId* dense_to_id;
+
+    // Sparse, by handle
+    uint32_t* id_to_dense; // Next free handle while unused
+    TransformId first_free_id;
+    uint32_t ids_count;
+
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t destroyed_count;
+    bool order_dirty; // Reparenting can put a child before its parent
+
+    // Stats of the last update
+    uint32_t updated_count;
+    uint64_t update_ns;
+} TransformSystem;
+
+/*
+** Declarations
+*/
+
+bool transform_init(TransformSystem* ts, uint32_t capacity);
+void transform_quit(TransformSystem* ts);
+
+TransformId transform_create(TransformSystem* ts, TransformId parent);
+void transform_destroy(TransformSystem* ts, TransformId id);
+void transform_set_parent(TransformSystem* ts, TransformId id, TransformId parent);
+
+void transform_set_position(TransformSystem* ts, TransformId id, const float position[3]);
+void transform_set_rotation(TransformSystem* ts, TransformId id, const float rotation[4]);
+void transform_set_scale(TransformSystem* ts, TransformId id, const float scale[3]);
+const float* transform_world(const TransformSystem* ts, TransformId id);
+
+void transform_update(TransformSystem* ts, Arena* scratch);
+
+bool transform_grow(TransformSystem* ts, uint32_t capacity);
+void transform_compact(TransformSystem* ts, Arena* scratch);
+void transform_sort(TransformSystem* ts, Arena* scratch);
+void transform_local_matrices(const TransformSystem* ts, uint32_t first, float out[TRANSFORM_LANES][16]);
+void transform_mul(const float a[16], const float b[16], float out[16]);
+
+/*
+** Implementation
+*/
+
+bool transform_init(TransformSystem* ts, uint32_t capacity)
+{
+    SDL_memset(ts, 0, sizeof(TransformSystem));
+    ts->first_free_id = TRANSFORM_INVALID;
+
+    return transform_grow(ts, capacity);
+}
+
+
+void transform_quit(TransformSystem* ts)
+{
+    for (int axis = 0; axis < 3; axis++) SDL_aligned_free(ts->position[axis]);
+    for (int axis = 0; axis < 4; axis++) SDL_aligned_free(ts->rotation[axis]);
+    for (int axis = 0; axis < 3; axis++) SDL_aligned_free(ts->scale[axis]);
+    SDL_aligned_free(ts->parent);
+    SDL_aligned_free(ts->dirty);
+    SDL_aligned_free(ts->destroyed);
+    SDL_aligned_free(ts->world);
+    SDL_aligned_free(ts->dense_to_id);
+    SDL_free(ts->id_to_dense);
+
+    SDL_memset(ts, 0, sizeof(TransformSystem));
+    ts->first_free_id = TRANSFORM_INVALID;
+}
+
+
+bool transform_grow(TransformSystem* ts, uint32_t capacity)
+{
+    capacity = (capacity + TRANSFORM_LANES - 1) / TRANSFORM_LANES * TRANSFORM_LANES;
+    if (capacity <= ts->capacity) return true;
+
+    // Every dense array grows together, handles index the sparse array which grows with them
+    void** arrays[] = {
+        (void**)&ts->position[0], (void**)&ts->position[1], (void**)&ts->position[2],
+        (void**)&ts->rotation[0], (void**)&ts->rotation[1], (void**)&ts->rotation[2], (void**)&ts->rotation[3],
+        (void**)&ts->scale[0], (void**)&ts->scale[1], (void**)&ts->scale[2],
+        (void**)&ts->parent, (void**)&ts->dirty, (void**)&ts->destroyed, (void**)&ts->world, (void**)&ts->dense_to_id,
+    };
+    size_t element_sizes[] = {
+        sizeof(float), sizeof(float), sizeof(float),
+        sizeof(float), sizeof(float), sizeof(float), sizeof(float),
+        sizeof(float), sizeof(float), sizeof(float),
+        sizeof(uint32_t), sizeof(uint8_t), sizeof(uint8_t), sizeof(float) * 16, sizeof(TransformId),
+    };
+    int arrays_count = (int)(sizeof(arrays) / sizeof(arrays[0]));
+
+    void* new_arrays[sizeof(arrays) / sizeof(arrays[0])];
+    for (int i = 0; i < arrays_count; i++) {
+        new_arrays[i] = SDL_aligned_alloc(TRANSFORM_ALIGNMENT, element_sizes[i] * capacity);
+
+        if (new_arrays[i] == NULL) {
+            LOG_ERROR("Failed to grow the transforms to %u!", capacity);
+            for (int j = 0; j < i; j++) SDL_aligned_free(new_arrays[j]);
+            return false;
+        }
+
+        // Padding lanes are read by the batched update, they are never dirty
+        SDL_memset(new_arrays[i], 0, element_sizes[i] * capacity);
+        if (*arrays[i] != NULL) SDL_memcpy(new_arrays[i], *arrays[i], element_sizes[i] * ts->count);
+    }
+
+    uint32_t* new_id_to_dense = SDL_realloc(ts->id_to_dense, sizeof(uint32_t) * capacity);
+    if (new_id_to_dense == NULL) {
+        LOG_ERROR("Failed to grow the transform handles to %u!", capacity);
+        for (int i = 0; i < arrays_count; i++) SDL_aligned_free(new_arrays[i]);
+        return false;
+    }
+    ts->id_to_dense = new_id_to_dense;
+
+    for (int i = 0; i < arrays_count; i++) {
+        SDL_aligned_free(*arrays[i]);
+        *arrays[i] = new_arrays[i];
+    }
+
+    ts->capacity = capacity;
+    return true;
+}
+
+
+TransformId transform_create(TransformSystem* ts, TransformId parent)
+{
+    if (ts->count == ts->capacity && !transform_grow(ts, ts->capacity ? ts->capacity * 2 : 64)) {
+        return TRANSFORM_INVALID;
+    }
+
+    TransformId id = ts->first_free_id;
+    if (id != TRANSFORM_INVALID) {
+        ts->first_free_id = ts->id_to_dense[id];
+    }
+    else {
+        id = ts->ids_count++;
+    }
+
+    // Appending keeps the order valid, the parent already comes earlier
+    uint32_t i = ts->count++;
+    ts->id_to_dense[id] = i;
+    ts->dense_to_id[i] = id;
+
+    ts->position[0][i] = ts->position[1][i] = ts->position[2][i] = 0.0f;
+    ts->rotation[0][i] = ts->rotation[1][i] = ts->rotation[2][i] = 0.0f;
+    ts->rotation[3][i] = 1.0f;
+    ts->scale[0][i] = ts->scale[1][i] = ts->scale[2][i] = 1.0f;
+    ts->parent[i] = parent != TRANSFORM_INVALID ? ts->id_to_dense[parent] : TRANSFORM_INVALID;
+    ts->dirty[i] = 1;
+    ts->destroyed[i] = 0;
+
+    return id;
+}
+
+
+void transform_destroy(TransformSystem* ts, TransformId id)
+{
+    uint32_t i = ts->id_to_dense[id];
+    if (ts->destroyed[i]) return;
+
+    // Dense indices don't move until the next update, it removes every flagged transform at once
+    ts->destroyed[i] = 1;
+    ts->destroyed_count++;
+}
+
+
+void transform_set_parent(TransformSystem* ts, TransformId id, TransformId parent)
+{
+    uint32_t i = ts->id_to_dense[id];
+    uint32_t parent_index = parent != TRANSFORM_INVALID ? ts->id_to_dense[parent] : TRANSFORM_INVALID;
+
+    // No cycles, the new parent can't be a descendant
+    for (uint32_t ancestor = parent_index; ancestor != TRANSFORM_INVALID; ancestor = ts->parent[ancestor]) {
+        if (ancestor == i) {
+            LOG_WARNING("Transform %u can not be parented to its own descendant %u!", id, parent);
+            return;
+        }
+    }
+
+    ts->parent[i] = parent_index;
+    ts->dirty[i] = 1;
+
+    if (parent_index != TRANSFORM_INVALID && parent_index > i) ts->order_dirty = true;
+}
+
+
+void transform_set_position(TransformSystem* ts, TransformId id, const float position[3])
+{
+    uint32_t i = ts->id_to_dense[id];
+
+    ts->position[0][i] = position[0];
+    ts->position[1][i] = position[1];
+    ts->position[2][i] = position[2];
+    ts->dirty[i] = 1;
+}
+
+
+void transform_set_rotation(TransformSystem* ts, TransformId id, const float rotation[4])
+{
+    uint32_t i = ts->id_to_dense[id];
+
+    ts->rotation[0][i] = rotation[0];
+    ts->rotation[1][i] = rotation[1];
+    ts->rotation[2][i] = rotation[2];
+    ts->rotation[3][i] = rotation[3];
+    ts->dirty[i] = 1;
+}
+
+
+void transform_set_scale(TransformSystem* ts, TransformId id, const float scale[3])
+{
+    uint32_t i = ts->id_to_dense[id];
+
+    ts->scale[0][i] = scale[0];
+    ts->scale[1][i] = scale[1];
+    ts->scale[2][i] = scale[2];
+    ts->dirty[i] = 1;
+}
+
+
+const float* transform_world(const TransformSystem* ts, TransformId id)
+{
+    return ts->world[ts->id_to_dense[id]];
+}
+
+
+void transform_update(TransformSystem* ts, Arena* scratch)
+{
+    uint64_t update_start_ns = SDL_GetTicksNS();
+
+    if (ts->destroyed_count > 0) transform_compact(ts, scratch);
+    if (ts->order_dirty) transform_sort(ts, scratch);
+
+    // Parents come first, so one pass carries dirtiness all the way down
+    for (uint32_t i = 0; i < ts->count; i++) {
+        uint32_t parent = ts->parent[i];
+        if (!ts->dirty[i] && parent != TRANSFORM_INVALID && ts->dirty[parent]) ts->dirty[i] = 1;
+    }
+
+    uint32_t updated_count = 0;
+    float local[TRANSFORM_LANES][16];
+
+    for (uint32_t first = 0; first < ts->count; first += TRANSFORM_LANES) {
+        uint32_t group_dirty;
+        SDL_memcpy(&group_dirty, &ts->dirty[first], sizeof(uint32_t));
+        if (group_dirty == 0) continue;
+
+        transform_local_matrices(ts, first, local);
+
+        // A parent in the same group is always in an earlier lane, its world is ready
+        for (uint32_t lane = 0; lane < TRANSFORM_LANES && first + lane < ts->count; lane++) {
+            uint32_t i = first + lane;
+            if (!ts->dirty[i]) continue;
+
+            if (ts->parent[i] == TRANSFORM_INVALID) {
+                SDL_memcpy(ts->world[i], local[lane], sizeof(float) * 16);
+            }
+            else {
+                transform_mul(ts->world[ts->parent[i]], local[lane], ts->world[i]);
+            }
+
+            updated_count++;
+        }
+    }
+
+    SDL_memset(ts->dirty, 0, ts->count);
+
+    ts->updated_count = updated_count;
+    ts->update_ns = SDL_GetTicksNS() - update_start_ns;
+}
+
+
+void transform_compact(TransformSystem* ts, Arena* scratch)
+{
+    ArenaMark scratch_mark = arena_mark(scratch);
+
+    uint32_t count = ts->count;
+    uint32_t* remap = arena_alloc(scratch, sizeof(uint32_t) * (count + 1)); // Old position -> new
+    if (remap == NULL) {
+        LOG_ERROR("Failed to allocate scratch for removing %u transforms!", ts->destroyed_count);
+        arena_rewind(scratch_mark);
+        return;
+    }
+
+    // Survivors slide down in order, parents still come before their children
+    uint32_t kept_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (ts->destroyed[i]) {
+            TransformId id = ts->dense_to_id[i];
+            ts->id_to_dense[id] = ts->first_free_id;
+            ts->first_free_id = id;
+
+            remap[i] = TRANSFORM_INVALID;
+            continue;
+        }
+
+        uint32_t n = kept_count++;
+        remap[i] = n;
+        if (n == i) continue;
+
+        for (int axis = 0; axis < 3; axis++) ts->position[axis][n] = ts->position[axis][i];
+        for (int axis = 0; axis < 4; axis++) ts->rotation[axis][n] = ts->rotation[axis][i];
+        for (int axis = 0; axis < 3; axis++) ts->scale[axis][n] = ts->scale[axis][i];
+        ts->parent[n] = ts->parent[i];
+        ts->dirty[n] = ts->dirty[i];
+        ts->destroyed[n] = 0;
+        SDL_memcpy(ts->world[n], ts->world[i], sizeof(float) * 16);
+        ts->dense_to_id[n] = ts->dense_to_id[i];
+    }
+
+    // Children of removed transforms become roots
+    for (uint32_t n = 0; n < kept_count; n++) {
+        uint32_t parent = ts->parent[n];
+        if (parent != TRANSFORM_INVALID) {
+            ts->parent[n] = remap[parent];
+            if (remap[parent] == TRANSFORM_INVALID) ts->dirty[n] = 1;
+        }
+
+        ts->id_to_dense[ts->dense_to_id[n]] = n;
+    }
+
+    // Padding lanes are read by the batched update, they are never dirty
+    SDL_memset(&ts->dirty[kept_count], 0, count - kept_count);
+    SDL_memset(&ts->destroyed[kept_count], 0, count - kept_count);
+
+    ts->count = kept_count;
+    ts->destroyed_count = 0;
+    arena_rewind(scratch_mark);
+}
+
+
+void transform_sort(TransformSystem* ts, Arena* scratch)
+{
+    ArenaMark scratch_mark = arena_mark(scratch);
+
+    uint32_t count = ts->count;
+    uint32_t* depth = arena_alloc(scratch, sizeof(uint32_t) * (count + 1));
+    uint32_t* order = arena_alloc(scratch, sizeof(uint32_t) * (count + 1)); // New position -> old
+    uint32_t* remap = arena_alloc(scratch, sizeof(uint32_t) * (count + 1)); // Old position -> new
+    void* temp = arena_alloc(scratch, sizeof(float) * 16 * (count + 1));
+
+    if (depth == NULL || order == NULL || remap == NULL || temp == NULL) {
+        LOG_ERROR("Failed to allocate scratch for sorting %u transforms!", count);
+        arena_rewind(scratch_mark);
+        return;
+    }
+
+    // Depth of each transform, walking up until a known depth
+    uint32_t max_depth = 0;
+    for (uint32_t i = 0; i < count; i++) depth[i] = TRANSFORM_INVALID;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t steps = 0;
+        uint32_t node = i;
+        while (node != TRANSFORM_INVALID && depth[node] == TRANSFORM_INVALID) {
+            node = ts->parent[node];
+            steps++;
+        }
+
+        uint32_t d = node == TRANSFORM_INVALID ? steps - 1 : depth[node] + steps;
+        for (node = i; node != TRANSFORM_INVALID && depth[node] == TRANSFORM_INVALID; node = ts->parent[node]) {
+            depth[node] = d--;
+        }
+
+        if (depth[i] > max_depth) max_depth = depth[i];
+    }
+
+    // Counting sort by depth, stable so siblings keep their relative order
+    uint32_t* depth_starts = arena_alloc(scratch, sizeof(uint32_t) * (max_depth + 2));
+    if (depth_starts == NULL) {
+        LOG_ERROR("Failed to allocate scratch for sorting %u transforms!", count);
+        arena_rewind(scratch_mark);
+        return;
+    }
+
+    SDL_memset(depth_starts, 0, sizeof(uint32_t) * (max_depth + 2));
+    for (uint32_t i = 0; i < count; i++) depth_starts[depth[i] + 1]++;
+    for (uint32_t d = 0; d <= max_depth; d++) depth_starts[d + 1] += depth_starts[d];
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t new_index = depth_starts[depth[i]]++;
+        order[new_index] = i;
+        remap[i] = new_index;
+    }
+
+    // Permute every array through `temp`
+    #define TRANSFORM_PERMUTE(array, type) \
+        do { \
+            type* scratch_copy = (type*)temp; \
+            for (uint32_t n = 0; n < count; n++) scratch_copy[n] = (array)[order[n]]; \
+            SDL_memcpy((array), scratch_copy, sizeof(type) * count); \
+        } while (0)
+
+    for (int axis = 0; axis < 3; axis++) TRANSFORM_PERMUTE(ts->position[axis], float);
+    for (int axis = 0; axis < 4; axis++) TRANSFORM_PERMUTE(ts->rotation[axis], float);
+    for (int axis = 0; axis < 3; axis++) TRANSFORM_PERMUTE(ts->scale[axis], float);
+    TRANSFORM_PERMUTE(ts->parent, uint32_t);
+    TRANSFORM_PERMUTE(ts->dirty, uint8_t);
+    TRANSFORM_PERMUTE(ts->destroyed, uint8_t);
+    TRANSFORM_PERMUTE(ts->dense_to_id, TransformId);
+
+    #undef TRANSFORM_PERMUTE
+
+    float (*world_copy)[16] = temp;
+    for (uint32_t n = 0; n < count; n++) SDL_memcpy(world_copy[n], ts->world[order[n]], sizeof(float) * 16);
+    SDL_memcpy(ts->world, world_copy, sizeof(float) * 16 * count);
+
+    for (uint32_t n = 0; n < count; n++) {
+        if (ts->parent[n] != TRANSFORM_INVALID) ts->parent[n] = remap[ts->parent[n]];
+        ts->id_to_dense[ts->dense_to_id[n]] = n;
+    }
+
+    ts->order_dirty = false;
+    arena_rewind(scratch_mark);
+}
+
+
+void transform_local_matrices(const TransformSystem* ts, uint32_t first, float out[TRANSFORM_LANES][16])
+{
+    // M = T * R * S from 4 transforms at once, then transposed into 4 column major matrices
+#ifdef __SSE2__
+    __m128 px = _mm_load_ps(&ts->position[0][first]), py = _mm_load_ps(&ts->position[1][first]), pz = _mm_load_ps(&ts->position[2][first]);
+    __m128 qx = _mm_load_ps(&ts->rotation[0][first]), qy = _mm_load_ps(&ts->rotation[1][first]);
+    __m128 qz = _mm_load_ps(&ts->rotation[2][first]), qw = _mm_load_ps(&ts->rotation[3][first]);
+    __m128 sx = _mm_load_ps(&ts->scale[0][first]), sy = _mm_load_ps(&ts->scale[1][first]), sz = _mm_load_ps(&ts->scale[2][first]);
+
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 two = _mm_set1_ps(2.0f);
+    __m128 zero = _mm_setzero_ps();
+
+    __m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+    __m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+    __m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+    // Rotation rows/columns, each column scaled by its axis
+    __m128 c0[4] = {
+        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+        zero,
+    };
+    __m128 c1[4] = {
+        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+        zero,
+    };
+    __m128 c2[4] = {
+        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+        zero,
+    };
+    __m128 c3[4] = { px, py, pz, one };
+
+    __m128* columns[4] = { c0, c1, c2, c3 };
+    for (int column = 0; column < 4; column++) {
+        __m128* c = columns[column];
+        _MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+
+        for (int lane = 0; lane < TRANSFORM_LANES; lane++) _mm_storeu_ps(&out[lane][column * 4], c[lane]);
+    }
+#else
+    for (int lane = 0; lane < TRANSFORM_LANES; lane++) {
+        uint32_t i = first + lane;
+        float x = ts->rotation[0][i], y = ts->rotation[1][i], z = ts->rotation[2][i], w = ts->rotation[3][i];
+        float sx = ts->scale[0][i], sy = ts->scale[1][i], sz = ts->scale[2][i];
+        float* m = out[lane];
+
+        m[0] = (1.0f - 2.0f * (y * y + z * z)) * sx;
+        m[1] = 2.0f * (x * y + w * z) * sx;
+        m[2] = 2.0f * (x * z - w * y) * sx;
+        m[3] = 0.0f;
+
+        m[4] = 2.0f * (x * y - w * z) * sy;
+        m[5] = (1.0f - 2.0f * (x * x + z * z)) * sy;
+        m[6] = 2.0f * (y * z + w * x) * sy;
+        m[7] = 0.0f;
+
+        m[8] = 2.0f * (x * z + w * y) * sz;
+        m[9] = 2.0f * (y * z - w * x) * sz;
+        m[10] = (1.0f - 2.0f * (x * x + y * y)) * sz;
+        m[11] = 0.0f;
+
+        m[12] = ts->position[0][i];
+        m[13] = ts->position[1][i];
+        m[14] = ts->position[2][i];
+        m[15] = 1.0f;
+    }
+#endif
+}
+
+
+void transform_mul(const float a[16], const float b[16], float out[16])
+{
+    // out = a * b, column major
+#ifdef __SSE2__
+    __m128 a0 = _mm_loadu_ps(&a[0]), a1 = _mm_loadu_ps(&a[4]), a2 = _mm_loadu_ps(&a[8]), a3 = _mm_loadu_ps(&a[12]);
+
+    for (int column = 0; column < 4; column++) {
+        const float* b_column = &b[column * 4];
+
+        __m128 result = _mm_mul_ps(a0, _mm_set1_ps(b_column[0]));
+        result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(b_column[1])));
+        result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(b_column[2])));
+        result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(b_column[3])));
+
+        _mm_storeu_ps(&out[column * 4], result);
+    }
+#else
+    float result[16];
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            result[column * 4 + row] =
+                a[0 * 4 + row] * b[column * 4 + 0] +
+                a[1 * 4 + row] * b[column * 4 + 1] +
+                a[2 * 4 + row] * b[column * 4 + 2] +
+                a[3 * 4 + row] * b[column * 4 + 3];
+        }
+    }
+    SDL_memcpy(out, result, sizeof(result));
+#endif
+}
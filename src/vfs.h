@@ -0,0 +1,554 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include "log.h"
+#include "arena.h"
+#include "str_utils.h"
+#include "archive.h"
+
+/*
+** Virtual file system
+**
+** Archives and loose directories are mounted with a priority, the highest one providing a
+** path wins (the later mount on a tie). Everything is merged into one hash index while
+** mounting, a lookup costs the same with one mount or ten:
+**
+**     base archive (0) < patch / DLC archives (1..) < loose directory (dev overlay)
+**
+** A loose directory is mapped onto `mount_point`, the root the archives were packed from, so
+** `<dir>/shaders/level.fs` replaces `./assets/shaders/level.fs`. Loose files are sources,
+** whatever `pack` derived from the same source in a lower archive (`level.fs#03`,
+** `wall.png.tex`, `tot.mdl.cells`...) is hidden with it so the loaders fall back to the source.
+**
+** Mount everything before looking anything up, entries move while the index grows.
+*/
+
+/*
+** Macros
+*/
+
+#define VFS_MAX_MOUNTS 16
+#define VFS_MAX_PATH_LENGTH ARCHIVE_MAX_PATH_LENGTH
+
+/*
+** Structs
+*/
+
+typedef struct {
+    char* path; // As the game asks for it, e.g. `./assets/shaders/level.fs`
+    size_t offset; // In the mount's archive, 0 for loose files
+    size_t size;
+    int mount;
+    bool shadowed; // Derived from a source a higher loose mount replaces
+} FileEntry;
+
+typedef struct {
+    char path[VFS_MAX_PATH_LENGTH]; // Archive file or directory on disk
+    char mount_point[VFS_MAX_PATH_LENGTH]; // Loose directories only
+    int priority;
+    bool loose;
+
+    SDL_IOStream* io; // Archives stay open while mounted
+    int files_count;
+} VfsMount;
+
+typedef struct {
+    Arena* arena; // Paths, lives as long as the mounts
+
+    VfsMount mounts[VFS_MAX_MOUNTS];
+    int mounts_count;
+
+    FileEntry* entries;
+    int entries_count;
+    int entries_capacity;
+
+    // Open addressing, entry index + 1, 0 when empty
+    int* buckets;
+    uint32_t buckets_count; // Power of two
+
+    // Loose files are opened on demand, one at a time
+    SDL_IOStream* loose_io;
+    const FileEntry* loose_entry;
+} Vfs;
+
+// The index as it was before a mount, restored if the mount fails halfway
+typedef struct {
+    FileEntry* entries; // NULL if the index was empty
+    int entries_count;
+    ArenaMark arena_mark;
+} VfsSnapshot;
+
+/*
+** Declarations
+*/
+
+void vfs_init(Vfs* vfs, Arena* arena);
+void vfs_quit(Vfs* vfs);
+
+bool vfs_mount(Vfs* vfs, const char* path, const char* mount_point, int priority);
+bool vfs_mount_archive(Vfs* vfs, const char* archive_path, int priority);
+bool vfs_mount_directory(Vfs* vfs, const char* dir_path, const char* mount_point, int priority);
+
+FileEntry* vfs_find(Vfs* vfs, const char* path);
+SDL_IOStream* vfs_open(Vfs* vfs, const FileEntry* entry, size_t offset);
+void vfs_close_loose(Vfs* vfs);
+void vfs_report(Vfs* vfs);
+
+VfsMount* vfs_add_mount(Vfs* vfs, const char* path, int priority);
+bool vfs_snapshot(Vfs* vfs, VfsSnapshot* snapshot);
+void vfs_snapshot_free(VfsSnapshot* snapshot);
+void vfs_rollback(Vfs* vfs, VfsSnapshot* snapshot);
+bool vfs_insert(Vfs* vfs, int mount, char* path, size_t offset, size_t size);
+int vfs_find_index(Vfs* vfs, const char* path, uint32_t hash);
+bool vfs_grow(Vfs* vfs);
+void vfs_rehash(Vfs* vfs);
+void vfs_resolve_shadows(Vfs* vfs);
+bool vfs_scan_dir(Vfs* vfs, int mount, const char* dir_path);
+SDL_EnumerationResult vfs_list_dir(void* userdata, const char* dir_name, const char* file_name);
+uint32_t vfs_hash_path(const char* path, size_t length);
+
+/*
+** Implementation
+*/
+
+void vfs_init(Vfs* vfs, Arena* arena)
+{
+    SDL_memset(vfs, 0, sizeof(Vfs));
+    vfs->arena = arena;
+}
+
+
+void vfs_quit(Vfs* vfs)
+{
+    if (vfs->loose_io != NULL) SDL_CloseIO(vfs->loose_io);
+
+    for (int i = 0; i < vfs->mounts_count; i++) {
+        if (vfs->mounts[i].io != NULL) SDL_CloseIO(vfs->mounts[i].io);
+    }
+
+    SDL_free(vfs->entries);
+    SDL_free(vfs->buckets);
+
+    // Paths are in the arena, its owner frees them
+    SDL_memset(vfs, 0, sizeof(Vfs));
+}
+
+
+bool vfs_mount(Vfs* vfs, const char* path, const char* mount_point, int priority)
+{
+    SDL_PathInfo info;
+    if (!SDL_GetPathInfo(path, &info)) {
+        LOG_ERROR("Can not mount %s! SDL error:\n%s", path, SDL_GetError());
+        return false;
+    }
+
+    if (info.type == SDL_PATHTYPE_DIRECTORY) {
+        return vfs_mount_directory(vfs, path, mount_point, priority);
+    }
+
+    return vfs_mount_archive(vfs, path, priority);
+}
+
+
+bool vfs_mount_archive(Vfs* vfs, const char* archive_path, int priority)
+{
+    // A broken archive leaves the index as it was, lower mounts keep providing their files
+    VfsSnapshot snapshot;
+    if (!vfs_snapshot(vfs, &snapshot)) return false;
+
+    VfsMount* mount = vfs_add_mount(vfs, archive_path, priority);
+    if (mount == NULL) {
+        vfs_snapshot_free(&snapshot);
+        return false;
+    }
+
+    mount->io = SDL_IOFromFile(archive_path, "rb");
+    if (mount->io == NULL) {
+        LOG_ERROR("Failed to open archive %s! SDL error:\n%s", archive_path, SDL_GetError());
+        vfs_rollback(vfs, &snapshot);
+        return false;
+    }
+
+    // Paths are read into the VFS arena and kept by the merged index
+    ArchiveHeader header;
+    int entries_count = 0;
+    ArchiveEntry* entries = archive_read_index(mount->io, vfs->arena, &header, &entries_count);
+    if (entries == NULL) {
+        LOG_ERROR("Invalid archive: %s!", archive_path);
+        vfs_rollback(vfs, &snapshot);
+        return false;
+    }
+
+    for (int i = 0; i < entries_count; i++) {
+        if (!vfs_insert(vfs, vfs->mounts_count - 1, entries[i].path, entries[i].offset, entries[i].size)) {
+            LOG_ERROR("Failed to merge the index of %s!", archive_path);
+            vfs_rollback(vfs, &snapshot);
+            return false;
+        }
+    }
+
+    vfs_snapshot_free(&snapshot);
+
+    mount->files_count = entries_count;
+    vfs_resolve_shadows(vfs);
+
+    LOG_INFO("Mounted archive %s (v%u, priority %d, %d files, %u byte aligned)", archive_path, header.version, priority, entries_count, header.alignment);
+    return true;
+}
+
+
+bool vfs_mount_directory(Vfs* vfs, const char* dir_path, const char* mount_point, int priority)
+{
+    // Same as archives, a directory that can't be scanned fully isn't mounted at all
+    VfsSnapshot snapshot;
+    if (!vfs_snapshot(vfs, &snapshot)) return false;
+
+    VfsMount* mount = vfs_add_mount(vfs, dir_path, priority);
+    if (mount == NULL) {
+        vfs_snapshot_free(&snapshot);
+        return false;
+    }
+
+    mount->loose = true;
+    SDL_strlcpy(mount->mount_point, mount_point, VFS_MAX_PATH_LENGTH);
+
+    // Both sides without a trailing slash, relative paths are appended with one
+    str_path_ensure_forward_slash(mount->path);
+    size_t point_length = strlen(mount->mount_point);
+    if (point_length > 0 && mount->mount_point[point_length - 1] == '/') mount->mount_point[point_length - 1] = '\0';
+
+    size_t dir_length = strlen(mount->path);
+    if (dir_length > 1 && mount->path[dir_length - 1] == '/') mount->path[dir_length - 1] = '\0';
+
+    if (!vfs_scan_dir(vfs, vfs->mounts_count - 1, mount->path)) {
+        LOG_ERROR("Failed to mount directory %s!", dir_path);
+        vfs_rollback(vfs, &snapshot);
+        return false;
+    }
+
+    vfs_snapshot_free(&snapshot);
+    vfs_resolve_shadows(vfs);
+
+    LOG_INFO("Mounted directory %s as %s (priority %d, %d files)", mount->path, mount->mount_point, priority, mount->files_count);
+    return true;
+}
+
+
+FileEntry* vfs_find(Vfs* vfs, const char* path)
+{
+    int index = vfs_find_index(vfs, path, vfs_hash_path(path, strlen(path)));
+    if (index < 0 || vfs->entries[index].shadowed) return NULL;
+
+    return &vfs->entries[index];
+}
+
+
+SDL_IOStream* vfs_open(Vfs* vfs, const FileEntry* entry, size_t offset)
+{
+    VfsMount* mount = &vfs->mounts[entry->mount];
+
+    // Archive entries share the archive's stream, the next open moves it
+    if (!mount->loose) {
+        SDL_SeekIO(mount->io, (Sint64)(entry->offset + offset), SDL_IO_SEEK_SET);
+        return mount->io;
+    }
+
+    if (vfs->loose_entry != entry) {
+        if (vfs->loose_io != NULL) SDL_CloseIO(vfs->loose_io);
+        vfs->loose_entry = NULL;
+
+        char disk_path[VFS_MAX_PATH_LENGTH];
+        SDL_snprintf(disk_path, VFS_MAX_PATH_LENGTH, "%s%s", mount->path, entry->path + strlen(mount->mount_point));
+
+        vfs->loose_io = SDL_IOFromFile(disk_path, "rb");
+        if (vfs->loose_io == NULL) {
+            LOG_ERROR("Failed to open %s! SDL error:\n%s", disk_path, SDL_GetError());
+            return NULL;
+        }
+
+        vfs->loose_entry = entry;
+    }
+
+    SDL_SeekIO(vfs->loose_io, (Sint64)offset, SDL_IO_SEEK_SET);
+    return vfs->loose_io;
+}
+
+
+void vfs_close_loose(Vfs* vfs)
+{
+    // The next open of a loose file sees it as it is on disk now
+    if (vfs->loose_io != NULL) SDL_CloseIO(vfs->loose_io);
+
+    vfs->loose_io = NULL;
+    vfs->loose_entry = NULL;
+}
+
+
+void vfs_report(Vfs* vfs)
+{
+    int shadowed_count = 0;
+    for (int i = 0; i < vfs->entries_count; i++) shadowed_count += vfs->entries[i].shadowed;
+
+    LOG_INFO("VFS: %d files from %d mounts, %d hidden by loose sources", vfs->entries_count - shadowed_count, vfs->mounts_count, shadowed_count);
+
+    for (int i = 0; i < vfs->mounts_count; i++) {
+        VfsMount* mount = &vfs->mounts[i];
+
+        int provided_count = 0;
+        for (int e = 0; e < vfs->entries_count; e++) provided_count += vfs->entries[e].mount == i && !vfs->entries[e].shadowed;
+
+        LOG_INFO("  %-8s %3d  %5d / %5d files  %s", mount->loose ? "loose" : "archive", mount->priority, provided_count, mount->files_count, mount->path);
+    }
+}
+
+
+VfsMount* vfs_add_mount(Vfs* vfs, const char* path, int priority)
+{
+    if (vfs->mounts_count == VFS_MAX_MOUNTS) {
+        LOG_ERROR("Too many mounts, can not mount %s!", path);
+        return NULL;
+    }
+
+    VfsMount* mount = &vfs->mounts[vfs->mounts_count++];
+    SDL_memset(mount, 0, sizeof(VfsMount));
+    SDL_strlcpy(mount->path, path, VFS_MAX_PATH_LENGTH);
+    mount->priority = priority;
+
+    return mount;
+}
+
+
+bool vfs_snapshot(Vfs* vfs, VfsSnapshot* snapshot)
+{
+    snapshot->entries = NULL;
+    snapshot->entries_count = vfs->entries_count;
+    snapshot->arena_mark = arena_mark(vfs->arena);
+
+    if (vfs->entries_count == 0) return true;
+
+    snapshot->entries = (FileEntry*)SDL_malloc(sizeof(FileEntry) * vfs->entries_count);
+    if (!snapshot->entries) {
+        LOG_ERROR("Failed to copy the VFS index of %d entries before mounting!", vfs->entries_count);
+        return false;
+    }
+
+    SDL_memcpy(snapshot->entries, vfs->entries, sizeof(FileEntry) * vfs->entries_count);
+    return true;
+}
+
+
+void vfs_snapshot_free(VfsSnapshot* snapshot)
+{
+    SDL_free(snapshot->entries);
+    snapshot->entries = NULL;
+}
+
+
+void vfs_rollback(Vfs* vfs, VfsSnapshot* snapshot)
+{
+    // Only ever the mount that was just added
+    VfsMount* mount = &vfs->mounts[--vfs->mounts_count];
+    if (mount->io != NULL) SDL_CloseIO(mount->io);
+    SDL_memset(mount, 0, sizeof(VfsMount));
+
+    // Entries it replaced point at the lower mounts again, the ones it added are gone
+    if (snapshot->entries_count > 0) SDL_memcpy(vfs->entries, snapshot->entries, sizeof(FileEntry) * snapshot->entries_count);
+    vfs->entries_count = snapshot->entries_count;
+    vfs_rehash(vfs);
+    vfs_resolve_shadows(vfs);
+
+    // So are their paths
+    arena_rewind(snapshot->arena_mark);
+    vfs_snapshot_free(snapshot);
+}
+
+
+// `path` must live as long as the VFS, a new entry keeps it
+bool vfs_insert(Vfs* vfs, int mount, char* path, size_t offset, size_t size)
+{
+    // At most half the buckets are in use
+    if (vfs->entries_count == vfs->entries_capacity && !vfs_grow(vfs)) return false;
+
+    uint32_t hash = vfs_hash_path(path, strlen(path));
+    int index = vfs_find_index(vfs, path, hash);
+
+    if (index >= 0) {
+        // Lower priority than what is already there, the file stays hidden
+        FileEntry* existing = &vfs->entries[index];
+        if (vfs->mounts[existing->mount].priority > vfs->mounts[mount].priority) return true;
+
+        existing->offset = offset;
+        existing->size = size;
+        existing->mount = mount;
+        return true;
+    }
+
+    FileEntry* entry = &vfs->entries[vfs->entries_count];
+    entry->path = path;
+    entry->offset = offset;
+    entry->size = size;
+    entry->mount = mount;
+    entry->shadowed = false;
+
+    uint32_t bucket = hash & (vfs->buckets_count - 1);
+    while (vfs->buckets[bucket] != 0) bucket = (bucket + 1) & (vfs->buckets_count - 1);
+    vfs->buckets[bucket] = ++vfs->entries_count;
+
+    return true;
+}
+
+
+int vfs_find_index(Vfs* vfs, const char* path, uint32_t hash)
+{
+    if (vfs->buckets_count == 0) return -1;
+
+    for (uint32_t bucket = hash & (vfs->buckets_count - 1); vfs->buckets[bucket] != 0; bucket = (bucket + 1) & (vfs->buckets_count - 1)) {
+        int index = vfs->buckets[bucket] - 1;
+        if (SDL_strcmp(vfs->entries[index].path, path) == 0) return index;
+    }
+
+    return -1;
+}
+
+
+bool vfs_grow(Vfs* vfs)
+{
+    int capacity = vfs->entries_capacity ? vfs->entries_capacity * 2 : 256;
+    FileEntry* entries = (FileEntry*)SDL_realloc(vfs->entries, sizeof(FileEntry) * capacity);
+    if (!entries) {
+        LOG_ERROR("Failed to grow the VFS index to %d entries!", capacity);
+        return false;
+    }
+
+    uint32_t buckets_count = (uint32_t)capacity * 2;
+    int* buckets = (int*)SDL_calloc(buckets_count, sizeof(int));
+    if (!buckets) {
+        LOG_ERROR("Failed to allocate %u VFS buckets!", buckets_count);
+        vfs->entries = entries;
+        return false;
+    }
+
+    SDL_free(vfs->buckets);
+    vfs->entries = entries;
+    vfs->entries_capacity = capacity;
+    vfs->buckets = buckets;
+    vfs->buckets_count = buckets_count;
+
+    vfs_rehash(vfs);
+    return true;
+}
+
+
+void vfs_rehash(Vfs* vfs)
+{
+    if (vfs->buckets_count == 0) return;
+
+    // Entries keep their indices
+    SDL_memset(vfs->buckets, 0, sizeof(int) * vfs->buckets_count);
+    for (int i = 0; i < vfs->entries_count; i++) {
+        uint32_t bucket = vfs_hash_path(vfs->entries[i].path, strlen(vfs->entries[i].path)) & (vfs->buckets_count - 1);
+        while (vfs->buckets[bucket] != 0) bucket = (bucket + 1) & (vfs->buckets_count - 1);
+        vfs->buckets[bucket] = i + 1;
+    }
+}
+
+
+void vfs_resolve_shadows(Vfs* vfs)
+{
+    bool has_loose = false;
+    for (int i = 0; i < vfs->mounts_count; i++) has_loose |= vfs->mounts[i].loose;
+
+    for (int i = 0; i < vfs->entries_count; i++) {
+        FileEntry* entry = &vfs->entries[i];
+        entry->shadowed = false;
+
+        if (!has_loose || vfs->mounts[entry->mount].loose) continue;
+
+        // Derived files are named after their source plus a suffix, try every cut after the
+        // source's own extension
+        const char* name = SDL_strrchr(entry->path, '/');
+        name = name != NULL ? name + 1 : entry->path;
+
+        bool extension_seen = false;
+        for (const char* c = name; *c != '\0' && !entry->shadowed; c++) {
+            if (*c != '.' && *c != '#') continue;
+
+            if (extension_seen) {
+                size_t length = (size_t)(c - entry->path);
+                uint32_t hash = vfs_hash_path(entry->path, length);
+
+                char source_path[VFS_MAX_PATH_LENGTH];
+                SDL_strlcpy(source_path, entry->path, SDL_min(length + 1, sizeof(source_path)));
+
+                int source = vfs_find_index(vfs, source_path, hash);
+                if (source >= 0) {
+                    VfsMount* source_mount = &vfs->mounts[vfs->entries[source].mount];
+                    entry->shadowed = source_mount->loose && source_mount->priority >= vfs->mounts[entry->mount].priority;
+                }
+            }
+
+            extension_seen = *c == '.' || extension_seen;
+        }
+    }
+}
+
+
+bool vfs_scan_dir(Vfs* vfs, int mount, const char* dir_path)
+{
+    struct { Vfs* vfs; int mount; bool failed; } scan = { vfs, mount, false };
+
+    if (!SDL_EnumerateDirectory(dir_path, vfs_list_dir, &scan)) {
+        LOG_ERROR("Failed to list directory: %s! SDL error:\n%s", dir_path, SDL_GetError());
+        return false;
+    }
+
+    return !scan.failed;
+}
+
+
+SDL_EnumerationResult vfs_list_dir(void* userdata, const char* dir_name, const char* file_name)
+{
+    struct { Vfs* vfs; int mount; bool failed; }* scan = userdata;
+    VfsMount* mount = &scan->vfs->mounts[scan->mount];
+
+    char full_path[VFS_MAX_PATH_LENGTH];
+    SDL_snprintf(full_path, VFS_MAX_PATH_LENGTH, "%s%s", dir_name, file_name);
+    str_path_ensure_forward_slash(full_path);
+
+    SDL_PathInfo info;
+    if (!SDL_GetPathInfo(full_path, &info)) {
+        LOG_ERROR("Failed to get path info for: %s! SDL error:\n%s", full_path, SDL_GetError());
+        return SDL_ENUM_CONTINUE;
+    }
+
+    if (info.type == SDL_PATHTYPE_DIRECTORY) {
+        if (!vfs_scan_dir(scan->vfs, scan->mount, full_path)) scan->failed = true;
+    }
+    else if (info.type == SDL_PATHTYPE_FILE) {
+        // Same path the archives use, the directory swapped for the mount point
+        char* path = str_new_formatted(scan->vfs->arena, "%s%s", mount->mount_point, full_path + strlen(mount->path));
+
+        if (path == NULL || !vfs_insert(scan->vfs, scan->mount, path, 0, (size_t)info.size)) {
+            scan->failed = true;
+            return SDL_ENUM_FAILURE;
+        }
+
+        mount->files_count++;
+    }
+
+    return SDL_ENUM_CONTINUE;
+}
+
+
+uint32_t vfs_hash_path(const char* path, size_t length)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)path[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}